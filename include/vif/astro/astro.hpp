@@ -2,6 +2,7 @@
 #define VIF_ASTRO_ASTRO_HPP
 
 #include <map>
+#include <unordered_map>
 #include "vif/core/vec.hpp"
 #include "vif/core/error.hpp"
 #include "vif/utility/thread.hpp"
@@ -661,43 +662,410 @@ namespace astro {
         return field_area_h2d(ra, dec);
     }
 
+    struct angcorrel_params {
+        // Number of threads to use
+        uint_t thread = 1u;
+        // Number of jackknife regions used to estimate uncertainties (0: none)
+        uint_t jackknife = 0u;
+    };
+
+    struct angcorrel_res {
+        // Correlation function in each bin
+        vec1d w;
+        // Jackknife uncertainty on 'w', and correlation function computed without each of
+        // the jackknife regions [njack,nbin] (only if jackknife regions were requested)
+        vec1d w_err;
+        vec2d w_jack;
+        // Number of distinct data-data, data-random and random-random pairs in each bin
+        vec1u dd, dr, rr;
+    };
+}
+
+namespace impl {
+    namespace angcorrel_impl {
+        // Cubic grid covering a region of the unit sphere. Two points closer than the cell
+        // size are always in neighboring cells.
+        struct grid_t {
+            double x0 = 0.0, y0 = 0.0, z0 = 0.0;
+            double csize = 1.0;
+            uint_t nx = 1, ny = 1, nz = 1;
+
+            uint_t key(double x, double y, double z) const {
+                uint_t ix = std::min(uint_t((x - x0)/csize), nx-1);
+                uint_t iy = std::min(uint_t((y - y0)/csize), ny-1);
+                uint_t iz = std::min(uint_t((z - z0)/csize), nz-1);
+                return (ix*ny + iy)*nz + iz;
+            }
+        };
+
+        // Cartesian positions on the unit sphere, sorted by grid cell
+        struct cells_t {
+            vec1d x, y, z;
+            vec1u jack;
+            // Keys of the non-empty cells, and their points in [start[c],start[c+1])
+            vec1u key;
+            vec1u start;
+            std::unordered_map<uint_t,uint_t> lookup;
+        };
+
+        inline void to_sphere(double ra, double dec, double& x, double& y, double& z) {
+            const double d2r = dpi/180.0;
+            double cd = cos(d2r*dec);
+            x = cd*cos(d2r*ra);
+            y = cd*sin(d2r*ra);
+            z = sin(d2r*dec);
+        }
+
+        template<std::size_t N, typename TR, typename TD>
+        void project(const vec<N,TR>& ra, const vec<N,TD>& dec, vec1d& x, vec1d& y, vec1d& z,
+            vec1u& id) {
+
+            for (uint_t i : range(ra)) {
+                if (!is_finite(ra.safe[i]) || !is_finite(dec.safe[i])) continue;
+
+                double tx, ty, tz;
+                to_sphere(ra.safe[i], dec.safe[i], tx, ty, tz);
+                x.push_back(tx);
+                y.push_back(ty);
+                z.push_back(tz);
+                id.push_back(i);
+            }
+        }
+
+        inline cells_t make_cells(const grid_t& g, const vec1d& x, const vec1d& y,
+            const vec1d& z, const vec1u& jack) {
+
+            const uint_t n = x.size();
+            std::vector<std::pair<uint_t,uint_t>> order(n);
+            for (uint_t i : range(n)) {
+                order[i] = std::make_pair(g.key(x.safe[i], y.safe[i], z.safe[i]), i);
+            }
+
+            std::sort(order.begin(), order.end());
+
+            cells_t c;
+            c.x.resize(n); c.y.resize(n); c.z.resize(n); c.jack.resize(n);
+            for (uint_t i : range(n)) {
+                uint_t k = order[i].second;
+                c.x.safe[i] = x.safe[k];
+                c.y.safe[i] = y.safe[k];
+                c.z.safe[i] = z.safe[k];
+                c.jack.safe[i] = jack.safe[k];
+
+                if (i == 0 || order[i].first != order[i-1].first) {
+                    c.lookup[order[i].first] = c.key.size();
+                    c.key.push_back(order[i].first);
+                    c.start.push_back(i);
+                }
+            }
+
+            c.start.push_back(n);
+            return c;
+        }
+
+        struct counts_t {
+            vec1u pairs;
+            // Number of pairs involving at least one object of each jackknife region
+            vec2u touch;
+
+            counts_t(uint_t nbin, uint_t njack) : pairs(nbin), touch(njack, nbin) {}
+
+            counts_t& operator += (const counts_t& c) {
+                pairs += c.pairs;
+                touch += c.touch;
+                return *this;
+            }
+        };
+
+        // Count the pairs between 'a' and 'b' in bins of squared chord length. If 'a' and
+        // 'b' are the same set, only distinct pairs are counted.
+        inline counts_t count_pairs(const grid_t& g, const cells_t& a, const cells_t& b,
+            bool same, const bin_finder<double>& find, double dmax2, uint_t njack,
+            uint_t nthread) {
+
+            const uint_t nbin = find.nbin;
+            counts_t res(nbin, njack);
+            std::mutex mutex;
+
+            auto count_block = [&](counts_t& cnt, uint_t i0, uint_t i1, uint_t j0, uint_t j1,
+                bool same_cell) {
+
+                for (uint_t i = i0; i < i1; ++i) {
+                    const double x = a.x.safe[i], y = a.y.safe[i], z = a.z.safe[i];
+                    for (uint_t j = (same_cell ? i+1 : j0); j < j1; ++j) {
+                        double d2 = sqr(x - b.x.safe[j]) + sqr(y - b.y.safe[j]) +
+                            sqr(z - b.z.safe[j]);
+                        if (d2 >= dmax2) continue;
+
+                        uint_t k = find(d2);
+                        if (k == npos) continue;
+
+                        ++cnt.pairs.safe[k];
+                        if (njack != 0) {
+                            uint_t ja = a.jack.safe[i], jb = b.jack.safe[j];
+                            ++cnt.touch.safe(ja,k);
+                            if (jb != ja) ++cnt.touch.safe(jb,k);
+                        }
+                    }
+                }
+            };
+
+            std::function<void(uint_t,uint_t)> run = [&](uint_t c0, uint_t c1) {
+                counts_t cnt(nbin, njack);
+                for (uint_t c = c0; c < c1; ++c) {
+                    const uint_t key = a.key.safe[c];
+                    const int_t ix = key/(g.ny*g.nz);
+                    const int_t iy = (key/g.nz) % g.ny;
+                    const int_t iz = key % g.nz;
+                    const uint_t i0 = a.start.safe[c], i1 = a.start.safe[c+1];
+
+                    for (int_t dx = -1; dx <= 1; ++dx)
+                    for (int_t dy = -1; dy <= 1; ++dy)
+                    for (int_t dz = -1; dz <= 1; ++dz) {
+                        int_t nx = ix + dx, ny = iy + dy, nz = iz + dz;
+                        if (nx < 0 || ny < 0 || nz < 0 || nx >= int_t(g.nx) ||
+                            ny >= int_t(g.ny) || nz >= int_t(g.nz)) continue;
+
+                        uint_t nkey = (uint_t(nx)*g.ny + uint_t(ny))*g.nz + uint_t(nz);
+                        // Each pair of cells is only visited once within a single set
+                        if (same && nkey < key) continue;
+
+                        auto iter = b.lookup.find(nkey);
+                        if (iter == b.lookup.end()) continue;
+
+                        count_block(cnt, i0, i1, b.start.safe[iter->second],
+                            b.start.safe[iter->second+1], same && nkey == key);
+                    }
+                }
+
+                std::lock_guard<std::mutex> l(mutex);
+                res += cnt;
+            };
+
+            const uint_t ncell = a.key.size();
+            if (nthread <= 1) {
+                run(0, ncell);
+            } else {
+                thread::scheduler().execute(nthread, 0, ncell,
+                    std::max(uint_t(1), ncell/(64*nthread)), run);
+            }
+
+            return res;
+        }
+
+        // Split the area covered by a set of positions into 'n' regions holding about the
+        // same number of positions: first in slices of declination, then each slice in
+        // right ascension.
+        struct jackknife_t {
+            vec1d dec_edges;
+            std::vector<vec1d> ra_edges;
+            vec1u first;
+
+            static vec1d quantile_edges(vec1d v, uint_t n) {
+                std::sort(v.data.begin(), v.data.end());
+                vec1d e(n-1);
+                for (uint_t k : range(e)) {
+                    e.safe[k] = v.safe[((k+1)*v.size())/n];
+                }
+
+                return e;
+            }
+
+            jackknife_t(const vec1d& ra, const vec1d& dec, uint_t n) {
+                uint_t nslice = std::max(uint_t(1), uint_t(round(sqrt(double(n)))));
+                vec1u nreg(nslice);
+                for (uint_t s : range(nslice)) {
+                    nreg.safe[s] = n/nslice + (s < n % nslice ? 1 : 0);
+                }
+
+                first = cumul(nreg) - nreg;
+
+                // Declination slices, weighted by the number of regions they hold
+                vec1d sdec = dec;
+                std::sort(sdec.data.begin(), sdec.data.end());
+                dec_edges.resize(nslice-1);
+                for (uint_t s : range(dec_edges)) {
+                    dec_edges.safe[s] = sdec.safe[(first.safe[s+1]*sdec.size())/n];
+                }
+
+                for (uint_t s : range(nslice)) {
+                    vec1u ids = where(slice(dec) == s);
+                    if (ids.empty()) {
+                        ra_edges.push_back(replicate(dinf, nreg.safe[s]-1));
+                    } else {
+                        ra_edges.push_back(quantile_edges(ra[ids], nreg.safe[s]));
+                    }
+                }
+            }
+
+            vec1u slice(const vec1d& dec) const {
+                vec1u s(dec.size());
+                for (uint_t i : range(dec)) {
+                    s.safe[i] = std::upper_bound(dec_edges.begin(), dec_edges.end(),
+                        dec.safe[i]) - dec_edges.begin();
+                }
+
+                return s;
+            }
+
+            vec1u region(const vec1d& ra, const vec1d& dec) const {
+                vec1u r = slice(dec);
+                for (uint_t i : range(ra)) {
+                    const vec1d& e = ra_edges[r.safe[i]];
+                    r.safe[i] = first.safe[r.safe[i]] +
+                        (std::upper_bound(e.begin(), e.end(), ra.safe[i]) - e.begin());
+                }
+
+                return r;
+            }
+        };
+
+        // Landy-Szalay estimator, from the number of distinct pairs in 'dd' and 'rr'. The
+        // 'dself' and 'rself' objects paired with themselves are added to the bin 'self'.
+        inline vec1d landy_szalay(vec1d dd, const vec1d& dr, vec1d rr, double nd, double nr,
+            uint_t self, double dself, double rself) {
+
+            dd *= 2.0;
+            rr *= 2.0;
+            if (self != npos) {
+                dd.safe[self] += dself;
+                rr.safe[self] += rself;
+            }
+
+            double norm1 = nr/nd;
+            double norm2 = norm1*((nr - 1.0)/(nd - 1.0));
+            return ((dd*norm2 - dr*norm1) + (rr - dr*norm1))/rr;
+        }
+    }
+}
+
+namespace astro {
     // Compute 2 point angular correlation function of a data set with positions 'ra' and 'dec'
     // against a set of random positions uniformly drawn in the same region of space 'rra' and
     // 'rdec'. For good results, there must be at least as many random positions as there are
     // input positions, and results get better the more random positions are given.
     // Compute the correlation in given bins of angular separation (in arcseconds).
-    // Uses the Landy-Szalay estimator, computed with a brute force approach.
+    // Uses the Landy-Szalay estimator.
+    //
+    // Pairs are counted by sorting the positions into a grid of cells as large as the
+    // largest separation, so only the pairs in neighboring cells are tested. If requested,
+    // the area covered by the random positions is split in 'params.jackknife' regions of
+    // equal size, and the correlation function is computed again without each region to
+    // estimate its uncertainty.
     template<std::size_t N1, typename TR1, typename TD1,
         std::size_t N2, typename TR2, typename TD2, typename TB>
-    vec1d angcorrel(const vec<N1,TR1>& ra, const vec<N1,TD1>& dec,
-        const vec<N2,TR2>& rra, const vec<N2,TD2>& rdec, const vec<2,TB>& bins) {
+    angcorrel_res angcorrel(const vec<N1,TR1>& ra, const vec<N1,TD1>& dec,
+        const vec<N2,TR2>& rra, const vec<N2,TD2>& rdec, const vec<2,TB>& bins,
+        const angcorrel_params& params) {
         vif_check(ra.dims == dec.dims, "RA and Dec dimensions do not match for the "
             "input catalog (", ra.dims, " vs ", dec.dims, ")");
         vif_check(rra.dims == rdec.dims, "RA and Dec dimensions do not match for the "
             "random catalog (", rra.dims, " vs ", rdec.dims, ")");
+        vif_check(bins.dims[0] == 2, "can only be called with a bin vector (expected "
+            "dims=[2, ...], got dims=[", bins.dims, "])");
+
+        using namespace impl::angcorrel_impl;
+
+        const uint_t nbin = bins.dims[1];
+        const uint_t njack = params.jackknife;
+
+        // Convert separations into squared chord lengths on the unit sphere, which is
+        // a monotonic function of the separation
+        const double a2r = dpi/180.0/3600.0;
+        auto chord2 = [&](double a) {
+            a *= a2r;
+            if (a <= 0.0) return a;
+            if (a >= dpi) return 4.0 + (a - dpi);
+            return sqr(2.0*sin(0.5*a));
+        };
 
-        uint_t nbin = bins.dims[1];
-
-        vec1d dd(nbin);
-        vec1d dr(nbin);
-        vec1d rr(nbin);
+        vec2d cbins(2, nbin);
+        double dmax2 = 0.0;
+        for (uint_t b : range(nbin)) {
+            cbins.safe(0,b) = chord2(bins.safe(0,b));
+            cbins.safe(1,b) = chord2(bins.safe(1,b));
+            dmax2 = std::max(dmax2, cbins.safe(1,b));
+        }
 
-        for (uint_t i : range(ra)) {
-            vec1d d = angdist(ra, dec, ra[i], dec[i]);
-            dd += histogram(d, bins);
+        impl::bin_finder<double> find(cbins);
+
+        // Project positions on the unit sphere
+        vec1d dx, dy, dz, rx, ry, rz;
+        vec1u did, rid;
+        project(ra, dec, dx, dy, dz, did);
+        project(rra, rdec, rx, ry, rz, rid);
+
+        // Jackknife regions
+        vec1u djack = replicate(0u, did.size());
+        vec1u rjack = replicate(0u, rid.size());
+        if (njack != 0) {
+            vif_check(rid.size() >= njack, "need at least as many random positions as "
+                "jackknife regions (", rid.size(), " vs. ", njack, ")");
+
+            vec1d tra = rra[rid], tdec = rdec[rid];
+            jackknife_t jk(tra, tdec, njack);
+            rjack = jk.region(tra, tdec);
+            djack = jk.region(ra[did], dec[did]);
+        }
 
-            d = angdist(rra, rdec, ra[i], dec[i]);
-            dr += histogram(d, bins);
+        // Build the grid
+        grid_t g;
+        if (!dx.empty() || !rx.empty()) {
+            vec1d ax = dx, ay = dy, az = dz;
+            append(ax, rx); append(ay, ry); append(az, rz);
+            g.x0 = min(ax); g.y0 = min(ay); g.z0 = min(az);
+            double span = std::max({max(ax) - g.x0, max(ay) - g.y0, max(az) - g.z0});
+
+            // Keep the number of cells along each axis reasonable
+            g.csize = std::max({sqrt(dmax2), span/(1 << 20), 1e-12});
+            g.nx = uint_t((max(ax) - g.x0)/g.csize) + 1;
+            g.ny = uint_t((max(ay) - g.y0)/g.csize) + 1;
+            g.nz = uint_t((max(az) - g.z0)/g.csize) + 1;
         }
 
-        for (uint_t i : range(rra)) {
-            vec1d d = angdist(rra, rdec, rra[i], rdec[i]);
-            rr += histogram(d, bins);
+        cells_t dcells = make_cells(g, dx, dy, dz, djack);
+        cells_t rcells = make_cells(g, rx, ry, rz, rjack);
+
+        const uint_t nthread = std::max(params.thread, uint_t(1));
+        counts_t cdd = count_pairs(g, dcells, dcells, true,  find, dmax2, njack, nthread);
+        counts_t cdr = count_pairs(g, dcells, rcells, false, find, dmax2, njack, nthread);
+        counts_t crr = count_pairs(g, rcells, rcells, true,  find, dmax2, njack, nthread);
+
+        angcorrel_res res;
+        res.dd = cdd.pairs;
+        res.dr = cdr.pairs;
+        res.rr = crr.pairs;
+
+        const uint_t self = find(0.0);
+        const double nd = ra.size(), nr = rra.size();
+        res.w = landy_szalay(res.dd, res.dr, res.rr, nd, nr, self, did.size(), rid.size());
+
+        if (njack != 0) {
+            res.w_jack.resize(njack, nbin);
+            for (uint_t k : range(njack)) {
+                vec1d jdd = res.dd - cdd.touch(k,_);
+                vec1d jdr = res.dr - cdr.touch(k,_);
+                vec1d jrr = res.rr - crr.touch(k,_);
+                uint_t djk = count(djack == k), rjk = count(rjack == k);
+                res.w_jack(k,_) = landy_szalay(jdd, jdr, jrr, nd - djk, nr - rjk, self,
+                    did.size() - djk, rid.size() - rjk);
+            }
+
+            res.w_err.resize(nbin);
+            for (uint_t b : range(nbin)) {
+                vec1d wj = res.w_jack(_,b);
+                res.w_err.safe[b] = sqrt((njack - 1.0)/njack*total(sqr(wj - mean(wj))));
+            }
         }
 
-        double norm1 = rra.size()/double(ra.size());
-        double norm2 = norm1*((rra.size() - 1.0)/(ra.size() - 1.0));
-        return ((dd*norm2 - dr*norm1) + (rr - dr*norm1))/rr;
+        return res;
+    }
+
+    template<std::size_t N1, typename TR1, typename TD1,
+        std::size_t N2, typename TR2, typename TD2, typename TB>
+    vec1d angcorrel(const vec<N1,TR1>& ra, const vec<N1,TD1>& dec,
+        const vec<N2,TR2>& rra, const vec<N2,TD2>& rdec, const vec<2,TB>& bins) {
+        return angcorrel(ra, dec, rra, rdec, bins, angcorrel_params{}).w;
     }
 
     struct randpos_status {
@@ -147,6 +147,57 @@ namespace astro {
         }
 
     private :
+        // Spatial indices of the master catalog: one for its first 'nindexed_' sources, and
+        // one for the sources added after them. The first one is only rebuilt when the
+        // second becomes too large, so the whole master catalog is not re-indexed each time
+        // a new catalog is added. Sources of the master catalog are only ever appended.
+        qxmatch_index index_, new_index_;
+        uint_t nindexed_ = 0;
+
+        // Same as qxmatch(cra, cdec, ra, dec) with nth = 2
+        qxmatch_res match_master_(const vec1d& cra, const vec1d& cdec) {
+            const uint_t nnew = ra.size() - nindexed_;
+            if (nindexed_ == 0 || nnew > nindexed_/4) {
+                index_.build(ra, dec);
+                nindexed_ = ra.size();
+                new_index_ = qxmatch_index();
+            } else if (nnew != new_index_.size()) {
+                new_index_.build(ra[nindexed_-_], dec[nindexed_-_]);
+            }
+
+            qxmatch_params p; p.nth = 2; p.thread = 4; p.verbose = true;
+            qxmatch_res xm = index_.match(cra, cdec, p);
+
+            if (!new_index_.empty()) {
+                // Insert the matches among the newest sources
+                qxmatch_res xn = new_index_.match(cra, cdec, p);
+                const uint_t nth = xm.id.dims[0];
+                for (uint_t i : range(cra)) {
+                    for (uint_t l : range(nth)) {
+                        if (!(xn.d.safe(l,i) < xm.d.safe(nth-1,i))) break;
+
+                        xm.d.safe(nth-1,i) = xn.d.safe(l,i);
+                        xm.id.safe(nth-1,i) = xn.id.safe(l,i) + nindexed_;
+                        uint_t k = nth-2;
+                        while (k != npos && xm.d.safe(k,i) > xm.d.safe(k+1,i)) {
+                            std::swap(xm.d.safe(k,i), xm.d.safe(k+1,i));
+                            std::swap(xm.id.safe(k,i), xm.id.safe(k+1,i));
+                            --k;
+                        }
+                    }
+                }
+            }
+
+            // Reverse match, the new catalog is only indexed once
+            qxmatch_index cindex(cra, cdec);
+            p.nth = 1;
+            qxmatch_res xr = cindex.match(ra, dec, p);
+            xm.rid = xr.id(0,_);
+            xm.rd = xr.d(0,_);
+
+            return xm;
+        }
+
         catalog_t& add_catalog_(const vec1d& cra, const vec1d& cdec, bool no_new, vec1u sel,
             const std::string& name, const vec1s& sources, const vec1s& files,
             const std::string& comment = "") {
@@ -191,8 +242,7 @@ namespace astro {
                 qxmatch_res xm;
 
                 if (rematch) {
-                    qxmatch_params p; p.nth = 2; p.thread = 4; p.verbose = true;
-                    xm = qxmatch(cra[sel], cdec[sel], ra, dec, p);
+                    xm = match_master_(cra[sel], cdec[sel]);
 
                     fits::write_table(file, ftable(
                         sel, ngal, xm.id, xm.d, xm.rid, xm.rd
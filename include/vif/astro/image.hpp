@@ -1,6 +1,7 @@
 #ifndef VIF_ASTRO_IMAGE_HPP
 #define VIF_ASTRO_IMAGE_HPP
 
+#include <memory>
 #include "vif/core/vec.hpp"
 #include "vif/core/error.hpp"
 #include "vif/core/range.hpp"
@@ -442,6 +443,9 @@ namespace astro {
             const auto kw = kernel.safe(kx, ky);
             if (kw == 0.0) continue;
 
+            // Kernel offsets larger than the map
+            if (kx >= hxsize + map.dims[0] || ky >= hysize + map.dims[1]) continue;
+
             uint_t x0 = (kx >= hxsize ? 0 : hxsize-kx);
             uint_t xn = map.dims[0] - (kx >= hxsize ? kx-hxsize : 0);
             uint_t y0 = (ky >= hysize ? 0 : hysize-ky);
@@ -455,6 +459,322 @@ namespace astro {
 
         return r;
     }
+}
+
+namespace impl {
+    namespace astro_impl {
+        // Factorize a convolution kernel as k(x,y) = u[x]*v[y], if possible (i.e., if it has
+        // rank one, as for Gaussian or boxcar kernels)
+        template<typename Type>
+        bool separate_kernel(const vec<2,Type>& kernel, vec1d& u, vec1d& v) {
+            // Use the largest element as pivot
+            uint_t ip = 0;
+            double kmax = 0.0;
+            for (uint_t i : range(kernel)) {
+                const double a = std::abs(double(kernel.safe[i]));
+                if (a > kmax) {
+                    kmax = a;
+                    ip = i;
+                }
+            }
+
+            if (kmax == 0.0 || !is_finite(kmax)) return false;
+
+            const uint_t x0 = ip/kernel.dims[1], y0 = ip%kernel.dims[1];
+            const double kp = kernel.safe(x0,y0);
+            u.resize(kernel.dims[0]);
+            v.resize(kernel.dims[1]);
+            for (uint_t x : range(u)) {
+                u.safe[x] = kernel.safe(x,y0);
+            }
+            for (uint_t y : range(v)) {
+                v.safe[y] = kernel.safe(x0,y)/kp;
+            }
+
+            // Check that the factorization is exact, up to rounding errors
+            const double tol = 1e-12*kmax;
+            for (uint_t x : range(u))
+            for (uint_t y : range(v)) {
+                if (!(std::abs(kernel.safe(x,y) - u.safe[x]*v.safe[y]) <= tol)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Direct convolution, r(x,y) = sum k(kx,ky)*map(x+hsx-kx,y+hsy-ky), assuming the map
+        // is 0 outside. Each output row is computed in one go, as a weighted sum of shifted
+        // rows of the map. The rows of the map that are needed are kept in a circular buffer,
+        // converted to double and padded with zeros.
+        template<typename Type, typename TypeK>
+        vec2d convolve_direct(const vec<2,Type>& map, const vec<2,TypeK>& kernel) {
+            const uint_t nx = map.dims[0], ny = map.dims[1];
+            const uint_t nkx = kernel.dims[0], nky = kernel.dims[1];
+            const uint_t hsx = nkx/2, hsy = nky/2;
+            const uint_t pny = ny + 2*hsy;
+
+            vec2d ring(nkx, pny);
+            auto load = [&](uint_t sx) {
+                double* row = ring.raw_data() + (sx%nkx)*pny + hsy;
+                for (uint_t y : range(ny)) {
+                    row[y] = map.safe(sx,y);
+                }
+            };
+
+            for (uint_t sx : range(std::min(hsx, nx))) {
+                load(sx);
+            }
+
+            vec2d r(map.dims);
+            std::vector<const double*> rows;
+            std::vector<double> w;
+            rows.reserve(kernel.size());
+            w.reserve(kernel.size());
+            for (uint_t x : range(nx)) {
+                if (x + hsx < nx) {
+                    load(x + hsx);
+                }
+
+                rows.clear();
+                w.clear();
+                for (uint_t kx : range(nkx)) {
+                    const int_t sx = int_t(x + hsx) - int_t(kx);
+                    if (sx < 0 || sx >= int_t(nx)) continue;
+
+                    const double* row = ring.raw_data() + (sx%nkx)*pny + 2*hsy;
+                    for (uint_t ky : range(nky)) {
+                        const double kw = kernel.safe(kx,ky);
+                        if (kw == 0.0) continue;
+
+                        rows.push_back(row - ky);
+                        w.push_back(kw);
+                    }
+                }
+
+                simd_impl::weighted_sum(rows.data(), w.data(), w.size(), r.raw_data() + x*ny, ny);
+            }
+
+            return r;
+        }
+
+        // Separable convolution, with a kernel k(x,y) = u[x]*v[y]: one pass of 1D convolution
+        // along each axis. The rows of the first pass are kept in a circular buffer, and
+        // computed only when needed by the second pass.
+        template<typename Type>
+        vec2d convolve_separable(const vec<2,Type>& map, const vec1d& u, const vec1d& v) {
+            const uint_t nx = map.dims[0], ny = map.dims[1];
+            const uint_t nkx = u.size(), nky = v.size();
+            const uint_t hsx = nkx/2, hsy = nky/2;
+
+            // First pass along the rows
+            vec1d prow(ny + 2*hsy);
+            vec2d ring(nkx, ny);
+            std::vector<const double*> prows(nky);
+            for (uint_t ky : range(nky)) {
+                prows[ky] = prow.raw_data() + 2*hsy - ky;
+            }
+
+            auto load = [&](uint_t sx) {
+                for (uint_t y : range(ny)) {
+                    prow.safe[y+hsy] = map.safe(sx,y);
+                }
+
+                double* row = ring.raw_data() + (sx%nkx)*ny;
+                std::fill(row, row + ny, 0.0);
+                simd_impl::weighted_sum(prows.data(), v.raw_data(), nky, row, ny);
+            };
+
+            for (uint_t sx : range(std::min(hsx, nx))) {
+                load(sx);
+            }
+
+            // Second pass along the columns
+            vec2d r(map.dims);
+            std::vector<const double*> rows;
+            std::vector<double> w;
+            for (uint_t x : range(nx)) {
+                if (x + hsx < nx) {
+                    load(x + hsx);
+                }
+
+                rows.clear();
+                w.clear();
+                for (uint_t kx : range(nkx)) {
+                    const int_t sx = int_t(x + hsx) - int_t(kx);
+                    if (sx < 0 || sx >= int_t(nx) || u.safe[kx] == 0.0) continue;
+
+                    rows.push_back(ring.raw_data() + (sx%nkx)*ny);
+                    w.push_back(u.safe[kx]);
+                }
+
+                simd_impl::weighted_sum(rows.data(), w.data(), w.size(), r.raw_data() + x*ny, ny);
+            }
+
+            return r;
+        }
+
+#ifndef NO_FFTW
+        // Place a convolution kernel in an array of dimensions 'dims', with the center of the
+        // kernel at (0,0) and wrapping around the edges, as needed for a Fourier convolution
+        template<typename Type>
+        vec2d wrap_kernel(const vec<2,Type>& kernel, const std::array<uint_t,2>& dims) {
+            vec2d tkernel(dims);
+            const int_t hsx = kernel.dims[0]/2, hsy = kernel.dims[1]/2;
+            const int_t nx = dims[0], ny = dims[1];
+            for (uint_t kx : range(kernel.dims[0]))
+            for (uint_t ky : range(kernel.dims[1])) {
+                const uint_t x = ((int_t(kx) - hsx) % nx + nx) % nx;
+                const uint_t y = ((int_t(ky) - hsy) % ny + ny) % ny;
+                tkernel.safe(x,y) += kernel.safe(kx,ky);
+            }
+
+            return tkernel;
+        }
+
+        // Dimensions of the padded map used for a Fourier convolution: the map is placed at
+        // (hsx,hsy), with at least 'hs' pixels of zeros on each side to avoid cyclic borders.
+        // The padding is then extended to a size for which the FFT is fast.
+        inline std::array<uint_t,2> convolve_padded_dims(const std::array<uint_t,2>& dims,
+            uint_t hsx, uint_t hsy) {
+            return {{fft_fast_size(dims[0]+2*hsx), fft_fast_size(dims[1]+2*hsy)}};
+        }
+
+        // Convolution of an image tile by tile, with the overlap-save method. Each output tile is
+        // computed from the input tile extended by the kernel half-size on each side: all the
+        // pixels affected by the cyclic borders of the FFT fall in this margin, and are dropped.
+        struct tiled_convolver {
+            std::array<uint_t,2> dims;  // dimensions of the image
+            std::array<uint_t,2> tdims; // dimensions of the tiles, including the margin
+            std::array<uint_t,2> step;  // dimensions of the tiles, without the margin
+            std::array<uint_t,2> ntile;
+            uint_t hsx = 0, hsy = 0;
+            bool mask_nan = false;
+            vec2cd kernel_fourier; // normalized, only the non-redundant half (see rfft())
+
+            // Tile buffers, kept for the next tiles (there is at most one per thread)
+            struct workspace {
+                vec2d tmap;
+                vec2cd cimg;
+            };
+
+            std::vector<std::unique_ptr<workspace>> pool;
+            std::mutex pool_mutex;
+
+            template<typename TypeK>
+            tiled_convolver(const vec<2,TypeK>& kernel, const std::array<uint_t,2>& d,
+                uint_t tile_size, bool mnan) : dims(d), mask_nan(mnan) {
+
+                vif_check(kernel.dims[0]%2 == 1 && kernel.dims[1]%2 == 1,
+                    "kernel must have odd dimensions (", kernel.dims, ")");
+
+                hsx = kernel.dims[0]/2; hsy = kernel.dims[1]/2;
+
+                // Use tiles at least twice larger than the margins, and no larger than needed
+                // to hold the whole padded image
+                std::array<uint_t,2> pdims = convolve_padded_dims(dims, hsx, hsy);
+                for (uint_t i : range(2)) {
+                    const uint_t hs = (i == 0 ? hsx : hsy);
+                    tdims[i] = std::min(fft_fast_size(std::max(tile_size, 4*hs+1)), pdims[i]);
+                    step[i] = tdims[i] - 2*hs;
+                    ntile[i] = (dims[i] + step[i] - 1)/step[i];
+                }
+
+                vec2d tkernel = wrap_kernel(kernel, tdims);
+                kernel_fourier.resize(tdims[0], tdims[1]/2+1);
+                fourier_impl::execute_r2c(tkernel, kernel_fourier);
+                kernel_fourier /= double(tkernel.size());
+            }
+
+            uint_t size() const {
+                return ntile[0]*ntile[1];
+            }
+
+            // Convolve the tile (it,jt). 'in' holds the rows of the input image starting from
+            // row 'in_x0' (rows that are not included are assumed to be zero), and 'out' the rows
+            // of the output image starting from row 'out_x0'. Different tiles can be convolved
+            // at the same time from different threads.
+            template<typename TypeI, typename TypeO>
+            void convolve_tile(uint_t it, uint_t jt, const vec<2,TypeI>& in, uint_t in_x0,
+                vec<2,TypeO>& out, uint_t out_x0) {
+
+                std::unique_ptr<workspace> w;
+                {
+                    std::lock_guard<std::mutex> lock(pool_mutex);
+                    if (pool.empty()) {
+                        w.reset(new workspace);
+                        w->tmap.resize(tdims);
+                        w->cimg.resize(kernel_fourier.dims);
+                    } else {
+                        w = std::move(pool.back());
+                        pool.pop_back();
+                    }
+                }
+
+                vec2d& tmap = w->tmap;
+                vec2cd& cimg = w->cimg;
+
+                // Copy the input tile and its margin
+                const uint_t ny = dims[1], tny = tdims[1];
+                const int_t x0 = int_t(it*step[0]) - int_t(hsx);
+                const int_t y0 = int_t(jt*step[1]) - int_t(hsy);
+                const int_t ix0 = in_x0, ix1 = in_x0 + in.dims[0];
+                const uint_t cy0 = std::max(y0, int_t(0));
+                const uint_t cy1 = std::min(y0 + int_t(tny), int_t(ny));
+                for (uint_t r : range(tdims[0])) {
+                    const int_t x = x0 + int_t(r);
+                    double* row = tmap.raw_data() + r*tny;
+                    if (x < ix0 || x >= ix1) {
+                        std::fill(row, row + tny, 0.0);
+                        continue;
+                    }
+
+                    const uint_t ii = (x - ix0)*ny;
+                    std::fill(row, row + (cy0 - y0), 0.0);
+                    double* dst = row + (cy0 - y0);
+                    for (uint_t y = cy0; y < cy1; ++y, ++dst) {
+                        const double v = in.safe[ii+y];
+                        *dst = (mask_nan && !is_finite(v) ? 0.0 : v);
+                    }
+                    std::fill(dst, row + tny, 0.0);
+                }
+
+                // Perform the convolution in Fourier space
+                fourier_impl::execute_r2c(tmap, cimg);
+                for (uint_t i : range(cimg)) {
+                    cimg.safe[i] *= kernel_fourier.safe[i];
+                }
+                fourier_impl::execute_c2r(cimg, tmap);
+
+                // Copy the output tile, without the margin
+                const uint_t ox0 = it*step[0], ox1 = std::min(dims[0], ox0 + step[0]);
+                const uint_t oy0 = jt*step[1], oy1 = std::min(ny, oy0 + step[1]);
+                for (uint_t x = ox0; x < ox1; ++x) {
+                    const double* src = tmap.raw_data() + (x - ox0 + hsx)*tny + hsy;
+                    const uint_t io = (x - out_x0)*ny;
+                    for (uint_t y = oy0; y < oy1; ++y) {
+                        out.safe[io+y] = src[y-oy0];
+                    }
+
+                    if (mask_nan) {
+                        const uint_t ii = (x - in_x0)*ny;
+                        for (uint_t y = oy0; y < oy1; ++y) {
+                            if (!is_finite(in.safe[ii+y])) {
+                                out.safe[io+y] = dnan;
+                            }
+                        }
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                pool.push_back(std::move(w));
+            }
+        };
+#endif
+    }
+}
+
+namespace astro {
 
     // Perform the convolution of two 2D arrays, assuming the second one is the kernel.
     // Note: If the FFTW library is not used, falls back to convolve2d_naive().
@@ -471,13 +791,10 @@ namespace astro {
 
         hsx = kernel.dims[0]/2; hsy = kernel.dims[1]/2;
 
-        // Resize kernel to map size, with kernel center at (0,0), and some padding
-        // to avoid cyclic borders (assume image is 0 outside)
-        vec2d tkernel = enlarge(kernel, {{0, 0, map.dims[0]-1, map.dims[1]-1}});
-        inplace_shift(tkernel, -hsx, -hsy);
-
-        // Put the kernel in Fourier space
-        return fft(tkernel);
+        // Resize kernel to padded map size, with kernel center at (0,0) (padding avoids
+        // cyclic borders, assuming the image is 0 outside), and put it in Fourier space
+        return rfft(impl::astro_impl::wrap_kernel(kernel,
+            impl::astro_impl::convolve_padded_dims(map.dims, hsx, hsy)));
 #endif
     }
 
@@ -491,68 +808,139 @@ namespace astro {
         return map;
 #else
         // Pad image to prevent issues with cyclic borders
-        vec2d tmap = enlarge(map, {{hsx, hsy, hsx, hsy}});
+        // NB: kernels computed with fft() instead of rfft() store the same values in their
+        // first elements, so both are accepted; these were padded without extension
+        std::array<uint_t,2> pdims = impl::astro_impl::convolve_padded_dims(map.dims, hsx, hsy);
+        if (kernel.dims[0] == map.dims[0]+2*hsx && kernel.dims[1] == map.dims[1]+2*hsy) {
+            pdims = kernel.dims;
+        }
+
+        vif_check(kernel.dims[0] == pdims[0] &&
+            (kernel.dims[1] == pdims[1]/2+1 || kernel.dims[1] == pdims[1]),
+            "incompatible kernel dimensions (", kernel.dims, " vs. ", pdims, ")");
+
+        vec2d tmap = enlarge(map, {{hsx, hsy, pdims[0]-map.dims[0]-hsx,
+            pdims[1]-map.dims[1]-hsy}});
 
         // Perform the convolution in Fourier space
-        auto cimg = fft(tmap)*kernel;
+        vec2cd cimg = rfft(tmap);
+
+        const double norm = 1.0/tmap.size();
+        for (uint_t i : range(cimg)) {
+            cimg.safe[i] *= kernel.safe[i]*norm;
+        }
 
         // Go back to real space and shrink map back to original dimensions
-        return shrink(ifft(cimg), {{hsx, hsy, hsx, hsy}})/cimg.size();
+        irfft(std::move(cimg), tmap);
+        return shrink(tmap, {{hsx, hsy, pdims[0]-map.dims[0]-hsx, pdims[1]-map.dims[1]-hsy}});
 #endif
     }
 
+    enum class convolve2d_method {
+        automatic, // pick the fastest of the methods below, from a rough estimate of their cost
+        fft,       // product in Fourier space (requires the FFTW library)
+        direct,    // direct sum over the kernel, for small kernels
+        separable  // two passes of 1D convolution, for kernels of the form k(x,y) = u[x]*v[y]
+    };
+
     // Perform the convolution of two 2D arrays, assuming the second one is the kernel.
-    // Note: If the FFTW library is not used, falls back to convolve2d_naive().
     template<typename TypeY1, typename TypeY2>
-    auto convolve2d(const vec<2,TypeY1>& map, const vec<2,TypeY2>& kernel) ->
-        vec<2,decltype(map[0]*kernel[0])> {
-#ifdef NO_FFTW
-        return convolve2d_naive(map, kernel);
-#else
-        // vif_check(kernel.dims[0]%2 == 1 && kernel.dims[1]%2 == 1,
-        //     "kernel must have odd dimensions (", kernel.dims, ")");
+    auto convolve2d(const vec<2,TypeY1>& map, const vec<2,TypeY2>& kernel,
+        convolve2d_method method) -> vec<2,decltype(map[0]*kernel[0])> {
 
-        uint_t hsx = kernel.dims[0]/2, hsy = kernel.dims[1]/2;
+        using rtype = decltype(map[0]*kernel[0]);
 
-        // Pad image to prevent issues with cyclic borders
-        vec2d tmap = enlarge(map, {{hsx, hsy, hsx, hsy}});
+        vec1d u, v;
+        bool separable = impl::astro_impl::separate_kernel(kernel, u, v);
 
-        // Resize kernel to map size, with kernel center at (0,0)
-        vec2d tkernel(tmap.dims);
+        if (method == convolve2d_method::automatic) {
+            // Number of operations of each method (up to similar constant factors)
+            const double npix = double(map.dims[0])*map.dims[1];
+            double cdirect = npix*count(kernel != 0.0);
+            double cseparable = (separable ? npix*(kernel.dims[0] + kernel.dims[1]) : dinf);
+#ifdef NO_FFTW
+            double cfft = dinf;
+#else
+            uint_t hsx = kernel.dims[0]/2, hsy = kernel.dims[1]/2;
+            const double npad = double(fft_fast_size(map.dims[0]+2*hsx))*
+                fft_fast_size(map.dims[1]+2*hsy);
+            double cfft = 4.0*npad*std::log2(npad);
+#endif
 
-        // TODO: optimize this and catch case where kernel is larger than image
-        vec1u px1 = hsx + indgen<uint_t>(hsx);
-        vec1u py1 = hsy + indgen<uint_t>(hsy);
-        vec1u px2 = hsx - 1 - indgen<uint_t>(hsx);
-        vec1u py2 = hsy - 1 - indgen<uint_t>(hsy);
+            if (cseparable <= cdirect && cseparable <= cfft) {
+                method = convolve2d_method::separable;
+            } else if (cdirect <= cfft) {
+                method = convolve2d_method::direct;
+            } else {
+                method = convolve2d_method::fft;
+            }
+        }
 
-        vec1u ix1 = indgen<uint_t>(hsx);
-        vec1u iy1 = indgen<uint_t>(hsy);
-        vec1u ix2 = tmap.dims[0] - 1 - indgen<uint_t>(hsx);
-        vec1u iy2 = tmap.dims[1] - 1 - indgen<uint_t>(hsy);
+        switch (method) {
+        case convolve2d_method::separable : {
+            vif_check(separable, "kernel is not separable, cannot use convolve2d_method::separable");
+            return vec<2,rtype>(impl::astro_impl::convolve_separable(map, u, v));
+        }
+        case convolve2d_method::direct : {
+            return vec<2,rtype>(impl::astro_impl::convolve_direct(map, kernel));
+        }
+        default : {
+#ifdef NO_FFTW
+            vif_check(false, "convolve2d_method::fft requires the FFTW library");
+            return vec<2,rtype>();
+#else
+            // Pad image to prevent issues with cyclic borders
+            uint_t hsx = kernel.dims[0]/2, hsy = kernel.dims[1]/2;
+            std::array<uint_t,2> pdims = impl::astro_impl::convolve_padded_dims(map.dims, hsx, hsy);
+            vec2d tmap = enlarge(map, {{hsx, hsy, pdims[0]-map.dims[0]-hsx,
+                pdims[1]-map.dims[1]-hsy}});
 
-        tkernel(ix1,iy1) = kernel(px1,py1);
-        tkernel(ix2,iy1) = kernel(px2,py1);
-        tkernel(ix1,iy2) = kernel(px1,py2);
-        tkernel(ix2,iy2) = kernel(px2,py2);
+            // Resize kernel to map size, with kernel center at (0,0)
+            vec2cd ckernel = rfft(impl::astro_impl::wrap_kernel(kernel, tmap.dims));
 
-        // Perform the convolution in Fourier space
-        auto cimg = fft(tmap)*fft(tkernel);
+            // Perform the convolution in Fourier space
+            vec2cd cimg = rfft(tmap);
+            const double norm = 1.0/tmap.size();
+            for (uint_t i : range(cimg)) {
+                cimg.safe[i] *= ckernel.safe[i]*norm;
+            }
 
-        // Go back to real space and shrink map back to original dimensions
-        return shrink(ifft(cimg), {{hsx, hsy, hsx, hsy}})/cimg.size();
+            // Go back to real space and shrink map back to original dimensions
+            irfft(std::move(cimg), tmap);
+            return vec<2,rtype>(shrink(tmap, {{hsx, hsy, pdims[0]-map.dims[0]-hsx,
+                pdims[1]-map.dims[1]-hsy}}));
 #endif
+        }
+        }
+    }
+
+    // Perform the convolution of two 2D arrays, assuming the second one is the kernel. The
+    // fastest method is chosen automatically: FFT for large kernels, and direct or separable
+    // sums for small ones (see convolve2d_method).
+    template<typename TypeY1, typename TypeY2>
+    auto convolve2d(const vec<2,TypeY1>& map, const vec<2,TypeY2>& kernel) ->
+        vec<2,decltype(map[0]*kernel[0])> {
+        return convolve2d(map, kernel, convolve2d_method::automatic);
+    }
+
+    // Perform the convolution of a 2D array with a separable kernel k(x,y) = kx[x]*ky[y].
+    template<typename TypeY1, typename TypeX, typename TypeY>
+    vec2d convolve2d_separable(const vec<2,TypeY1>& map, const vec<1,TypeX>& kx,
+        const vec<1,TypeY>& ky) {
+        return impl::astro_impl::convolve_separable(map, vec1d(kx), vec1d(ky));
     }
 
 #ifndef NO_FFTW
+    // Convolve many maps of the same size with the same kernel. The kernel is only transformed
+    // once, and inplace_convolve() reuses the same buffers: nothing is allocated after the
+    // first call (unless the dimensions of the map change).
     struct convolver2d {
         const vec2d& kernel_normal;
-        vec2cd kernel_fourier;
+        vec2cd kernel_fourier; // normalized, only the non-redundant half (see rfft())
         uint_t hsx = 0, hsy = 0;
-        fftw_plan pf, pi;
-        bool pf_built = false, pi_built = false;
         vec2d tmap;
         vec2cd cimg;
+        std::array<uint_t,2> map_dims = {{0, 0}};
 
         bool cyclic = false;
 
@@ -566,146 +954,78 @@ namespace astro {
         convolver2d(convolver2d&&) = default;
         convolver2d& operator=(convolver2d&&) = default;
 
-        ~convolver2d() {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            if (pf_built) {
-                fftw_destroy_plan(pf);
-            }
-            if (pi_built) {
-                fftw_destroy_plan(pi);
-            }
-        }
-
     private :
-        void make_plan(const vec2d& v, vec2cd& r) {
-            if (!pf_built) {
-                std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-                pf = fftw_plan_dft_r2c_2d(v.dims[0], v.dims[1],
-                    const_cast<double*>(v.raw_data()),
-                    reinterpret_cast<fftw_complex*>(r.raw_data()), FFTW_ESTIMATE);
-                pf_built = true;
-            }
+        void fft(const vec2d& v, vec2cd& r) {
+            impl::fourier_impl::execute_r2c(v, r);
         }
 
-        void make_plan(vec2cd& v, vec2d& r) {
-            if (!pi_built) {
-                std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-                pi = fftw_plan_dft_c2r_2d(v.dims[0], v.dims[1],
-                    reinterpret_cast<fftw_complex*>(v.raw_data()),
-                    r.raw_data(), FFTW_ESTIMATE);
-                pi_built = true;
-            }
+        // Compute the inverse Fast Fourier Transform (FFT) of the provided 2d array
+        // NB: the input array is destroyed
+        void ifft(vec2cd& v, vec2d& r) {
+            impl::fourier_impl::execute_c2r(v, r);
         }
 
-        void fft(const vec2d& v, vec2cd& r) {
-            make_plan(v, r);
-
-            fftw_execute_dft_r2c(pf,
-                const_cast<double*>(v.raw_data()),
-                reinterpret_cast<fftw_complex*>(r.raw_data())
-            );
-        }
+        void prepare(const std::array<uint_t,2>& dims) {
+            map_dims = dims;
 
-        vec2cd fft(const vec2d& v) {
-            vec2cd r(v.dims);
-            fft(v, r);
-            return r;
-        }
+            std::array<uint_t,2> pdims = dims;
+            if (cyclic) {
+                hsx = 0; hsy = 0;
+            } else {
+                // Add some padding to avoid cyclic borders (assume image is 0 outside)
+                hsx = kernel_normal.dims[0]/2; hsy = kernel_normal.dims[1]/2;
+                pdims = impl::astro_impl::convolve_padded_dims(dims, hsx, hsy);
+                tmap.resize(pdims);
+            }
 
-        // Compute the Fast Fourier Transform (FFT) of the provided 2d array
-        void ifft(vec2cd& v, vec2d& r) {
-            make_plan(v, r);
+            // Resize kernel to padded map size, with kernel center at (0,0), and put it in
+            // Fourier space, including the normalization of the inverse transform
+            vec2d tkernel = impl::astro_impl::wrap_kernel(kernel_normal, pdims);
+            kernel_fourier.resize(pdims[0], pdims[1]/2+1);
+            this->fft(tkernel, kernel_fourier);
+            kernel_fourier /= double(tkernel.size());
 
-            fftw_execute_dft_c2r(pi,
-                reinterpret_cast<fftw_complex*>(v.raw_data()),
-                r.raw_data()
-            );
+            cimg.resize(kernel_fourier.dims);
         }
 
-        // Compute the Fast Fourier Transform (FFT) of the provided 2d array
-        vec2d ifft(vec2cd& v) {
-            vec2d r(v.dims);
-            ifft(v, r);
-            return r;
+        void multiply() {
+            for (uint_t i : range(cimg)) {
+                cimg.safe[i] *= kernel_fourier.safe[i];
+            }
         }
 
     public :
         void inplace_convolve(vec2d& map) {
-            if (kernel_fourier.empty()) {
-                if (cyclic) {
-                    hsx = 0; hsy = 0;
-
-                    // Resize kernel to map size, with kernel center at (0,0)
-                    vec2d tkernel = recenter(
-                        kernel_normal, kernel_normal.dims[0]/2, kernel_normal.dims[1]/2, map.dims
-                    );
-                    inplace_shift(tkernel, -int_t(map.dims[0])/2, -int_t(map.dims[1])/2);
-
-                    // Put the kernel in Fourier space
-                    kernel_fourier = this->fft(tkernel);
-
-                    cimg.resize(map.dims);
-                } else {
-                    hsx = kernel_normal.dims[0]/2; hsy = kernel_normal.dims[1]/2;
-
-                    // Resize kernel to map size, with kernel center at (0,0), and some padding
-                    // to avoid cyclic borders (assume image is 0 outside)
-                    vec2d tkernel = enlarge(kernel_normal, {{0, 0, map.dims[0]-1, map.dims[1]-1}});
-                    inplace_shift(tkernel, -int_t(hsx), -int_t(hsy));
-
-                    // Put the kernel in Fourier space
-                    kernel_fourier = this->fft(tkernel);
-
-                    tmap.resize(kernel_fourier.dims);
-                    cimg.resize(kernel_fourier.dims);
-                }
+            if (kernel_fourier.empty() || map.dims != map_dims) {
+                prepare(map.dims);
             }
 
             if (cyclic) {
-                // Copy image data
-                tmap = std::move(map);
+                // Perform the convolution in Fourier space, directly from and to the map
+                this->fft(map, cimg);
+                multiply();
+                this->ifft(cimg, map);
             } else {
-                // Copy image data
-                for (uint_t ix : range(map.dims[0]))
-                for (uint_t iy : range(map.dims[1])) {
-                    tmap.safe(hsx+ix,hsy+iy) = map.safe(ix,iy);
-                }
-
-                // Pad image to prevent issues with cyclic borders
-                for (uint_t ix : range(hsx)) {
-                    for (uint_t iy : range(tmap.dims[0])) {
-                        tmap.safe(ix,iy) = 0;
-                    }
-                    for (uint_t iy : range(tmap.dims[0])) {
-                        tmap.safe(tmap.dims[0]-hsx+ix,iy) = 0;
-                    }
-                }
-
-                for (uint_t ix : range(map.dims[0])) {
-                    for (uint_t iy : range(hsy)) {
-                        tmap.safe(hsx+ix,iy) = 0;
-                    }
-                    for (uint_t iy : range(hsy)) {
-                        tmap.safe(hsx+ix,tmap.dims[1]-hsy+iy) = 0;
-                    }
+                // Copy image data, and pad image to prevent issues with cyclic borders
+                const uint_t nx = map.dims[0], ny = map.dims[1], pny = tmap.dims[1];
+                std::fill(tmap.begin(), tmap.begin() + hsx*pny, 0.0);
+                for (uint_t ix : range(nx)) {
+                    auto row = tmap.begin() + (hsx+ix)*pny;
+                    std::fill(row, row + hsy, 0.0);
+                    std::copy(map.begin() + ix*ny, map.begin() + (ix+1)*ny, row + hsy);
+                    std::fill(row + hsy + ny, row + pny, 0.0);
                 }
-            }
+                std::fill(tmap.begin() + (hsx+nx)*pny, tmap.end(), 0.0);
 
-            // Perform the convolution in Fourier space
-            this->fft(tmap, cimg);
-            cimg *= kernel_fourier;
+                // Perform the convolution in Fourier space
+                this->fft(tmap, cimg);
+                multiply();
 
-            // Go back to real space
-            this->ifft(cimg, tmap);
-
-            if (cyclic) {
-                // Copy image data
-                map = std::move(tmap);
-            } else {
-                // Copy image data and shrink back to original dimensions
-                for (uint_t ix : range(map.dims[0]))
-                for (uint_t iy : range(map.dims[1])) {
-                    map.safe(ix,iy) = tmap.safe(hsx+ix,hsy+iy)/cimg.size();
+                // Go back to real space and shrink back to original dimensions
+                this->ifft(cimg, tmap);
+                for (uint_t ix : range(nx)) {
+                    auto row = tmap.begin() + (hsx+ix)*pny + hsy;
+                    std::copy(row, row + ny, map.begin() + ix*ny);
                 }
             }
         }
@@ -733,6 +1053,43 @@ namespace astro {
         return convolver2d(k);
     }
 
+    struct convolve2d_tiled_params {
+        // Size of the tiles, including the margins needed by the kernel. The actual size is
+        // rounded up to a size for which the FFT is fast.
+        uint_t tile_size = 2048;
+        uint_t thread = 1;
+        bool verbose = false;
+        // Treat non-finite pixels as zero, and set them back to NaN in the output
+        bool mask_nan = false;
+    };
+
+    // Perform the convolution of two 2D arrays, assuming the second one is the kernel. The map is
+    // convolved tile by tile (overlap-save method) and the tiles are processed in parallel. The
+    // result is the same as convolve2d(), but the full padded map and its Fourier transform are
+    // never stored in memory.
+    // Note: If the FFTW library is not used, falls back to convolve2d_naive().
+    template<typename TypeY1, typename TypeY2>
+    auto convolve2d_tiled(const vec<2,TypeY1>& map, const vec<2,TypeY2>& kernel,
+        const convolve2d_tiled_params& p = convolve2d_tiled_params{}) ->
+        vec<2,decltype(map[0]*kernel[0])> {
+#ifdef NO_FFTW
+        return convolve2d_naive(map, kernel);
+#else
+        impl::astro_impl::tiled_convolver conv(kernel, map.dims, p.tile_size, p.mask_nan);
+
+        vec<2,decltype(map[0]*kernel[0])> r(map.dims);
+
+        thread::parallel_for pfor(p.thread);
+        pfor.verbose = p.verbose;
+        pfor.chunk_size = 1;
+        pfor.execute([&](uint_t i) {
+            conv.convolve_tile(i/conv.ntile[1], i%conv.ntile[1], map, 0, r, 0);
+        }, conv.size());
+
+        return r;
+#endif
+    }
+
     // Perform the convolution of two 2D arrays, assuming the second one is the kernel.
     // Note: If the FFTW library is not used, falls back to convolve2d_naive().
     template<typename T = void>
@@ -1848,6 +2205,35 @@ namespace impl {
         inline void apply_weights(vec2d& res, const vec2d& wei) {
             res /= wei;
         }
+
+        inline void add_subset(const vec3d& sub, vec3d& res, uint_t x0, uint_t y0) {
+            for (uint_t i : range(sub.dims[0]))
+            for (uint_t iy : range(sub.dims[1]))
+            for (uint_t ix : range(sub.dims[2])) {
+                res.safe(i,y0+iy,x0+ix) += sub.safe(i,iy,ix);
+            }
+        }
+
+        inline void add_subset(const vec2d& sub, vec2d& res, uint_t x0, uint_t y0) {
+            for (uint_t iy : range(sub.dims[0]))
+            for (uint_t ix : range(sub.dims[1])) {
+                res.safe(y0+iy,x0+ix) += sub.safe(iy,ix);
+            }
+        }
+
+#ifndef NO_WCSLIB
+        // Project a set of (0-based) pixel coordinates from the image of WCS 'from' onto that of
+        // WCS 'to', with a single batched call to wcslib in each direction.
+        // Note: wcslib finishes setting up its structures on the first transform, and only reads
+        // them afterwards; make one call on the calling thread before sharing 'from' and 'to'.
+        inline void regrid_project(const astro::wcs& from, const astro::wcs& to,
+            const vec1d& sx, const vec1d& sy, vec1d& dx, vec1d& dy) {
+            vec1d ra, dec;
+            astro::xy2ad(from, sx+1.0, sy+1.0, ra, dec);
+            astro::ad2xy(to, ra, dec, dx, dy);
+            dx -= 1.0; dy -= 1.0;
+        }
+#endif
     }
 }
 
@@ -1864,6 +2250,7 @@ namespace astro {
         bool conserve_flux = false;
         interpolation_method method = interpolation_method::linear;
         bool linearize = false;    // approximation: assume WCS transform is linear
+        uint_t thread = 1;         // number of threads to use
     };
 
     template<typename T = double>
@@ -1889,7 +2276,8 @@ namespace astro {
         //   (plx,ply)[i]     (plx,ply)[i+1]    # y_(j-0.5)
         //   # x_(i-0.5)      # x_(i+0.5)
         // To avoid re-computing stuff, pux and puy are moved into plx and ply
-        // on each 'y' iteration for reuse.
+        // on each 'y' iteration for reuse. Each line of the grid is projected with a single
+        // call to wcslib, and lines are split into bands processed by separate threads.
 
         auto s2d_wcs = [&](double sx, double sy, double& dx, double& dy) {
             double tra, tdec;
@@ -1902,7 +2290,7 @@ namespace astro {
         double csx = nx/2;
         double csy = ny/2;
         double cdx, cdy, cdx1, cdy1, cdx2, cdy2;
-        double pixel_area;
+        double pixel_area = dnan;
         if (opts.linearize) {
             s2d_wcs(csx, csy,     cdx,  cdy);
             s2d_wcs(csx+1.0, csy, cdx1, cdy1);
@@ -1933,75 +2321,95 @@ namespace astro {
             }
         }
 
-        auto s2d = [&](double sx, double sy, double& dx, double& dy) {
+        auto s2d = [&](const vec1d& sx, const vec1d& sy, vec1d& dx, vec1d& dy) {
             if (opts.linearize) {
-                dx = (sx-csx)*cdx1 + (sy-csy)*cdx2 + cdx;
-                dy = (sx-csx)*cdy1 + (sy-csy)*cdy2 + cdy;
+                dx.resize(sx.dims);
+                dy.resize(sx.dims);
+                for (uint_t i : range(sx)) {
+                    dx.safe[i] = (sx.safe[i]-csx)*cdx1 + (sy.safe[i]-csy)*cdx2 + cdx;
+                    dy.safe[i] = (sx.safe[i]-csx)*cdy1 + (sy.safe[i]-csy)*cdy2 + cdy;
+                }
             } else {
-                s2d_wcs(sx, sy, dx, dy);
+                impl::astro_impl::regrid_project(astrod, astros, sx, sy, dx, dy);
             }
         };
 
-        auto pg = progress_start(res.size());
-        vec1d plx(nx+1);
-        vec1d ply(nx+1);
-        for (uint_t ix : range(nx+1)) {
-            s2d(ix-0.5, -0.5, plx.safe[ix], ply.safe[ix]);
+        // Split the lines of the new grid into bands, each band starts by projecting
+        // its own lower edge
+        uint_t nband = (opts.thread <= 1 ? 1 : std::min(ny, 32*opts.thread));
+        if (nband > 1 && !opts.linearize) {
+            // Let wcslib finish its setup before sharing the WCS between threads
+            double tdx, tdy;
+            s2d_wcs(csx, csy, tdx, tdy);
         }
 
-        vec1d pux(nx+1);
-        vec1d puy(nx+1);
-        for (uint_t iy : range(ny)) {
-            for (uint_t ix : range(nx+1)) {
-                s2d(ix-0.5, iy+0.5, pux.safe[ix], puy.safe[ix]);
-            }
+        auto pg = progress_start(ny);
+        auto do_band = [&](uint_t ib) {
+            uint_t y0 = (ib*ny)/nband;
+            uint_t y1 = ((ib+1)*ny)/nband;
 
-            for (uint_t ix : range(nx)) {
-                // Find projection of each pixel of the new grid on the original image
-                // NB: assumes the astrometry is such that this projection is
-                // reasonably approximated by a 4-edge polygon (i.e.: varying pixel scales,
-                // pixel offsets and rotations are fine, but weird things may happen close
-                // to the poles of the projection where things become non-linear)
-
-                double xps = 0.25*(plx.safe[ix] + plx.safe[ix+1] + pux.safe[ix+1] + pux.safe[ix]);
-                double yps = 0.25*(ply.safe[ix] + ply.safe[ix+1] + puy.safe[ix+1] + puy.safe[ix]);
-
-                double flx = 0.0;
-                bool covered = false;
-
-                switch (opts.method) {
-                case interpolation_method::nearest:
-                    covered = impl::astro_impl::regrid_nearest(imgs, xps, yps, flx);
-                    break;
-                case interpolation_method::linear:
-                    covered = impl::astro_impl::regrid_linear(imgs, xps, yps, flx);
-                    break;
-                case interpolation_method::cubic:
-                    covered = impl::astro_impl::regrid_cubic(imgs, xps, yps, flx);
-                    break;
-                }
+            double parea = pixel_area;
+            vec1d gx = indgen<double>(nx+1) - 0.5;
+            vec1d gy = replicate(y0-0.5, nx+1);
+            vec1d plx, ply, pux, puy;
+            s2d(gx, gy, plx, ply);
 
-                if (covered) {
-                    if (opts.conserve_flux) {
-                        if (!opts.linearize) {
-                            pixel_area = impl::astro_impl::polyon_area(
-                                {plx.safe[ix], plx.safe[ix+1], pux.safe[ix+1], pux.safe[ix]},
-                                {ply.safe[ix], ply.safe[ix+1], puy.safe[ix+1], puy.safe[ix]}
-                            );
-                        }
+            for (uint_t iy : range(y0, y1)) {
+                gy[_] = iy+0.5;
+                s2d(gx, gy, pux, puy);
 
-                        flx *= pixel_area;
+                for (uint_t ix : range(nx)) {
+                    // Find projection of each pixel of the new grid on the original image
+                    // NB: assumes the astrometry is such that this projection is
+                    // reasonably approximated by a 4-edge polygon (i.e.: varying pixel scales,
+                    // pixel offsets and rotations are fine, but weird things may happen close
+                    // to the poles of the projection where things become non-linear)
+
+                    double xps = 0.25*(plx.safe[ix] + plx.safe[ix+1] + pux.safe[ix+1] + pux.safe[ix]);
+                    double yps = 0.25*(ply.safe[ix] + ply.safe[ix+1] + puy.safe[ix+1] + puy.safe[ix]);
+
+                    double flx = 0.0;
+                    bool covered = false;
+
+                    switch (opts.method) {
+                    case interpolation_method::nearest:
+                        covered = impl::astro_impl::regrid_nearest(imgs, xps, yps, flx);
+                        break;
+                    case interpolation_method::linear:
+                        covered = impl::astro_impl::regrid_linear(imgs, xps, yps, flx);
+                        break;
+                    case interpolation_method::cubic:
+                        covered = impl::astro_impl::regrid_cubic(imgs, xps, yps, flx);
+                        break;
                     }
 
-                    res.safe(iy,ix) = flx;
+                    if (covered) {
+                        if (opts.conserve_flux) {
+                            if (!opts.linearize) {
+                                parea = impl::astro_impl::polyon_area(
+                                    {plx.safe[ix], plx.safe[ix+1], pux.safe[ix+1], pux.safe[ix]},
+                                    {ply.safe[ix], ply.safe[ix+1], puy.safe[ix+1], puy.safe[ix]}
+                                );
+                            }
+
+                            flx *= parea;
+                        }
+
+                        res.safe(iy,ix) = flx;
+                    }
                 }
 
-                if (opts.verbose) progress(pg, 31);
+                std::swap(plx, pux);
+                std::swap(ply, puy);
+
+                if (opts.verbose && nband == 1) progress(pg);
             }
+        };
 
-            std::swap(plx, pux);
-            std::swap(ply, puy);
-        }
+        thread::parallel_for pfor(opts.thread);
+        pfor.verbose = opts.verbose && nband > 1;
+        pfor.chunk_size = 1;
+        pfor.execute(do_band, nband);
 #endif
 
         return res;
@@ -2012,6 +2420,7 @@ namespace astro {
         double pixfrac = 1.0;      // fraction of pixel to drizzle (1 = simple projection)
         bool linearize = false;    // approximation: assume WCS transform is linear
         bool dest_pixfrac = false; // approximation: assume pixfrac is linear on destination grid
+        uint_t thread = 1;         // number of threads to use
     };
 
     template<std::size_t D, typename T = double>
@@ -2057,10 +2466,14 @@ namespace astro {
         // computed by linearly interpolating the above.
         // If dest_pixfrac=false:
         // For the horizontal pixel 'i' of line 'j' (x_i,y_j), the grid is:
-        //   (plux,pluy)[i]   (prux,pruy)[i]    # y_(j+0.5*pf)
-        //   (pllx,plly)[i]   (prlx,prly)[i]    # y_(j-0.5*pf)
+        //   (px,py)[2*Nx+i]  (px,py)[3*Nx+i]   # y_(j+0.5*pf)
+        //   (px,py)[i]       (px,py)[Nx+i]     # y_(j-0.5*pf)
         //   # x_(i-0.5*pf)   # x_(i+0.5*pf)
         // Total of 4*Nx*Ny WCS transforms.
+        //
+        // Each line of the grid is projected with a single call to wcslib. Lines are split
+        // into bands processed by separate threads; each band drizzles into its own accumulator
+        // covering the band's footprint on the new grid, which is then added to the output.
 
         auto s2d_wcs = [&](double sx, double sy, double& dx, double& dy) {
             double tra, tdec;
@@ -2073,7 +2486,7 @@ namespace astro {
         double csx = nx/2;
         double csy = ny/2;
         double cdx, cdy, cdx1, cdy1, cdx2, cdy2;
-        double pixel_area;
+        double pixel_area = dnan;
         if (opts.linearize) {
             s2d_wcs(csx, csy,     cdx,  cdy);
             s2d_wcs(csx+1.0, csy, cdx1, cdy1);
@@ -2105,88 +2518,199 @@ namespace astro {
             }
         }
 
-        auto s2d = [&](double sx, double sy, double& dx, double& dy) {
+        auto s2d = [&](const vec1d& sx, const vec1d& sy, vec1d& dx, vec1d& dy) {
             if (opts.linearize) {
-                dx = (sx-csx)*cdx1 + (sy-csy)*cdx2 + cdx;
-                dy = (sx-csx)*cdy1 + (sy-csy)*cdy2 + cdy;
+                dx.resize(sx.dims);
+                dy.resize(sx.dims);
+                for (uint_t i : range(sx)) {
+                    dx.safe[i] = (sx.safe[i]-csx)*cdx1 + (sy.safe[i]-csy)*cdx2 + cdx;
+                    dy.safe[i] = (sx.safe[i]-csx)*cdy1 + (sy.safe[i]-csy)*cdy2 + cdy;
+                }
             } else {
-                s2d_wcs(sx, sy, dx, dy);
+                impl::astro_impl::regrid_project(astros, astrod, sx, sy, dx, dy);
             }
         };
 
-        auto pg = progress_start(nx*ny);
-        vec1d plx, ply;
-        vec1d pux, puy;
-        vec1d pllx, prlx, plux, prux;
-        vec1d plly, prly, pluy, pruy;
-        if (opts.pixfrac == 1 || opts.dest_pixfrac) {
-            plx.resize(nx+1);
-            ply.resize(nx+1);
-            for (uint_t ix : range(nx+1)) {
-                s2d(ix-0.5, -0.5, plx.safe[ix], ply.safe[ix]);
-            }
-
-            pux.resize(nx+1);
-            puy.resize(nx+1);
-        } else {
-            pllx.resize(nx); prlx.resize(nx);
-            plux.resize(nx); prux.resize(nx);
-            plly.resize(nx); prly.resize(nx);
-            pluy.resize(nx); pruy.resize(nx);
-        }
-
-        for (uint_t iy : range(ny)) {
-            if (opts.pixfrac == 1 || opts.dest_pixfrac) {
-                for (uint_t ix : range(nx+1)) {
-                    s2d(ix-0.5, iy+0.5, pux.safe[ix], puy.safe[ix]);
-                }
+        const bool full_grid = opts.pixfrac == 1 || opts.dest_pixfrac;
+        const double flx_frac = sqr(opts.pixfrac);
+
+        // Drizzle lines [y0,y1) of the original image into 'bres' and 'bwei', which cover
+        // the new grid starting at pixel (ox,oy)
+        auto drizzle_lines = [&](uint_t y0, uint_t y1, vec<D,double>& bres, vec2d& bwei,
+            uint_t ox, uint_t oy, progress_t* bpg) {
+
+            double parea = pixel_area;
+            vec1d gx, gy, px, py;
+            vec1d plx, ply, pux, puy;
+            if (full_grid) {
+                gx = indgen<double>(nx+1) - 0.5;
+                gy = replicate(y0-0.5, nx+1);
+                s2d(gx, gy, plx, ply);
             } else {
+                // Four corners of each pixel, in a single line: lower left, lower right,
+                // upper left, upper right
                 const double dp = 0.5*opts.pixfrac;
+                gx.resize(4*nx);
                 for (uint_t ix : range(nx)) {
-                    s2d(ix-dp, iy-dp, pllx.safe[ix], plly.safe[ix]);
-                    s2d(ix+dp, iy-dp, prlx.safe[ix], prly.safe[ix]);
-                    s2d(ix-dp, iy+dp, plux.safe[ix], pluy.safe[ix]);
-                    s2d(ix+dp, iy+dp, prux.safe[ix], pruy.safe[ix]);
+                    gx.safe[ix]      = gx.safe[2*nx+ix] = ix-dp;
+                    gx.safe[nx+ix]   = gx.safe[3*nx+ix] = ix+dp;
                 }
+
+                gy.resize(4*nx);
             }
 
-            for (uint_t ix : range(nx)) {
-                // Find projection of each pixel of the original image on the new grid
-                // NB: assumes the astrometry is such that this projection is
-                // reasonably approximated by a 4-edge polygon (i.e.: varying pixel scales,
-                // pixel offsets and rotations are fine, but weird things may happen close
-                // to the poles of the projection where things become non-linear)
-
-                vec1d xps, yps;
-                if (opts.pixfrac == 1 || opts.dest_pixfrac) {
-                    xps = {plx.safe[ix], plx.safe[ix+1], pux.safe[ix+1], pux.safe[ix]};
-                    yps = {ply.safe[ix], ply.safe[ix+1], puy.safe[ix+1], puy.safe[ix]};
-
-                    if (opts.dest_pixfrac && opts.pixfrac != 1) {
-                        double mx = mean(xps);
-                        xps = mx + opts.pixfrac*(xps - mx);
-                        double my = mean(yps);
-                        yps = my + opts.pixfrac*(yps - my);
-                    }
+            for (uint_t iy : range(y0, y1)) {
+                if (full_grid) {
+                    gy[_] = iy+0.5;
+                    s2d(gx, gy, pux, puy);
                 } else {
-                    xps = {pllx.safe[ix], prlx.safe[ix], prux.safe[ix], plux.safe[ix]};
-                    yps = {plly.safe[ix], prly.safe[ix], pruy.safe[ix], pluy.safe[ix]};
+                    const double dp = 0.5*opts.pixfrac;
+                    for (uint_t ix : range(2*nx)) {
+                        gy.safe[ix]      = iy-dp;
+                        gy.safe[2*nx+ix] = iy+dp;
+                    }
+
+                    s2d(gx, gy, px, py);
                 }
 
-                if (!opts.linearize) {
-                    pixel_area = impl::astro_impl::polyon_area(xps, yps);
+                for (uint_t ix : range(nx)) {
+                    // Find projection of each pixel of the original image on the new grid
+                    // NB: assumes the astrometry is such that this projection is
+                    // reasonably approximated by a 4-edge polygon (i.e.: varying pixel scales,
+                    // pixel offsets and rotations are fine, but weird things may happen close
+                    // to the poles of the projection where things become non-linear)
+
+                    vec1d xps, yps;
+                    if (full_grid) {
+                        xps = {plx.safe[ix], plx.safe[ix+1], pux.safe[ix+1], pux.safe[ix]};
+                        yps = {ply.safe[ix], ply.safe[ix+1], puy.safe[ix+1], puy.safe[ix]};
+
+                        if (opts.dest_pixfrac && opts.pixfrac != 1) {
+                            double mx = mean(xps);
+                            xps = mx + opts.pixfrac*(xps - mx);
+                            double my = mean(yps);
+                            yps = my + opts.pixfrac*(yps - my);
+                        }
+                    } else {
+                        xps = {px.safe[ix], px.safe[nx+ix], px.safe[3*nx+ix], px.safe[2*nx+ix]};
+                        yps = {py.safe[ix], py.safe[nx+ix], py.safe[3*nx+ix], py.safe[2*nx+ix]};
+                    }
+
+                    if (!opts.linearize) {
+                        parea = impl::astro_impl::polyon_area(xps, yps);
+                    }
+
+                    xps -= ox;
+                    yps -= oy;
+
+                    impl::astro_impl::regrid_drizzle(imgs, ix, iy, flx_frac, xps, yps, parea, bres, bwei);
                 }
 
-                double flx_frac = sqr(opts.pixfrac);
-                impl::astro_impl::regrid_drizzle(imgs, ix, iy, flx_frac, xps, yps, pixel_area, res, wei);
+                if (full_grid) {
+                    std::swap(plx, pux);
+                    std::swap(ply, puy);
+                }
 
-                if (opts.verbose) progress(pg, 31);
+                if (bpg) progress(*bpg);
             }
+        };
 
-            if (opts.pixfrac == 1 || opts.dest_pixfrac) {
-                std::swap(plx, pux);
-                std::swap(ply, puy);
+        uint_t nband = (opts.thread <= 1 ? 1 : std::min(ny, 32*opts.thread));
+        if (nband <= 1) {
+            auto pg = progress_start(ny);
+            drizzle_lines(0, ny, res, wei, 0, 0, opts.verbose ? &pg : nullptr);
+        } else {
+            if (!opts.linearize) {
+                // Let wcslib finish its setup before sharing the WCS between threads
+                double tdx, tdy;
+                s2d_wcs(csx, csy, tdx, tdy);
             }
+
+            // Bands are merged in order, as soon as all the previous bands are done, so that
+            // the result does not depend on the order in which threads finish their bands
+            struct band_t {
+                vec<D,double> res;
+                vec2d wei;
+                uint_t x0 = 0, y0 = 0;
+                bool done = false;
+            };
+
+            std::vector<band_t> bands(nband);
+            uint_t next_merge = 0;
+            std::mutex merge_mutex;
+            auto merge_band = [&](uint_t ib) {
+                std::lock_guard<std::mutex> lock(merge_mutex);
+                bands[ib].done = true;
+                while (next_merge < nband && bands[next_merge].done) {
+                    band_t& b = bands[next_merge];
+                    if (!b.wei.empty()) {
+                        impl::astro_impl::add_subset(b.res, res, b.x0, b.y0);
+                        impl::astro_impl::add_subset(b.wei, wei, b.x0, b.y0);
+                        b.res.clear();
+                        b.wei.clear();
+                    }
+
+                    ++next_merge;
+                }
+            };
+
+            auto do_band = [&](uint_t ib) {
+                uint_t y0 = (ib*ny)/nband;
+                uint_t y1 = ((ib+1)*ny)/nband;
+
+                // Find the footprint of the band on the new grid, from the projection
+                // of its edges
+                const double e = 0.5*std::max(1.0, opts.pixfrac);
+                const uint_t nex = nx+1, ney = y1-y0+1;
+                vec1d bx(2*(nex+ney)), by(2*(nex+ney));
+                for (uint_t i : range(nex)) {
+                    bx.safe[i] = bx.safe[nex+i] = (i == 0 ? -e : i == nx ? nx-1.0+e : i-0.5);
+                    by.safe[i] = y0-e;
+                    by.safe[nex+i] = y1-1.0+e;
+                }
+                for (uint_t i : range(ney)) {
+                    by.safe[2*nex+i] = by.safe[2*nex+ney+i] =
+                        (i == 0 ? y0-e : i == ney-1 ? y1-1.0+e : y0+i-0.5);
+                    bx.safe[2*nex+i] = -e;
+                    bx.safe[2*nex+ney+i] = nx-1.0+e;
+                }
+
+                vec1d dx, dy;
+                s2d(bx, by, dx, dy);
+
+                // Keep a margin, and use the whole grid if the edges cannot be projected
+                double bx0 = 0.0, bx1 = wei.dims[1]-1.0, by0 = 0.0, by1 = wei.dims[0]-1.0;
+                if (count(!is_finite(dx)) == 0 && count(!is_finite(dy)) == 0) {
+                    bx0 = std::max(bx0, floor(min(dx)) - 2.0);
+                    bx1 = std::min(bx1, ceil(max(dx)) + 2.0);
+                    by0 = std::max(by0, floor(min(dy)) - 2.0);
+                    by1 = std::min(by1, ceil(max(dy)) + 2.0);
+                }
+
+                if (bx1 < bx0 || by1 < by0) {
+                    // Band is outside of destination image
+                    merge_band(ib);
+                    return;
+                }
+
+                band_t& b = bands[ib];
+                b.x0 = bx0;
+                b.y0 = by0;
+                auto bresd = res.dims;
+                bresd[D-2] = uint_t(by1) - b.y0 + 1;
+                bresd[D-1] = uint_t(bx1) - b.x0 + 1;
+                b.res = vec<D,double>(bresd);
+                b.wei = vec2d(bresd[D-2], bresd[D-1]);
+
+                drizzle_lines(y0, y1, b.res, b.wei, b.x0, b.y0, nullptr);
+
+                merge_band(ib);
+            };
+
+            thread::parallel_for pfor(opts.thread);
+            pfor.verbose = opts.verbose;
+            pfor.chunk_size = 1;
+            pfor.execute(do_band, nband);
         }
 #endif
 
@@ -2201,6 +2725,86 @@ namespace astro {
         vec2d wei;
         return regrid_drizzle(imgs, astros, astrod, wei, opts);
     }
+
+    // Convolve the image in the FITS file 'infile' with a kernel, as convolve2d_tiled(), and save
+    // the result in 'outfile' with the same header. The image is read and written by bands of
+    // rows, so only a small part of it is kept in memory: this can convolve images that do not
+    // fit in memory. The image in 'outfile' is stored with the pixel type 'Type'.
+    template<typename Type = float, typename TypeK>
+    void convolve2d_fits(const std::string& infile, const std::string& outfile,
+        const vec<2,TypeK>& kernel, const convolve2d_tiled_params& p = convolve2d_tiled_params{}) {
+#ifdef NO_FFTW
+        static_assert(!std::is_same<Type,Type>::value, "this function requires the FFTW "
+            "library");
+#else
+        fits::input_image in(infile);
+        vif_check_fits(in.axis_count() == 2, "FITS file has wrong number of dimensions "
+            "(expected 2, got "+to_string(in.axis_count())+")");
+
+        vec1u idims = in.image_dims();
+        const std::array<uint_t,2> dims = {{idims[0], idims[1]}};
+        const uint_t ny = dims[1];
+
+        // Copy the header, with the new pixel type and without scaling
+        fits::output_image out(outfile);
+        fitsfile* ifptr = in.cfitsio_ptr();
+        fitsfile* ofptr = out.cfitsio_ptr();
+        int status = 0;
+        fits_copy_header(ifptr, ofptr, &status);
+        fits::vif_check_cfitsio(status, "could not copy header to '"+outfile+"'");
+
+        long naxes[2] = {long(dims[1]), long(dims[0])};
+        fits_resize_img(ofptr, impl::fits_impl::traits<Type>::image_type, 2, naxes, &status);
+        fits::vif_check_cfitsio(status, "could not create image in '"+outfile+"'");
+
+        for (std::string key : {"BSCALE", "BZERO", "BLANK"}) {
+            fits_delete_key(ofptr, key.c_str(), &status);
+            status = 0;
+        }
+
+        fits_set_hdustruc(ofptr, &status);
+        fits::vif_check_cfitsio(status, "could not create image in '"+outfile+"'");
+
+        impl::astro_impl::tiled_convolver conv(kernel, dims, p.tile_size, p.mask_nan);
+
+        thread::parallel_for pfor(p.thread);
+        pfor.chunk_size = 1;
+
+        // Process the image by bands of tiles
+        vec2d band;
+        vec<2,Type> res;
+        auto pg = progress_start(conv.ntile[0]);
+        for (uint_t it : range(conv.ntile[0])) {
+            // Read the rows needed for this band, including the margins
+            const uint_t x0 = it*conv.step[0];
+            const uint_t x1 = std::min(dims[0], x0 + conv.step[0]);
+            const uint_t ix0 = (x0 > conv.hsx ? x0 - conv.hsx : 0);
+            const uint_t ix1 = std::min(dims[0], x1 + conv.hsx);
+
+            band.resize(ix1-ix0, ny);
+            long fpixel[2] = {1, long(ix0+1)};
+            double null = dnan;
+            int anynul = 0;
+            fits_read_pix(ifptr, TDOUBLE, fpixel, band.size(), &null, band.raw_data(),
+                &anynul, &status);
+            fits::vif_check_cfitsio(status, "could not read image in '"+infile+"'");
+
+            // Convolve all the tiles of the band
+            res.resize(x1-x0, ny);
+            pfor.execute([&](uint_t jt) {
+                conv.convolve_tile(it, jt, band, ix0, res, x0);
+            }, conv.ntile[1]);
+
+            // Write the band
+            fpixel[1] = x0+1;
+            fits_write_pix(ofptr, impl::fits_impl::traits<Type>::ttype, fpixel, res.size(),
+                res.raw_data(), &status);
+            fits::vif_check_cfitsio(status, "could not write image in '"+outfile+"'");
+
+            if (p.verbose) progress(pg);
+        }
+#endif
+    }
 }
 
 #endif
@@ -12,28 +12,22 @@ namespace impl {
         struct image_workspace {
             int status = 0;
             fitsfile* fptr = nullptr;
-            long width, height;
+            std::string file;
+            int naxis = 0;
+            uint_t xaxis = 0, yaxis = 1;
+            long width = 0, height = 0;
+            bool compressed = false;
+            long tile_height = 1;
             astro::wcs astro;
             vec1d x, y;
 
             image_workspace() = default;
 
-            explicit image_workspace(const std::string& file, const vec1d& ra, const vec1d& dec) {
+            explicit image_workspace(const std::string& f) : file(f) {
                 fits_open_image(&fptr, file.c_str(), READONLY, &status);
                 fits::vif_check_cfitsio(status, "cannot open file '"+file+"'");
 
-                // Read the header as a string and read the WCS data
-                char* hstr = nullptr;
-                int nkeys  = 0;
-                fits_hdr2str(fptr, 0, nullptr, 0, &hstr, &nkeys, &status);
-                astro = astro::wcs(hstr);
-                free(hstr);
-
-                // Convert ra/dec to x/y
-                astro::ad2xy(astro, ra, dec, x, y);
-
                 // Get the dimensions of the image
-                int naxis = 0;
                 fits_get_img_dim(fptr, &naxis, &status);
                 vec<1,long> naxes(naxis);
                 fits_get_img_size(fptr, naxis, naxes.raw_data(), &status);
@@ -45,8 +39,8 @@ namespace impl {
                     uint_t found = 0;
                     for (uint_t i : range(naxis)) {
                         if (naxes[i] > 1) {
-                            if (found == 0) width = naxes[i];
-                            if (found == 1) height = naxes[i];
+                            if (found == 0) { width = naxes[i];  xaxis = i; }
+                            if (found == 1) { height = naxes[i]; yaxis = i; }
                             ++found;
                         }
                     }
@@ -55,14 +49,42 @@ namespace impl {
                 }
 
                 vif_check(is2D, "cannot stack on image cubes (image dimensions: ", naxes, ")");
+
+                // Compressed images are decompressed tile by tile, get the tile height
+                compressed = fits_is_compressed_image(fptr, &status);
+                if (compressed) {
+                    int tstatus = 0;
+                    long th = 1;
+                    std::string key = "ZTILE"+to_string(yaxis+1);
+                    fits_read_key(fptr, TLONG, key.c_str(), &th, nullptr, &tstatus);
+                    if (tstatus == 0 && th > 0) {
+                        tile_height = th;
+                    }
+                }
+            }
+
+            image_workspace(const std::string& f, const vec1d& ra, const vec1d& dec) :
+                image_workspace(f) {
+
+                // Read the header as a string and read the WCS data
+                char* hstr = nullptr;
+                int nkeys  = 0;
+                fits_hdr2str(fptr, 0, nullptr, 0, &hstr, &nkeys, &status);
+                astro = astro::wcs(hstr);
+                free(hstr);
+
+                // Convert ra/dec to x/y
+                astro::ad2xy(astro, ra, dec, x, y);
             }
 
             image_workspace(const image_workspace&) = delete;
             image_workspace& operator=(const image_workspace&) = delete;
 
             image_workspace(image_workspace&& i) : status(i.status), fptr(i.fptr),
-                width(i.width), height(i.height), astro(std::move(i.astro)),
-                x(std::move(x)), y(std::move(y)) {
+                file(std::move(i.file)), naxis(i.naxis), xaxis(i.xaxis), yaxis(i.yaxis),
+                width(i.width), height(i.height), compressed(i.compressed),
+                tile_height(i.tile_height), astro(std::move(i.astro)),
+                x(std::move(i.x)), y(std::move(i.y)) {
                 i.fptr = nullptr;
             }
 
@@ -72,7 +94,131 @@ namespace impl {
                 if (fptr) fits_close_file(fptr, &status);
                 fptr = nullptr;
             }
+
+            // Check if the cutout of a source overlaps with the image
+            bool overlaps(uint_t i, uint_t hsize) const {
+                long p0[2] = {long(round(x.safe[i]-hsize)), long(round(y.safe[i]-hsize))};
+                long p1[2] = {long(round(x.safe[i]+hsize)), long(round(y.safe[i]+hsize))};
+                return !(p1[0] < 1 || p0[0] >= width || p1[1] < 1 || p0[1] >= height);
+            }
+
+            // Check if the cutout of a source is fully inside the image
+            bool covers(uint_t i, uint_t hsize) const {
+                long p0[2] = {long(round(x.safe[i]-hsize)), long(round(y.safe[i]-hsize))};
+                long p1[2] = {long(round(x.safe[i]+hsize)), long(round(y.safe[i]+hsize))};
+                return !(p0[0] < 1 || p1[0] >= width || p0[1] < 1 || p1[1] >= height);
+            }
         };
+
+        // Extract the cutouts of the sources 'ids' from an image, in 'cuts(k,_,_)' for 'ids[k]'.
+        // Pixels falling outside of the image are set to NaN. Cutouts are extracted in order of
+        // increasing y, so the image is read sequentially. Uncompressed images are memory mapped
+        // and only the needed pixels are read. Other images are read in bands of rows aligned on
+        // the compression tiles (of at most 'buffer_size' bytes, unless a cutout needs more),
+        // and each band serves all the cutouts it contains, so tiles are decompressed only once.
+        template<typename Type>
+        void read_cutouts(const image_workspace& img, uint_t hsize, const vec1u& ids,
+            uint_t buffer_size, vec<3,Type>& cuts) {
+
+            const long csize = 2*hsize+1;
+            const uint_t n = ids.size();
+            cuts = vec<3,Type>(n, csize, csize);
+            cuts[_] = fnan;
+
+            if (n == 0) return;
+
+            // First pixel of each cutout
+            vec<1,long> x0(n), y0(n);
+            for (uint_t k : range(n)) {
+                x0.safe[k] = round(img.x.safe[ids.safe[k]]-hsize);
+                y0.safe[k] = round(img.y.safe[ids.safe[k]]-hsize);
+            }
+
+            vec1u order = sort(y0);
+
+            if (img.naxis == 2 && !img.compressed) {
+                fits::mapped_image<2,Type> mimg;
+                bool mapped = false;
+                try {
+                    mimg.open(img.file);
+                    mapped = true;
+                } catch (fits::exception&) {
+                    // Cannot be mapped (e.g., gzipped file), read it with cfitsio below
+                }
+
+                if (mapped) {
+                    vec<2,Type> cut;
+                    for (uint_t k : order) {
+                        mimg.read_region(cut, {{y0.safe[k]-1, x0.safe[k]-1}},
+                            {{y0.safe[k]+csize-2, x0.safe[k]+csize-2}}, fnan);
+                        std::copy(cut.begin(), cut.end(), cuts.raw_data() + k*csize*csize);
+                    }
+
+                    return;
+                }
+            }
+
+            // Number of rows in a band: at least one cutout and the tile alignment
+            const long th = img.tile_height;
+            long nrow = std::max(long(buffer_size/(sizeof(Type)*img.width)), csize+th-1);
+            nrow = ((nrow+th-1)/th)*th;
+
+            std::vector<long> fpixel(img.naxis, 1), lpixel(img.naxis, 1), inc(img.naxis, 1);
+            vec<2,Type> band;
+            uint_t k0 = 0;
+            while (k0 < n) {
+                // Start the band on the tile of the first row needed
+                long b0 = std::max(1l, y0.safe[order.safe[k0]]);
+                b0 = ((b0-1)/th)*th + 1;
+                const long bmax = std::min(img.height, b0+nrow-1);
+
+                // Find all the cutouts contained in the band, and the region they cover
+                long b1 = b0, bx0 = img.width, bx1 = 1;
+                uint_t k1 = k0;
+                for (; k1 < n; ++k1) {
+                    const uint_t k = order.safe[k1];
+                    const long y1 = std::min(img.height, y0.safe[k]+csize-1);
+                    if (y1 > bmax) break;
+
+                    b1 = std::max(b1, y1);
+                    bx0 = std::min(bx0, std::max(1l, x0.safe[k]));
+                    bx1 = std::max(bx1, std::min(img.width, x0.safe[k]+csize-1));
+                }
+
+                // Read the band
+                fpixel[img.xaxis] = bx0;
+                lpixel[img.xaxis] = bx1;
+                fpixel[img.yaxis] = b0;
+                lpixel[img.yaxis] = b1;
+                band.dims[0] = b1-b0+1;
+                band.dims[1] = bx1-bx0+1;
+                band.resize();
+
+                Type null = fnan;
+                int anynul = 0;
+                int status = 0;
+                fits_read_subset(img.fptr, impl::fits_impl::traits<Type>::ttype, fpixel.data(),
+                    lpixel.data(), inc.data(), &null, band.raw_data(), &anynul, &status);
+                fits::vif_check_cfitsio(status, "could not read image in '"+img.file+"'");
+
+                // Copy the cutouts
+                for (uint_t kk = k0; kk < k1; ++kk) {
+                    const uint_t k = order.safe[kk];
+                    const long cx0 = std::max(1l, x0.safe[k]);
+                    const long cx1 = std::min(img.width, x0.safe[k]+csize-1);
+                    const long cy0 = std::max(1l, y0.safe[k]);
+                    const long cy1 = std::min(img.height, y0.safe[k]+csize-1);
+                    for (long yy = cy0; yy <= cy1; ++yy) {
+                        const Type* src = band.raw_data() + (yy-b0)*band.dims[1] + (cx0-bx0);
+                        Type* dst = cuts.raw_data() + (k*csize + (yy-y0.safe[k]))*csize +
+                            (cx0-x0.safe[k]);
+                        std::copy(src, src + (cx1-cx0+1), dst);
+                    }
+                }
+
+                k0 = k1;
+            }
+        }
     }
 }
 
@@ -82,6 +228,10 @@ namespace astro {
         bool save_offsets = false;
         bool save_section = false;
         bool verbose = false;
+        // Number of images read in parallel
+        uint_t thread = 1;
+        // Memory used to read compressed images in bands of rows [bytes]
+        uint_t buffer_size = 64*1024*1024;
     };
 
     struct qstack_output {
@@ -118,6 +268,7 @@ namespace astro {
         ids.reserve(ids.size() + ra.size());
 
         vec1b found(ra.size());
+        vec1u pos(ra.size());
 
         qstack_output out;
         if (params.save_offsets) {
@@ -129,54 +280,32 @@ namespace astro {
             out.sect.reserve(ra.size());
         }
 
-        // Loop over all images
-        auto pg = progress_start(ra.size()*imgs.size());
-        for (uint_t iimg : range(imgs.size())) {
-            auto& img = imgs[iimg];
+        // Extract the cutouts from all images, discarding any source that falls out of the
+        // boundaries of the image
+        std::vector<vec1u> iids(imgs.size());
+        std::vector<vec<3,Type>> icuts(imgs.size());
 
-            // Loop over all sources
+        thread::parallel_for pfor(params.thread);
+        pfor.verbose = params.verbose;
+        pfor.chunk_size = 1;
+        pfor.execute([&](uint_t iimg) {
+            auto& img = imgs[iimg];
             for (uint_t i : range(ra)) {
-                if (params.verbose) progress(pg);
-
-                long p0[2] = {long(round(img.x[i]-hsize)), long(round(img.y[i]-hsize))};
-                long p1[2] = {long(round(img.x[i]+hsize)), long(round(img.y[i]+hsize))};
-
-                // Discard any source that falls out of the boundaries of the image
-                if (p1[0] < 1 || p0[0] >= img.width || p1[1] < 1 || p0[1] >= img.height) {
-                    continue;
+                if (img.overlaps(i, hsize)) {
+                    iids[iimg].push_back(i);
                 }
+            }
 
-                vec<2,Type> cut(2*hsize+1, 2*hsize+1);
-
-                if (p0[0] < 1 || p1[0] >= img.width || p0[1] < 1 || p1[1] >= img.height) {
-                    // The source is overlapping with the edges of the map
-                    // Extract what we can
-                    cut[_] = fnan;
-
-                    long p0b[2] = {max(1, p0[0]),         max(1, p0[1])};
-                    long p1b[2] = {min(img.width, p1[0]), min(img.height, p1[1])};
-
-                    vec<2,Type> subcut(p1b[0]-p0b[0]+1, p1b[1]-p0b[1]+1);
+            impl::qstack_impl::read_cutouts(img, hsize, iids[iimg], params.buffer_size, icuts[iimg]);
+        }, imgs.size());
 
-                    Type null = fnan;
-                    int anynul = 0;
-                    long inc[2] = {1, 1};
-                    fits_read_subset(img.fptr, impl::fits_impl::traits<Type>::ttype, p0b, p1b, inc, &null,
-                        subcut.raw_data(), &anynul, &img.status);
+        // Combine the cutouts, in order
+        for (uint_t iimg : range(imgs.size())) {
+            auto& img = imgs[iimg];
 
-                    long x0 = p0b[0]-p0[0];
-                    long x1 = p1b[0]-p0[0];
-                    long y0 = p0b[1]-p0[1];
-                    long y1 = p1b[1]-p0[1];
-                    cut(y0-_-y1,x0-_-x1) = subcut;
-                } else {
-                    // The source is fully covered, easy
-                    Type null = fnan;
-                    int anynul = 0;
-                    long inc[2] = {1, 1};
-                    fits_read_subset(img.fptr, impl::fits_impl::traits<Type>::ttype, p0, p1, inc, &null,
-                        cut.raw_data(), &anynul, &img.status);
-                }
+            for (uint_t k : range(iids[iimg])) {
+                uint_t i = iids[iimg][k];
+                vec<2,Type> cut = icuts[iimg](k,_,_);
 
                 // Discard any source that contains a bad pixel (either infinite or NaN)
                 if (!params.keep_nan && count(!is_finite(cut)) != 0) {
@@ -186,6 +315,7 @@ namespace astro {
                 if (!found[i]) {
                     // First time we find this source, add it to the output values
                     found[i] = true;
+                    pos[i] = ids.size();
 
                     ids.push_back(i);
                     cube.push_back(cut);
@@ -200,11 +330,13 @@ namespace astro {
                     }
                 } else {
                     // We already found this source in another image, combine the two
-                    uint_t id = where_last(ids == i);
+                    uint_t id = pos[i];
                     vec1u idb = where(!is_finite(cube(id,_,_)));
                     cube(id,_,_)[idb] = cut[idb];
                 }
             }
+
+            icuts[iimg] = vec<3,Type>();
         }
 
         return out;
@@ -246,55 +378,14 @@ namespace astro {
             return out;
         }
 
-        // Open the FITS file
-        fitsfile* fptr;
-        fitsfile* wfptr;
-        int status = 0;
-
-        fits_open_image(&fptr, ffile.c_str(), READONLY, &status);
-        fits::vif_check_cfitsio(status, "cannot open file '"+ffile+"'");
-        fits_open_image(&wfptr, wfile.c_str(), READONLY, &status);
-        fits::vif_check_cfitsio(status, "cannot open file '"+wfile+"'");
-
-        // Read the header as a string and read the WCS data
-        char* hstr = nullptr;
-        int nkeys  = 0;
-        fits_hdr2str(fptr, 0, nullptr, 0, &hstr, &nkeys, &status);
-        astro::wcs astro(hstr);
-        free(hstr);
-
-        // Get the dimensions of the image
-        int naxis = 0;
-        fits_get_img_dim(fptr, &naxis, &status);
-        vec<1,long> naxes(naxis);
-        fits_get_img_size(fptr, naxis, naxes.raw_data(), &status);
-        bool is2D = naxis == 2;
-        long width, height;
-        if (is2D) {
-            width = naxes[0];
-            height = naxes[1];
-        } else {
-            uint_t found = 0;
-            for (uint_t i : range(naxis)) {
-                if (naxes[i] > 1) {
-                    if (found == 0) width = naxes[i];
-                    if (found == 1) height = naxes[i];
-                    ++found;
-                }
-            }
-
-            is2D = found == 2;
-        }
-
-        vif_check(is2D, "cannot stack on image cubes (image dimensions: ", naxes, ")");
-
-        vec<1,long> wnaxes(naxis);
-        fits_get_img_size(wfptr, naxis, wnaxes.raw_data(), &status);
-        vif_check(naxes[0] == wnaxes[0] && naxes[1] == wnaxes[1], "image and weight map do not match");
+        // Open the FITS files, the WCS is read from the flux map
+        impl::qstack_impl::image_workspace fimg(ffile, ra, dec);
+        impl::qstack_impl::image_workspace wimg(wfile);
+        vif_check(fimg.width == wimg.width && fimg.height == wimg.height,
+            "image and weight map do not match");
 
-        // Convert ra/dec to x/y
-        vec1d x, y;
-        astro::ad2xy(astro, ra, dec, x, y);
+        wimg.x = fimg.x;
+        wimg.y = fimg.y;
 
         // Allocate memory to hold all the cutouts
         if (cube.empty()) {
@@ -308,27 +399,30 @@ namespace astro {
         wcube.reserve(wcube.size() + (2*hsize+1)*(2*hsize+1)*ra.size());
         ids.reserve(ids.size() + ra.size());
 
-        // Loop over all sources
-        for (uint_t i = 0; i < ra.size(); ++i) {
-            long p0[2] = {long(round(x[i]-hsize)), long(round(y[i]-hsize))};
-            long p1[2] = {long(round(x[i]+hsize)), long(round(y[i]+hsize))};
-
-            // Discard any source that falls out of the boundaries of the image
-            if (p0[0] < 1 || p1[0] >= width || p0[1] < 1 || p1[1] >= height) {
-                continue;
+        // Discard any source that falls out of the boundaries of the image
+        vec1u sids;
+        for (uint_t i : range(ra)) {
+            if (fimg.covers(i, hsize)) {
+                sids.push_back(i);
             }
+        }
 
-            vec<2,Type> cut(2*hsize+1, 2*hsize+1);
-            vec<2,Type> wcut(2*hsize+1, 2*hsize+1);
-
-            Type null = fnan;
-            int anynul = 0;
-            long inc[2] = {1, 1};
+        // Extract the cutouts from both images
+        vec<3,Type> cuts, wcuts;
+        thread::parallel_for pfor(std::min(params.thread, uint_t(2)));
+        pfor.chunk_size = 1;
+        pfor.execute([&](uint_t f) {
+            if (f == 0) {
+                impl::qstack_impl::read_cutouts(fimg, hsize, sids, params.buffer_size, cuts);
+            } else {
+                impl::qstack_impl::read_cutouts(wimg, hsize, sids, params.buffer_size, wcuts);
+            }
+        }, 2);
 
-            fits_read_subset(fptr,  impl::fits_impl::traits<Type>::ttype, p0, p1, inc, &null,
-                cut.raw_data(),  &anynul, &status);
-            fits_read_subset(wfptr, impl::fits_impl::traits<Type>::ttype, p0, p1, inc, &null,
-                wcut.raw_data(), &anynul, &status);
+        for (uint_t k : range(sids)) {
+            uint_t i = sids[k];
+            vec<2,Type> cut = cuts(k,_,_);
+            vec<2,Type> wcut = wcuts(k,_,_);
 
             // Discard any source that contains a bad pixel (either infinite or NaN)
             if (!params.keep_nan && count(!is_finite(cut) || !is_finite(wcut)) != 0) {
@@ -340,8 +434,8 @@ namespace astro {
             wcube.push_back(wcut);
 
             if (params.save_offsets) {
-                out.dx.push_back(x[i] - round(x[i]));
-                out.dy.push_back(y[i] - round(y[i]));
+                out.dx.push_back(fimg.x[i] - round(fimg.x[i]));
+                out.dy.push_back(fimg.y[i] - round(fimg.y[i]));
             }
 
             if (params.save_section) {
@@ -349,12 +443,10 @@ namespace astro {
             }
         }
 
-        fits_close_file(fptr, &status);
-        fits_close_file(wfptr, &status);
-
         return out;
     }
 
+
     template<typename Type>
     vec<2,meta::rtype_t<Type>> qstack_mean(const vec<3,Type>& fcube) {
         return partial_mean(0, fcube);
@@ -1,6 +1,14 @@
 #ifndef VIF_ASTRO_QXMATCH_HPP
 #define VIF_ASTRO_QXMATCH_HPP
 
+#include <numeric>
+#include <cstdint>
+#include <memory>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "vif/astro/astro.hpp"
 
 namespace vif {
@@ -16,6 +24,23 @@ namespace astro {
         MEMBERS2("qxmatch_res", MAKE_MEMBER(id), MAKE_MEMBER(d), MAKE_MEMBER(rid), MAKE_MEMBER(rd));
     };
 
+    // Result of a radius search: the matches of the i-th source are id[offset[i]] to
+    // id[offset[i+1]-1], sorted by increasing distance d.
+    struct qxmatch_sparse_res {
+        vec1u offset;
+        vec1u id;
+        vec1d d;
+
+        // Number of matches of the i-th source
+        uint_t count(uint_t i) const {
+            return offset.safe[i+1] - offset.safe[i];
+        }
+
+        // Reflection data
+        MEMBERS1(offset, id, d);
+        MEMBERS2("qxmatch_sparse_res", MAKE_MEMBER(offset), MAKE_MEMBER(id), MAKE_MEMBER(d));
+    };
+
     #ifndef NO_CFITSIO
     void qxmatch_save(const std::string& file, const qxmatch_res& r) {
         fits::write_table(file, ftable(r.id, r.d, r.rid, r.rd));
@@ -26,6 +51,16 @@ namespace astro {
         fits::read_table(file, ftable(r.id, r.d, r.rid, r.rd));
         return r;
     }
+
+    void qxmatch_save(const std::string& file, const qxmatch_sparse_res& r) {
+        fits::write_table(file, ftable(r.offset, r.id, r.d));
+    }
+
+    qxmatch_sparse_res qxmatch_sparse_restore(const std::string& file) {
+        qxmatch_sparse_res r;
+        fits::read_table(file, ftable(r.offset, r.id, r.d));
+        return r;
+    }
     #endif
 
     struct qxmatch_params {
@@ -41,94 +76,650 @@ namespace astro {
 
 namespace impl {
     namespace qxmatch_impl {
-        struct depth_cache {
-            struct depth_t {
-                vec1i bx, by;
-                double max_dist;
+        // Spread the lower 32 bits of 'v' over the even bits of the result
+        inline std::uint64_t spread_bits(std::uint64_t v) {
+            v &= 0xffffffffull;
+            v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+            v = (v | (v << 8))  & 0x00ff00ff00ff00ffull;
+            v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0full;
+            v = (v | (v << 2))  & 0x3333333333333333ull;
+            v = (v | (v << 1))  & 0x5555555555555555ull;
+            return v;
+        }
+
+        // Finest level of the hierarchy: HEALPix order 29 (pixels of about 0.4 mas)
+        static const uint_t max_order = 29;
+
+        // HEALPix nested pixel index of a position in degrees, at order 'max_order'. The 4
+        // highest bits hold the base pixel (face), and each following pair of bits selects
+        // one of the 4 sub-pixels at the next order.
+        inline std::uint64_t healpix_nest(double ra, double dec) {
+            const std::uint64_t nside = std::uint64_t(1) << max_order;
+            const double d2r = dpi/180.0;
+
+            double z = sin(d2r*dec);
+            double za = std::abs(z);
+            double tt = fmod(ra/90.0, 4.0);
+            if (tt < 0.0) tt += 4.0;
+
+            std::uint64_t face, ix, iy;
+            if (za <= 2.0/3.0) {
+                // Equatorial region
+                double t1 = nside*(0.5 + tt);
+                double t2 = nside*(0.75*z);
+                std::uint64_t jp = std::uint64_t(t1 - t2);
+                std::uint64_t jm = std::uint64_t(t1 + t2);
+                std::uint64_t ifp = jp >> max_order;
+                std::uint64_t ifm = jm >> max_order;
+                face = (ifp == ifm ? (ifp | 4) : (ifp < ifm ? ifp : ifm + 8));
+                ix = jm & (nside - 1);
+                iy = nside - (jp & (nside - 1)) - 1;
+            } else {
+                // Polar caps
+                std::uint64_t ntt = std::min(std::uint64_t(3), std::uint64_t(tt));
+                double tp = tt - ntt;
+                // Same as sqrt(3*(1-za)), but accurate close to the poles
+                double tmp = nside*cos(d2r*dec)*sqrt(3.0/(1.0 + za));
+                std::uint64_t jp = std::min(std::uint64_t(tp*tmp), nside - 1);
+                std::uint64_t jm = std::min(std::uint64_t((1.0 - tp)*tmp), nside - 1);
+                if (z >= 0) {
+                    face = ntt;
+                    ix = nside - jm - 1;
+                    iy = nside - jp - 1;
+                } else {
+                    face = ntt + 8;
+                    ix = jp;
+                    iy = jm;
+                }
+            }
+
+            return (face << (2*max_order)) + spread_bits(ix) + (spread_bits(iy) << 1);
+        }
+
+        // Sort positions along the space-filling curve used by the indices (HEALPix nested
+        // pixels on the sphere, or a Z-order curve over the bounding box in linear mode).
+        // Returns the sorted order, and the key of each position in 'key'.
+        template<typename TypeR, typename TypeD>
+        std::vector<uint_t> sort_by_key(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
+            bool linear, std::vector<std::uint64_t>& key) {
+
+            const uint_t n = ra.size();
+            key.resize(n);
+            if (n == 0) {
+                return std::vector<uint_t>();
+            }
+
+            if (linear) {
+                double x0 = min(ra), y0 = min(dec);
+                double sx = (max(ra) - x0), sy = (max(dec) - y0);
+                const double np = double((std::uint64_t(1) << max_order) - 1);
+                sx = (sx > 0.0 ? np/sx : 0.0);
+                sy = (sy > 0.0 ? np/sy : 0.0);
+                for (uint_t i : range(n)) {
+                    key[i] = spread_bits(std::uint64_t((ra.safe[i] - x0)*sx)) +
+                        (spread_bits(std::uint64_t((dec.safe[i] - y0)*sy)) << 1);
+                }
+            } else {
+                for (uint_t i : range(n)) {
+                    key[i] = healpix_nest(ra.safe[i], dec.safe[i]);
+                }
+            }
+
+            std::vector<uint_t> order(n);
+            std::iota(order.begin(), order.end(), uint_t(0));
+            std::sort(order.begin(), order.end(), [&](uint_t i, uint_t j) {
+                return key[i] < key[j] || (key[i] == key[j] && i < j);
+            });
+
+            return order;
+        }
+
+        // Hierarchical spatial index of a set of positions. Positions are sorted along a
+        // space-filling curve (see sort_by_key()), and grouped in a tree of pixels where each
+        // node is split into its 4 sub-pixels until it holds few enough positions. Only
+        // occupied pixels are stored. Each node stores a sphere (in cartesian coordinates)
+        // enclosing all its positions, which is used to skip nodes that are too far away
+        // during a search.
+        //
+        // All the data is stored in a single block of 64 bit words, which can be written to
+        // disk and memory mapped back as is: a header of 'header_size' words, then the sorted
+        // positions, then the nodes. This block is never modified once built, so it can be
+        // shared by copies of the index and read by several threads at once.
+        struct sky_index {
+            struct node_t {
+                std::uint64_t i0, i1;        // positions in [i0,i1)
+                std::uint64_t child, nchild; // children nodes (none for a leaf)
+                double x, y, z, r;           // bounding sphere
             };
 
-            std::vector<depth_t> depths;
-            vec2b                visited;
-            double               csize;
-            std::size_t          max_depth;
+            static_assert(sizeof(node_t) == 8*sizeof(std::uint64_t),
+                "unexpected padding in qxmatch index nodes");
+
+            static const uint_t leaf_size = 8;
+            static const uint_t header_size = 8;
+            static const std::uint64_t magic = 0x3158444951464956ull;
+
+            bool linear = false;
+            uint_t npt = 0;
+            uint_t nnode = 0;
+
+            // For each sorted position: original index, cartesian coordinates, and the
+            // coordinates used to compute distances (RA and Dec in radians and cos(Dec),
+            // or x, y and 1 in linear mode)
+            const std::uint64_t* id = nullptr;
+            const double* x = nullptr;
+            const double* y = nullptr;
+            const double* z = nullptr;
+            const double* ra = nullptr;
+            const double* dec = nullptr;
+            const double* cdec = nullptr;
+            // Tree of pixels, nodes[0] is the root
+            const node_t* nodes = nullptr;
+
+            // Memory block holding all of the above
+            std::shared_ptr<const std::uint64_t> data;
+            uint_t nword = 0;
+
+            static uint_t size_in_words(uint_t np, uint_t nn) {
+                return header_size + 7*np + 8*nn;
+            }
 
-            depth_cache(uint_t nx, uint_t ny, double cs) : csize(cs),
-                max_depth(std::max(nx, ny)) {
+            void set_data_(std::shared_ptr<const std::uint64_t> d) {
+                data = std::move(d);
+                const std::uint64_t* h = data.get();
+                nword = h[1];
+                linear = (h[2] != 0);
+                npt = h[3];
+                nnode = h[4];
+
+                id = h + header_size;
+                const double* p = reinterpret_cast<const double*>(id + npt);
+                x = p;
+                y = p + npt;
+                z = p + 2*npt;
+                ra = p + 3*npt;
+                dec = p + 4*npt;
+                cdec = p + 5*npt;
+                nodes = reinterpret_cast<const node_t*>(p + 6*npt);
+            }
 
-                visited = vec2b(nx, ny);
-                depths.reserve(20);
+            void to_cartesian(double tra, double tdec, double& tx, double& ty, double& tz) const {
+                if (linear) {
+                    tx = tra;
+                    ty = tdec;
+                    tz = 0.0;
+                } else {
+                    const double d2r = dpi/180.0;
+                    double cd = cos(d2r*tdec);
+                    tx = cd*cos(d2r*tra);
+                    ty = cd*sin(d2r*tra);
+                    tz = sin(d2r*tdec);
+                }
+            }
 
-                // First depth is trivial
-                depths.push_back(depth_t{});
-                auto& depth = depths.back();
-                depth.max_dist = csize/2.0;
-                depth.bx = {0};
-                depth.by = {0};
-                visited(0,0) = true;
+            // Convert a position into the coordinates used by proxy()
+            void to_proxy(double tra, double tdec, double& pra, double& pdec,
+                double& pcdec) const {
+                if (linear) {
+                    pra = tra;
+                    pdec = tdec;
+                    pcdec = 1.0;
+                } else {
+                    const double d2r = dpi/180.0;
+                    pra = tra*d2r;
+                    pdec = tdec*d2r;
+                    pcdec = cos(pdec);
+                }
+            }
 
-                // Generate a few in advance
-                for (uint_t d : range(std::min(uint_t{9}, std::max(nx, ny)-1))) {
-                    grow();
+            // Distance *indicator* between a position (converted with to_proxy()) and the
+            // sorted position 'k'. This is not the true distance, but it is related to it
+            // through a monotonous function, which is enough to find nearest neighbors.
+            double proxy(double pra, double pdec, double pcdec, uint_t k) const {
+                if (linear) {
+                    return sqr(ra[k] - pra) + sqr(dec[k] - pdec);
+                } else {
+                    double sra = sin(0.5*(ra[k] - pra));
+                    double sde = sin(0.5*(dec[k] - pdec));
+                    return sde*sde + sra*sra*cdec[k]*pcdec;
                 }
             }
 
-            const depth_t& operator[] (uint_t i) {
-                if (i >= depths.size()) {
-                    for (uint_t d : range(i+1 - depths.size())) {
-                        grow();
-                    }
+            // Convert a distance proxy into the cartesian distance used in the tree
+            double proxy_to_index(double p) const {
+                return linear ? sqrt(p) : 2.0*sqrt(p);
+            }
+
+            // Convert between a distance proxy and a true distance (in arcsec on the sphere)
+            double proxy_to_true(double p) const {
+                if (p == dinf) {
+                    return dinf;
+                } else if (linear) {
+                    return sqrt(p);
+                } else {
+                    return 3600.0*(180.0/dpi)*2*asin(sqrt(p));
                 }
+            }
 
-                return depths[i];
+            double true_to_proxy(double d) const {
+                if (linear) {
+                    return d*d;
+                } else if (d >= 180.0*3600.0) {
+                    return 1.0;
+                } else {
+                    return sqr(sin(0.5*d*(dpi/180.0)/3600.0));
+                }
             }
 
-            std::size_t size() const {
-                return max_depth;
+            template<typename TypeR, typename TypeD>
+            void build(const vec<1,TypeR>& tra, const vec<1,TypeD>& tdec, bool lin) {
+                linear = lin;
+                const uint_t n = tra.size();
+
+                std::vector<std::uint64_t> key;
+                std::vector<uint_t> order = sort_by_key(tra, tdec, linear, key);
+
+                std::vector<std::uint64_t> skey(n);
+                std::vector<double> tx(n), ty(n), tz(n);
+                for (uint_t k : range(n)) {
+                    uint_t i = order[k];
+                    skey[k] = key[i];
+                    to_cartesian(tra.safe[i], tdec.safe[i], tx[k], ty[k], tz[k]);
+                }
+
+                std::vector<node_t> tnodes(1, node_t{0, n, 0, 0, 0.0, 0.0, 0.0, 0.0});
+                if (n != 0) {
+                    build_node_(tnodes, 0, skey, tx, ty, tz, max_order+1);
+                }
+
+                // Pack everything in a single memory block
+                const uint_t nw = size_in_words(n, tnodes.size());
+                std::uint64_t* w = new std::uint64_t[nw]();
+                w[0] = magic;
+                w[1] = nw;
+                w[2] = linear;
+                w[3] = n;
+                w[4] = tnodes.size();
+
+                std::uint64_t* wid = w + header_size;
+                double* wd = reinterpret_cast<double*>(wid + n);
+                for (uint_t k : range(n)) {
+                    uint_t i = order[k];
+                    wid[k] = i;
+                    wd[k] = tx[k];
+                    wd[n+k] = ty[k];
+                    wd[2*n+k] = tz[k];
+                    to_proxy(tra.safe[i], tdec.safe[i], wd[3*n+k], wd[4*n+k], wd[5*n+k]);
+                }
+
+                std::copy(tnodes.begin(), tnodes.end(), reinterpret_cast<node_t*>(wd + 6*n));
+
+                set_data_(std::shared_ptr<const std::uint64_t>(w,
+                    std::default_delete<std::uint64_t[]>()));
+            }
+
+            // Split node 'n', whose positions share all the bits of their key above
+            // 2*'level' (the base pixel is one level above the first order)
+            static void build_node_(std::vector<node_t>& tnodes, uint_t n,
+                const std::vector<std::uint64_t>& key, const std::vector<double>& tx,
+                const std::vector<double>& ty, const std::vector<double>& tz, uint_t level) {
+
+                node_t nd = tnodes[n];
+
+                // Bounding sphere
+                double cx = 0.0, cy = 0.0, cz = 0.0;
+                for (uint_t k = nd.i0; k < nd.i1; ++k) {
+                    cx += tx[k]; cy += ty[k]; cz += tz[k];
+                }
+
+                uint_t cnt = nd.i1 - nd.i0;
+                nd.x = cx/cnt; nd.y = cy/cnt; nd.z = cz/cnt;
+                double r2 = 0.0;
+                for (uint_t k = nd.i0; k < nd.i1; ++k) {
+                    r2 = std::max(r2, sqr(tx[k] - nd.x) + sqr(ty[k] - nd.y) +
+                        sqr(tz[k] - nd.z));
+                }
+
+                nd.r = sqrt(r2);
+
+                if (cnt <= leaf_size || level == 0) {
+                    tnodes[n] = nd;
+                    return;
+                }
+
+                // Find the sub-pixels, i.e., the ranges of positions with the same key
+                // bits at this level
+                const uint_t shift = 2*(level-1);
+                std::vector<uint_t> bounds = {uint_t(nd.i0)};
+                for (uint_t k = nd.i0+1; k < nd.i1; ++k) {
+                    if ((key[k] >> shift) != (key[k-1] >> shift)) {
+                        bounds.push_back(k);
+                    }
+                }
+
+                bounds.push_back(nd.i1);
+
+                nd.child = tnodes.size();
+                nd.nchild = bounds.size()-1;
+                tnodes[n] = nd;
+
+                for (uint_t c : range(nd.nchild)) {
+                    tnodes.push_back(node_t{bounds[c], bounds[c+1], 0, 0, 0.0, 0.0, 0.0, 0.0});
+                }
+
+                for (uint_t c : range(nd.nchild)) {
+                    build_node_(tnodes, nd.child + c, key, tx, ty, tz, level-1);
+                }
             }
 
-            void grow() {
-                vif_check(depths.size() < visited.dims[0] ||
-                    depths.size() < visited.dims[1], "cannot grow past the size of the "
-                    "bucket field (", visited.dims, "; trying to reach ", depths.size(), ")");
+            void save(const std::string& file) const {
+                vif_check(data != nullptr, "cannot save '", file, "': the index was not built");
 
-                depths.push_back(depth_t{});
-                auto& depth = depths.back();
-                uint_t d = depths.size();
+                std::ofstream out(file, std::ios::binary);
+                vif_check(out.is_open(), "could not open '", file, "' for writing");
+                out.write(reinterpret_cast<const char*>(data.get()),
+                    nword*sizeof(std::uint64_t));
+                vif_check(out.good(), "could not write index to '", file, "'");
+            }
 
-                // Look further by one cell size
-                depth.max_dist = csize*(d + 0.5);
+            // Memory map a file written by save()
+            void load(const std::string& file) {
+                int fd = ::open(file.c_str(), O_RDONLY);
+                vif_check(fd >= 0, "could not open '", file, "' for reading");
+
+                struct stat st;
+                bool ok = (::fstat(fd, &st) == 0);
+                const uint_t nbyte = (ok ? st.st_size : 0);
+                void* m = MAP_FAILED;
+                if (ok && nbyte >= header_size*sizeof(std::uint64_t)) {
+                    m = ::mmap(nullptr, nbyte, PROT_READ, MAP_SHARED, fd, 0);
+                }
 
-                // See which new buckets are reached.
-                // We only need to do the maths for one quadrant, the other 3
-                // can be deduced by symmetry.
-                for (uint_t x : range(std::min(d+1, visited.dims[0])))
-                for (uint_t y : range(std::min(d+1, visited.dims[1]))) {
-                    double dist2 = sqr(csize)*min(vec1d{
-                        sqr(x-0.5) + sqr(y-0.5), sqr(x+0.5) + sqr(y-0.5),
-                        sqr(x+0.5) + sqr(y+0.5), sqr(x-0.5) + sqr(y+0.5)
+                ::close(fd);
+                vif_check(m != MAP_FAILED, "could not map '", file, "' in memory");
+
+                std::shared_ptr<const std::uint64_t> d(static_cast<const std::uint64_t*>(m),
+                    [nbyte](const std::uint64_t* p) {
+                        ::munmap(const_cast<std::uint64_t*>(p), nbyte);
                     });
 
-                    if (dist2 <= sqr(depth.max_dist) && !visited(x, y)) {
-                        depth.bx.push_back(x);
-                        depth.by.push_back(y);
-                        visited(x, y) = true;
+                const std::uint64_t* h = d.get();
+                vif_check(h[0] == magic, "'", file, "' is not a qxmatch index file");
+                vif_check(h[1]*sizeof(std::uint64_t) == nbyte && h[1] == size_in_words(h[3], h[4]),
+                    "'", file, "' is corrupted (unexpected file size)");
+
+                set_data_(std::move(d));
+            }
+
+            // Call visit(k) for the sorted positions 'k' that may be closer to (qx,qy,qz)
+            // than radius(), in cartesian distance. radius() is called again after each
+            // visit, and can decrease as closer positions are found.
+            template<typename FR, typename FV>
+            void search(double qx, double qy, double qz, const FR& radius,
+                const FV& visit) const {
+                if (nnode != 0 && nodes[0].i1 > nodes[0].i0) {
+                    search_node_(0, qx, qy, qz, radius, visit);
+                }
+            }
+
+            template<typename FR, typename FV>
+            void search_node_(uint_t n, double qx, double qy, double qz, const FR& radius,
+                const FV& visit) const {
+
+                const node_t& nd = nodes[n];
+                if (nd.nchild == 0) {
+                    for (uint_t k = nd.i0; k < nd.i1; ++k) {
+                        visit(k);
                     }
+
+                    return;
                 }
 
-                // We have (+x,+y), fill the other 3 quadrants:
-                // (-x,+y), (-x,-y), (-x,+y)
-                vec1u idnew = indgen<uint_t>(depth.bx.size());
-                append(depth.bx, -depth.bx[idnew]);
-                append(depth.by, depth.by[idnew]);
-                append(depth.bx, -depth.bx[idnew]);
-                append(depth.by, -depth.by[idnew]);
-                append(depth.bx, depth.bx[idnew]);
-                append(depth.by, -depth.by[idnew]);
+                // Visit the closest children first
+                std::pair<double,uint_t> cd[12];
+                const uint_t nc = std::min(uint_t(nd.nchild), uint_t(12));
+                for (uint_t c : range(nc)) {
+                    const node_t& cn = nodes[nd.child + c];
+                    double d = sqrt(sqr(qx - cn.x) + sqr(qy - cn.y) + sqr(qz - cn.z));
+                    // Lower bound on the distance, with some margin for rounding errors
+                    cd[c] = std::make_pair(d - cn.r - 1e-12, nd.child + c);
+                }
+
+                std::sort(cd, cd + nc);
+                for (uint_t c : range(nc)) {
+                    if (cd[c].first > radius()) break;
+                    search_node_(cd[c].second, qx, qy, qz, radius, visit);
+                }
             }
         };
     }
 }
 
+namespace impl {
+    namespace qxmatch_impl {
+        // Fill a sparse result from the (distance proxy, id) pairs found for each source,
+        // which must be sorted. Pairs are freed as they are copied.
+        template<typename F>
+        void concatenate_matches(astro::qxmatch_sparse_res& res,
+            std::vector<std::vector<std::pair<double,uint_t>>>& hits, const F& proxy_to_true) {
+
+            const uint_t n = hits.size();
+            res.offset = replicate(0u, n+1);
+            for (uint_t i : range(n)) {
+                res.offset.safe[i+1] = res.offset.safe[i] + hits[i].size();
+            }
+
+            res.id.resize(res.offset.back());
+            res.d.resize(res.offset.back());
+            for (uint_t i : range(n)) {
+                uint_t o = res.offset.safe[i];
+                for (auto& h : hits[i]) {
+                    res.id.safe[o] = h.second;
+                    res.d.safe[o] = proxy_to_true(h.first);
+                    ++o;
+                }
+
+                std::vector<std::pair<double,uint_t>>().swap(hits[i]);
+            }
+        }
+    }
+}
+
+namespace astro {
+    // Spatial index of a reference catalog, built once and then used to find the neighbors
+    // of the sources of other catalogs. It can be saved to disk, and loaded back later by
+    // memory mapping the file. Queries do not modify the index, so they can be run from
+    // several threads at once, and copies of an index share the same data.
+    class qxmatch_index {
+        impl::qxmatch_impl::sky_index index_;
+
+        template<typename TypeR, typename TypeD>
+        static void check_coordinates_(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec) {
+            vif_check(ra.dims == dec.dims, "RA and Dec dimensions do not match (",
+                ra.dims, " vs ", dec.dims, ")");
+            vif_check(count(!is_finite(ra) || !is_finite(dec)) == 0,
+                "RA and Dec coordinates contain invalid values (infinite or NaN)");
+        }
+
+    public :
+        qxmatch_index() = default;
+
+        template<typename TypeR, typename TypeD>
+        qxmatch_index(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec, bool linear = false) {
+            build(ra, dec, linear);
+        }
+
+        explicit qxmatch_index(const std::string& file) {
+            load(file);
+        }
+
+        // Index the positions (ra,dec), in degrees. If 'linear' is true, the positions are
+        // treated as cartesian coordinates (x,y) and distances are euclidian.
+        template<typename TypeR, typename TypeD>
+        void build(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec, bool linear = false) {
+            check_coordinates_(ra, dec);
+            index_.build(ra, dec, linear);
+        }
+
+        void save(const std::string& file) const {
+            index_.save(file);
+        }
+
+        void load(const std::string& file) {
+            index_.load(file);
+        }
+
+        uint_t size() const {
+            return index_.npt;
+        }
+
+        bool empty() const {
+            return index_.npt == 0;
+        }
+
+        bool linear() const {
+            return index_.linear;
+        }
+
+        // For each source, find the 'params.nth' nearest positions of the index. The output
+        // is the same as that of qxmatch(), without the reverse match (rid and rd). If
+        // 'params.self' is true, the i-th source is never matched to the i-th position of
+        // the index. 'params.linear' is ignored, the metric is chosen by build().
+        template<typename TypeR, typename TypeD>
+        qxmatch_res match(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
+            qxmatch_params params = qxmatch_params{}) const {
+
+            check_coordinates_(ra, dec);
+
+            const uint_t n = ra.size();
+            uint_t nth = clamp(params.nth, 1u, npos);
+
+            qxmatch_res res;
+            res.id = replicate(npos, nth, n);
+            res.d  = replicate(dinf, nth, n);
+
+            if (n == 0 || empty()) {
+                return res;
+            }
+
+            // We asked more neighbors than there are positions in the index...
+            // Lower 'nth' to prevent this from blocking the algorithm.
+            nth = std::min(nth, size());
+
+            const impl::qxmatch_impl::sky_index& idx = index_;
+            auto work = [&](uint_t i) {
+                double x, y, z, pra, pdec, pcdec;
+                idx.to_cartesian(ra.safe[i], dec.safe[i], x, y, z);
+                idx.to_proxy(ra.safe[i], dec.safe[i], pra, pdec, pcdec);
+
+                idx.search(x, y, z, [&]() {
+                    return idx.proxy_to_index(res.d.safe(nth-1,i));
+                }, [&](uint_t k) {
+                    uint_t j = idx.id[k];
+                    if (params.self && i == j) return;
+
+                    double sd = idx.proxy(pra, pdec, pcdec, k);
+
+                    // Compare this new distance to the largest one that is in the
+                    // Nth nearest neighbor list. If it is lower than that, we
+                    // insert it in the list, removing the old one, and sort the
+                    // whole thing so that the largest distance goes as the end of
+                    // the list.
+                    if (sd < res.d.safe(nth-1,i)) {
+                        res.id.safe(nth-1,i) = j;
+                        res.d.safe(nth-1,i) = sd;
+                        uint_t l = nth-2;
+                        while (l != npos && res.d.safe(l,i) > res.d.safe(l+1,i)) {
+                            std::swap(res.d.safe(l,i), res.d.safe(l+1,i));
+                            std::swap(res.id.safe(l,i), res.id.safe(l+1,i));
+                            --l;
+                        }
+                    }
+                });
+            };
+
+            // Sources are processed along the space-filling curve, so that successive
+            // searches visit the same regions of the index. Each thread writes the results
+            // of the sources it processes directly in the output.
+            std::vector<std::uint64_t> key;
+            std::vector<uint_t> order = impl::qxmatch_impl::sort_by_key(ra, dec, linear(), key);
+
+            thread::parallel_for pfor(params.thread);
+            pfor.verbose = params.verbose;
+            pfor.execute([&](uint_t k) {
+                work(order[k]);
+            }, n);
+
+            // Convert the distance estimator to a real distance
+            for (double& d : res.d) {
+                d = idx.proxy_to_true(d);
+            }
+
+            return res;
+        }
+
+        // For each source, find all the positions of the index that are within 'radius'
+        // (in arcsec, or in coordinate units in linear mode). Only 'params.thread',
+        // 'params.verbose' and 'params.self' are used.
+        template<typename TypeR, typename TypeD>
+        qxmatch_sparse_res match_radius(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
+            double radius, qxmatch_params params = qxmatch_params{}) const {
+
+            check_coordinates_(ra, dec);
+
+            const uint_t n = ra.size();
+
+            qxmatch_sparse_res res;
+            res.offset = replicate(0u, n+1);
+
+            if (n == 0 || empty()) {
+                return res;
+            }
+
+            const impl::qxmatch_impl::sky_index& idx = index_;
+            const double rproxy = idx.true_to_proxy(radius);
+            const double rindex = idx.proxy_to_index(rproxy);
+
+            std::vector<std::vector<std::pair<double,uint_t>>> hits(n);
+            auto work = [&](uint_t i) {
+                double x, y, z, pra, pdec, pcdec;
+                idx.to_cartesian(ra.safe[i], dec.safe[i], x, y, z);
+                idx.to_proxy(ra.safe[i], dec.safe[i], pra, pdec, pcdec);
+
+                auto& h = hits[i];
+                idx.search(x, y, z, [&]() {
+                    return rindex;
+                }, [&](uint_t k) {
+                    uint_t j = idx.id[k];
+                    if (params.self && i == j) return;
+
+                    double sd = idx.proxy(pra, pdec, pcdec, k);
+                    if (sd <= rproxy) {
+                        h.push_back(std::make_pair(sd, j));
+                    }
+                });
+
+                std::sort(h.begin(), h.end());
+            };
+
+            std::vector<std::uint64_t> key;
+            std::vector<uint_t> order = impl::qxmatch_impl::sort_by_key(ra, dec, linear(), key);
+
+            thread::parallel_for pfor(params.thread);
+            pfor.verbose = params.verbose;
+            pfor.execute([&](uint_t k) {
+                work(order[k]);
+            }, n);
+
+            impl::qxmatch_impl::concatenate_matches(res, hits, [&](double d) {
+                return idx.proxy_to_true(d);
+            });
+
+            return res;
+        }
+    };
+}
+
 namespace astro {
     template<typename TypeR1, typename TypeD1, typename TypeR2, typename TypeD2>
     qxmatch_res qxmatch(const vec<1,TypeR1>& ra1, const vec<1,TypeD1>& dec1,
@@ -166,6 +757,25 @@ namespace astro {
             return res;
         }
 
+        if (!params.brute_force) {
+            // Search an index of the second catalog for the neighbors of the first
+            qxmatch_index index2(ra2, dec2, params.linear);
+            qxmatch_res tres = index2.match(ra1, dec1, params);
+            res.id = std::move(tres.id);
+            res.d = std::move(tres.d);
+
+            if (!params.self && !params.no_mirror) {
+                // Reverse search, with an index of the first catalog
+                qxmatch_index index1(ra1, dec1, params.linear);
+                params.nth = 1;
+                tres = index1.match(ra2, dec2, params);
+                res.rid = tres.id(0,_);
+                res.rd = tres.d(0,_);
+            }
+
+            return res;
+        }
+
         // Convert input coordinates into proper units, if required
         vec1d dra1, ddec1, dcdec1, dra2, ddec2, dcdec2;
         if (params.linear) {
@@ -180,15 +790,6 @@ namespace astro {
             dcdec2 = cos(ddec2);
         }
 
-        auto true_distance = [&](double x1, double y1, double x2, double y2) {
-            // Function to provide the distance between two points.
-            if (params.linear) {
-                return sqrt(sqr(x2 - x1) + sqr(y2 - y1));
-            } else {
-                return angdist(x1, y1, x2, y2);
-            }
-        };
-
         auto distance_proxy = [&](uint_t i, uint_t j) {
             // Function to provide a distance *indicator*.
             // Note that this is not the 'true' distance, but this it is sufficient
@@ -203,407 +804,61 @@ namespace astro {
             }
         };
 
-        auto true_to_proxy = vectorize_lambda([&](double dist) {
-            // Function to convert a "true" distance into the "proxy" distance
-            // used by "distance_proxy".
-            if (params.linear) {
-                return sqr(dist);
-            } else {
-                return sqr(sin(dist/(3600.0*(180.0/dpi)*2)));
-            }
-        });
         auto proxy_to_true = vectorize_lambda([&](double dist) {
             // Function to convert a "proxy" distance into the "true" distance.
-            if (params.linear) {
+            if (dist == dinf) {
+                return dinf;
+            } else if (params.linear) {
                 return sqrt(dist);
             } else {
                 return 3600.0*(180.0/dpi)*2*asin(sqrt(dist));
             }
         });
 
-        if (!params.brute_force && ra2.size() < 10) {
-            // The bucket algorithm was requested, but there are too few objects to
-            // cross match to. The brute force algorithm is likely to be the fastest.
-            params.brute_force = false;
-        }
+        auto work = [&] (uint_t i) {
+            for (uint_t j = 0; j < n2; ++j) {
+                if (params.self && i == j) continue;
 
-        if (!params.brute_force) {
-            // Get bounds of the fields
-            vec1d rra1  = {min(ra1),  max(ra1)};
-            vec1d rra2  = {min(ra2),  max(ra2)};
-            vec1d rdec1 = {min(dec1), max(dec1)};
-            vec1d rdec2 = {min(dec2), max(dec2)};
-
-            vec1d rra  = {std::min(rra1[0],  rra2[0]),  std::max(rra1[1],  rra2[1])};
-            vec1d rdec = {std::min(rdec1[0], rdec2[0]), std::max(rdec1[1], rdec2[1])};
-
-            // Choose a bucket size (arcsec)
-            const double overgrowth = 10.0;
-            uint_t nc2 = ceil(0.5*sqrt(dpi*ra2.size()/nth/overgrowth));
-            vec1d hx = vec1d{rra2[0],  rra2[0],  rra2[1],  rra2[1]};
-            vec1d hy = vec1d{rdec2[0], rdec2[1], rdec2[0], rdec2[1]};
-
-            double cell_size = params.linear ? sqrt((rra2[1] - rra2[0])*(rdec2[1] - rdec2[0])) :
-                std::max(3600.0*sqrt(field_area_hull(hx, hy))/nc2, 1.0);
-
-            // Be careful that RA and Dec are spherical coordinates
-            double dra, ddec;
-            if (params.linear) {
-                dra = cell_size;
-                ddec = cell_size;
-            } else {
-                dra = cell_size/abs(cos(mean(rdec2)*dpi/180.0))/3600.0;
-                ddec = cell_size/3600.0;
-            }
-
-            // Add some padding to prevent border issues
-            rra[0]  -= dra;
-            rra[1]  += dra;
-            rdec[0] -= ddec;
-            rdec[1] += ddec;
-
-            // Final number of buckets
-            uint_t nra  = (rra[1]  - rra[0])/dra;
-            uint_t ndec = (rdec[1] - rdec[0])/ddec;
-
-            // Build the buckets
-            struct bucket_t {
-                std::vector<uint_t> ids1;
-                std::vector<uint_t> ids2;
-            };
-
-            vec<2,bucket_t> buckets(nra, ndec);
-
-            // Fill the buckets
-            vec1u idx1 = floor((ra1 - rra[0])/dra);
-            vec1u idy1 = floor((dec1 - rdec[0])/ddec);
-            for (uint_t i : range(ra1)) {
-                buckets(idx1[i],idy1[i]).ids1.push_back(i);
-            }
-
-            vec1u idx2 = floor((ra2 - rra[0])/dra);
-            vec1u idy2 = floor((dec2 - rdec[0])/ddec);
-            for (uint_t j : range(ra2)) {
-                buckets(idx2[j],idy2[j]).ids2.push_back(j);
-            }
-
-            // Precompute generic bucket geometry
-            impl::qxmatch_impl::depth_cache depths(nra, ndec, cell_size);
-
-            auto work1 = [&] (uint_t i, impl::qxmatch_impl::depth_cache& tdepths, qxmatch_res& tres) {
-                int_t x0 = idx1[i];
-                int_t y0 = idy1[i];
-
-                // Compute the distance of this source from the bucket center
-                double cell_dist = true_distance(ra1[i], dec1[i],
-                    rra[0] + (x0+0.5)*dra, rdec[0] + (y0+0.5)*ddec);
-
-                // Scan the buckets around this source until all neighbors are found
-                uint_t d = 0;
-                double reached_distance = 0.0;
-
-                do {
-                    auto& depth = tdepths[d];
-                    for (uint_t b : range(depth.bx)) {
-                        int_t x = x0+depth.bx.safe[b];
-                        int_t y = y0+depth.by.safe[b];
-                        if (x < 0 || uint_t(x) >= nra || y < 0 || uint_t(y) >= ndec) continue;
-
-                        auto& bucket = buckets(uint_t(x),uint_t(y));
-                        for (uint_t j : bucket.ids2) {
-                            if (params.self && i == j) continue;
-
-                            auto sd = distance_proxy(i, j);
-
-                            // Compare this new distance to the largest one that is in the
-                            // Nth nearest neighbor list. If it is lower than that, we
-                            // insert it in the list, removing the old one, and sort the
-                            // whole thing so that the largest distance goes as the end of
-                            // the list.
-                            if (sd < tres.d.safe(nth-1,i)) {
-                                tres.id.safe(nth-1,i) = j;
-                                tres.d.safe(nth-1,i) = sd;
-                                uint_t k = nth-2;
-                                while (k != npos && tres.d.safe(k,i) > tres.d.safe(k+1,i)) {
-                                    std::swap(tres.d.safe(k,i), tres.d.safe(k+1,i));
-                                    std::swap(tres.id.safe(k,i), tres.id.safe(k+1,i));
-                                    --k;
-                                }
-                            }
-                        }
-                    }
-
-                    reached_distance = true_to_proxy(
-                        std::max(0.0, tdepths[d].max_dist - 1.1*cell_dist - 0.1*cell_size));
-
-                    ++d;
-                } while (tres.d.safe(nth-1,i) > reached_distance && d < tdepths.size());
-            };
-
-            auto work2 = [&] (uint_t j, impl::qxmatch_impl::depth_cache& tdepths, qxmatch_res& tres) {
-                int_t x0 = idx2[j];
-                int_t y0 = idy2[j];
-
-                // Compute the distance of this source from the bucket center
-                double cell_dist = true_distance(ra2[j], dec2[j],
-                    rra[0] + (x0+0.5)*dra, rdec[0] + (y0+0.5)*ddec);
-
-                // Scan the buckets around this source until all neighbors are found
-                uint_t d = 0;
-                double reached_distance = 0.0;
-
-                do {
-                    auto& depth = tdepths[d];
-                    for (uint_t b : range(depth.bx)) {
-                        int_t x = x0+depth.bx[b];
-                        int_t y = y0+depth.by[b];
-
-                        if (x < 0 || uint_t(x) >= nra || y < 0 || uint_t(y) >= ndec) continue;
-
-                        auto& bucket = buckets(uint_t(x),uint_t(y));
-                        for (uint_t i : bucket.ids1) {
-                            double sd = distance_proxy(i, j);
-
-                            // Just keep the nearest match
-                            if (sd < tres.rd.safe[j]) {
-                                tres.rd.safe[j] = sd;
-                                tres.rid.safe[j] = i;
-                            }
-                        }
-                    }
-
-                    reached_distance = true_to_proxy(
-                        std::max(0.0, tdepths[d].max_dist - 1.1*cell_dist - 0.1*cell_size));
-
-                    ++d;
-                } while (tres.rd[j] > reached_distance && d < tdepths.size());
-            };
-
-            if (params.thread <= 1) {
-                if (n2 < nth) {
-                    // We asked more neighbors than there are sources in the second catalog...
-                    // Lower 'nth' to prevent this from blocking the algorithm.
-                    nth = n2;
-                }
-
-                // When using a single thread, all the work is done in the main thread
-                auto p = progress_start(n1+(!params.self && !params.no_mirror ? n2 : 0));
-                for (uint_t i : range(ra1)) {
-                    work1(i, depths, res);
-                    if (params.verbose) progress(p, 31);
-                }
-                if (!params.self && !params.no_mirror) {
-                    for (uint_t j : range(ra2)) {
-                        work2(j, depths, res);
-                        if (params.verbose) progress(p, 31);
-                    }
-                }
-            } else {
-                // When using more than one thread, the work load is evenly separated between
-                // all the available threads, such that they should more or less all end at
-                // the same time.
-                std::atomic<uint_t> iter(0);
-
-                // Create the thread pool and launch the threads
-                std::vector<qxmatch_res> vres(params.thread);
-                for (auto& r : vres) {
-                    r.id  = replicate(npos, nth, n1);
-                    r.d   = replicate(dinf, nth, n1);
-                    r.rid = replicate(npos, n2);
-                    r.rd  = replicate(dinf, n2);
-                }
-
-                if (n2 < nth) {
-                    // We asked more neighbors than there are sources in the second catalog...
-                    // Lower 'nth' to prevent this from blocking the algorithm.
-                    nth = n2;
-                }
-
-                vec1u tbeg1(params.thread);
-                vec1u tend1(params.thread);
-                vec1u tbeg2(params.thread);
-                vec1u tend2(params.thread);
-                auto pool = thread::pool(params.thread);
-                uint_t total1 = 0;
-                uint_t total2 = 0;
-                uint_t assigned1 = floor(n1/float(params.thread));
-                uint_t assigned2 = floor(n2/float(params.thread));
-                for (uint_t t = 0; t < params.thread; ++t) {
-                    if (t == params.thread-1) {
-                        assigned1 = n1 - total1;
-                        assigned2 = n2 - total2;
-                    }
-
-                    tbeg1[t] = total1;
-                    tend1[t] = total1+assigned1;
-                    tbeg2[t] = total2;
-                    tend2[t] = total2+assigned2;
-
-                    pool[t].start([&iter, &work1, &work2, &vres,
-                        t, tbeg1, tbeg2, tend1, tend2, depths, params]() mutable {
-                        for (uint_t i = tbeg1[t]; i < tend1[t]; ++i) {
-                            work1(i, depths, vres[t]);
-                            ++iter;
-                        }
-
-                        if (!params.self && !params.no_mirror) {
-                            for (uint_t j = tbeg2[t]; j < tend2[t]; ++j) {
-                                work2(j, depths, vres[t]);
-                                ++iter;
-                            }
-                        }
-                    });
-
-                    total1 += assigned1;
-                    total2 += assigned2;
-                }
-
-                // Wait for the computation to finish.
-                // Here the main thread does nothing except sleeping, occasionally waking
-                // up once in a while to update the progress bar if any.
-                uint_t niter = n1+(!params.self && !params.no_mirror ? n2 : 0);
-                auto p = progress_start(niter);
-                while (iter < niter) {
-                    thread::sleep_for(0.2);
-                    if (params.verbose) print_progress(p, iter);
-                }
-
-                // By now, all threads should have ended their tasks.
-                // We must ask them to terminate nicely.
-                for (auto& t : pool) {
-                    t.join();
-                }
-
-                // Merge back the results of each thread
-                for (uint_t t = 0; t < params.thread; ++t) {
-                    auto ids = tbeg1[t]-_-(tend1[t]-1);
-                    res.id.safe(_,ids) = vres[t].id.safe(_,ids);
-                    res.d.safe(_,ids) = vres[t].d.safe(_,ids);
-
-                    if (!params.no_mirror) {
-                        ids = tbeg2[t]-_-(tend2[t]-1);
-                        res.rid.safe[ids] = vres[t].rid.safe[ids];
-                        res.rd.safe[ids] = vres[t].rd.safe[ids];
-                    }
-                }
-            }
-        } else {
-            auto work = [&, nth] (uint_t i, uint_t j, qxmatch_res& tres) {
                 double sd = distance_proxy(i, j);
 
                 // We compare this new distance to the largest one that is in the Nth
-                // nearest neighbor list. If it is lower than that, we insert it in the list,
-                // removing the old one, and sort the whole thing so that the largest distance
-                // goes as the end of the list.
-                if (sd < tres.d.safe(nth-1,i)) {
-                    tres.id.safe(nth-1,i) = j;
-                    tres.d.safe(nth-1,i) = sd;
+                // nearest neighbor list. If it is lower than that, we insert it in the
+                // list, removing the old one, and sort the whole thing so that the largest
+                // distance goes as the end of the list.
+                if (sd < res.d.safe(nth-1,i)) {
+                    res.id.safe(nth-1,i) = j;
+                    res.d.safe(nth-1,i) = sd;
                     uint_t k = nth-2;
-                    while (k != npos && tres.d.safe(k,i) > tres.d.safe(k+1,i)) {
-                        std::swap(tres.d.safe(k,i), tres.d.safe(k+1,i));
-                        std::swap(tres.id.safe(k,i), tres.id.safe(k+1,i));
+                    while (k != npos && res.d.safe(k,i) > res.d.safe(k+1,i)) {
+                        std::swap(res.d.safe(k,i), res.d.safe(k+1,i));
+                        std::swap(res.id.safe(k,i), res.id.safe(k+1,i));
                         --k;
                     }
                 }
+            }
+        };
 
-                // Take care of reverse search
-                if (!params.no_mirror && sd < tres.rd.safe[j]) {
-                    tres.rid.safe[j] = i;
-                    tres.rd.safe[j] = sd;
-                }
-            };
-
-            if (params.thread <= 1) {
-                // When using a single thread, all the work is done in the main thread
-                auto p = progress_start(n1);
-                for (uint_t i = 0; i < n1; ++i) {
-                    for (uint_t j = 0; j < n2; ++j) {
-                        if (params.self && i == j) continue;
-                        work(i,j,res);
-                    }
-
-                    if (params.verbose) progress(p);
-                }
-            } else {
-                // When using more than one thread, the work load is evenly separated between
-                // all the available threads, such that they should more or less all end at
-                // the same time.
-                std::atomic<uint_t> iter(0);
-
-                // Create the thread pool and launch the threads
-                std::vector<qxmatch_res> vres(params.thread);
-                for (auto& r : vres) {
-                    r.id = replicate(npos, nth, n1);
-                    r.d  = replicate(dinf, nth, n1);
-                    if (!params.no_mirror) {
-                        r.rid = replicate(npos, n2);
-                        r.rd  = replicate(dinf, n2);
-                    }
-                }
-
-                vec1u tbeg(params.thread);
-                vec1u tend(params.thread);
-                auto pool = thread::pool(params.thread);
-                uint_t total = 0;
-                uint_t assigned = floor(n1/float(params.thread));
-                for (uint_t t = 0; t < params.thread; ++t) {
-                    if (t == params.thread-1) {
-                        assigned = n1 - total;
-                    }
-
-                    tbeg[t] = total;
-                    tend[t] = total+assigned;
-
-                    pool[t].start([&iter, &work, &vres, t, tbeg, tend, params, n2]() {
-                        for (uint_t i = tbeg[t]; i < tend[t]; ++i) {
-                            for (uint_t j = 0; j < n2; ++j) {
-                                if (params.self && i == j) continue;
-                                work(i,j,vres[t]);
-                            }
-
-                            ++iter;
-                        }
-                    });
-
-                    total += assigned;
-                }
+        auto rwork = [&] (uint_t j) {
+            for (uint_t i = 0; i < n1; ++i) {
+                if (params.self && i == j) continue;
 
-                // Wait for the computation to finish.
-                // Here the main thread does nothing except sleeping, occasionally waking up
-                // once in a while to update the progress bar if any.
-                auto p = progress_start(n1);
-                while (iter < n1) {
-                    thread::sleep_for(0.2);
-                    if (params.verbose) print_progress(p, iter);
+                // Just keep the nearest match
+                double sd = distance_proxy(i, j);
+                if (sd < res.rd.safe[j]) {
+                    res.rid.safe[j] = i;
+                    res.rd.safe[j] = sd;
                 }
+            }
+        };
 
-                // By now, all threads should have ended their tasks.
-                // We must ask them to terminate nicely.
-                for (auto& t : pool) {
-                    t.join();
-                }
+        // Each thread writes its results directly in the output. The reverse search is
+        // done in a second pass, so that no two threads write to the same place.
+        thread::parallel_for pfor(params.thread);
+        pfor.verbose = params.verbose;
+        pfor.execute(work, n1);
 
-                // Merge back the results of each thread
-                for (uint_t t = 0; t < params.thread; ++t) {
-                    auto ids = tbeg[t]-_-(tend[t]-1);
-                    res.id.safe(_,ids) = vres[t].id.safe(_,ids);
-                    res.d.safe(_,ids) = vres[t].d.safe(_,ids);
-
-                    if (!params.no_mirror) {
-                        if (t == 0) {
-                            res.rid = vres[t].rid;
-                            res.rd = vres[t].rd;
-                        } else {
-                            for (uint_t j = 0; j < n2; ++j) {
-                                if (res.rd.safe[j] >= vres[t].rd.safe[j]) {
-                                    res.rid.safe[j] = vres[t].rid.safe[j];
-                                    res.rd.safe[j] = vres[t].rd.safe[j];
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+        if (!params.no_mirror) {
+            pfor.execute(rwork, n2);
         }
 
         // Convert the distance estimator to a real distance
@@ -633,6 +888,99 @@ namespace astro {
         return qxmatch(ra1, dec1, ra1, dec1, params);
     }
 
+    // Find all the sources of the second catalog within 'radius' of each source of the first
+    // catalog (in arcsec, or in coordinate units if 'params.linear' is true). Only
+    // 'thread', 'verbose', 'self', 'brute_force' and 'linear' are used from 'params'.
+    template<typename TypeR1, typename TypeD1, typename TypeR2, typename TypeD2>
+    qxmatch_sparse_res qxmatch_radius(const vec<1,TypeR1>& ra1, const vec<1,TypeD1>& dec1,
+        const vec<1,TypeR2>& ra2, const vec<1,TypeD2>& dec2, double radius,
+        qxmatch_params params = qxmatch_params{}) {
+
+        vif_check(ra1.dims == dec1.dims, "first RA and Dec dimensions do not match (",
+            ra1.dims, " vs ", dec1.dims, ")");
+        vif_check(ra2.dims == dec2.dims, "second RA and Dec dimensions do not match (",
+            ra2.dims, " vs ", dec2.dims, ")");
+        vif_check(radius >= 0.0, "search radius must be positive (got ", radius, ")");
+
+        if (!params.brute_force) {
+            // Nodes of the index that are further than 'radius' are never opened
+            qxmatch_index index2(ra2, dec2, params.linear);
+            return index2.match_radius(ra1, dec1, radius, params);
+        }
+
+        vif_check(count(!is_finite(ra1) || !is_finite(dec1)) == 0,
+            "first RA and Dec coordinates contain invalid values (infinite or NaN)");
+        vif_check(count(!is_finite(ra2) || !is_finite(dec2)) == 0,
+            "second RA and Dec coordinates contain invalid values (infinite or NaN)");
+
+        const uint_t n1 = ra1.size();
+        const uint_t n2 = ra2.size();
+
+        // Use the distance functions of the index, without building it
+        impl::qxmatch_impl::sky_index idx;
+        idx.linear = params.linear;
+
+        vec1d pra2(n2), pdec2(n2), pcdec2(n2);
+        for (uint_t j : range(n2)) {
+            idx.to_proxy(ra2.safe[j], dec2.safe[j], pra2.safe[j], pdec2.safe[j], pcdec2.safe[j]);
+        }
+
+        idx.ra = pra2.data.data();
+        idx.dec = pdec2.data.data();
+        idx.cdec = pcdec2.data.data();
+
+        const double rproxy = idx.true_to_proxy(radius);
+
+        std::vector<std::vector<std::pair<double,uint_t>>> hits(n1);
+        auto work = [&] (uint_t i) {
+            double pra, pdec, pcdec;
+            idx.to_proxy(ra1.safe[i], dec1.safe[i], pra, pdec, pcdec);
+
+            auto& h = hits[i];
+            for (uint_t j = 0; j < n2; ++j) {
+                if (params.self && i == j) continue;
+
+                double sd = idx.proxy(pra, pdec, pcdec, j);
+                if (sd <= rproxy) {
+                    h.push_back(std::make_pair(sd, j));
+                }
+            }
+
+            std::sort(h.begin(), h.end());
+        };
+
+        thread::parallel_for pfor(params.thread);
+        pfor.verbose = params.verbose;
+        pfor.execute(work, n1);
+
+        qxmatch_sparse_res res;
+        impl::qxmatch_impl::concatenate_matches(res, hits, [&](double d) {
+            return idx.proxy_to_true(d);
+        });
+
+        return res;
+    }
+
+    template<typename TypeR1, typename TypeD1>
+    qxmatch_sparse_res qxmatch_radius(const vec<1,TypeR1>& ra1, const vec<1,TypeD1>& dec1,
+        double radius, qxmatch_params params = qxmatch_params{}) {
+        params.self = true;
+        return qxmatch_radius(ra1, dec1, ra1, dec1, radius, params);
+    }
+
+    template<typename C1, typename C2,
+        typename enable = typename std::enable_if<!meta::is_vec<C1>::value>::type>
+    qxmatch_sparse_res qxmatch_radius(const C1& cat1, const C2& cat2, double radius,
+        qxmatch_params params = qxmatch_params{}) {
+        return qxmatch_radius(cat1.ra, cat1.dec, cat2.ra, cat2.dec, radius, params);
+    }
+
+    template<typename C1, typename enable = typename std::enable_if<!meta::is_vec<C1>::value>::type>
+    qxmatch_sparse_res qxmatch_radius(const C1& cat1, double radius,
+        qxmatch_params params = qxmatch_params{}) {
+        return qxmatch_radius(cat1.ra, cat1.dec, radius, params);
+    }
+
     struct id_pair {
         vec1u id1, id2;
         vec1u lost;
@@ -678,9 +1026,13 @@ namespace astro {
     #endif
 
     struct qdist_params {
+        uint_t thread = 1u;
         bool verbose = false;
     };
 
+    // Angular distance (in arcsec) between all pairs of sources. Only the lower triangle
+    // (j > i in ret(j,i)) is filled. This needs n^2 values in memory: for large catalogs,
+    // use qdist_condensed() or qdist_radius() instead.
     template<typename TypeR, typename TypeD>
     vec2d qdist(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
         qdist_params params = qdist_params{}) {
@@ -703,17 +1055,92 @@ namespace astro {
             return 3600.0*(180.0/dpi)*2*asin(sqrt(d));
         };
 
-        // When using a single thread, all the work is done in the main thread
-        auto p = progress_start(n*(n-1)/2);
-        for (uint_t i : range(n)) {
+        // The cost of row i is proportional to n-i, so rows are handed out in small chunks
+        thread::parallel_for pfor(params.thread);
+        pfor.verbose = params.verbose;
+        pfor.chunk_size = 16;
+        pfor.execute([&](uint_t i) {
+            for (uint_t j : range(i+1, n)) {
+                ret.safe(j,i) = distance(i, j);
+            }
+        }, n);
+
+        return ret;
+    }
+
+    // Index of the pair (i,j), with i < j, in the output of qdist_condensed()
+    inline uint_t qdist_condensed_index(uint_t n, uint_t i, uint_t j) {
+        return n*i - i*(i+1)/2 + (j - i - 1);
+    }
+
+    // Same as qdist(), but only the n*(n-1)/2 distances of the upper triangle are stored,
+    // row after row: d(0,1), d(0,2), ..., d(0,n-1), d(1,2), ... (see qdist_condensed_index()).
+    template<typename TypeR, typename TypeD>
+    vec1d qdist_condensed(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
+        qdist_params params = qdist_params{}) {
+
+        vif_check(ra.dims == dec.dims, "first RA and Dec dimensions do not match (",
+            ra.dims, " vs ", dec.dims, ")");
+
+        const uint_t n = ra.size();
+        vec1d ret(n > 1 ? n*(n-1)/2 : 0);
+
+        const double d2r = dpi/180.0;
+        auto dra  = ra*d2r;
+        auto ddec = dec*d2r;
+        auto dcdec = cos(ddec);
+
+        // The cost of row i is proportional to n-i, so rows are handed out in small chunks
+        thread::parallel_for pfor(params.thread);
+        pfor.verbose = params.verbose;
+        pfor.chunk_size = 16;
+        pfor.execute([&](uint_t i) {
+            uint_t k = (i+1 < n ? qdist_condensed_index(n, i, i+1) : 0);
             for (uint_t j : range(i+1, n)) {
-                ret(j,i) = distance(i, j);
+                double sra = sin(0.5*(dra.safe[j] - dra.safe[i]));
+                double sde = sin(0.5*(ddec.safe[j] - ddec.safe[i]));
+                double d = sde*sde + sra*sra*dcdec.safe[j]*dcdec.safe[i];
+                ret.safe[k] = 3600.0*(180.0/dpi)*2*asin(sqrt(d));
+                ++k;
+            }
+        }, n);
 
-                if (params.verbose) progress(p, 113);
+        return ret;
+    }
+
+    // Pairs of sources closer than 'radius' (in arcsec), found with a spatial index. Each
+    // pair (i,j) is only listed once, among the matches of i, with j > i.
+    template<typename TypeR, typename TypeD>
+    qxmatch_sparse_res qdist_radius(const vec<1,TypeR>& ra, const vec<1,TypeD>& dec,
+        double radius, qdist_params params = qdist_params{}) {
+
+        qxmatch_params p;
+        p.thread = params.thread;
+        p.verbose = params.verbose;
+        qxmatch_sparse_res r = qxmatch_radius(ra, dec, radius, p);
+
+        // Remove the pairs with j <= i, in place
+        const uint_t n = ra.size();
+        uint_t o = 0;
+        for (uint_t i : range(n)) {
+            const uint_t k0 = r.offset.safe[i], k1 = r.offset.safe[i+1];
+            r.offset.safe[i] = o;
+            for (uint_t k = k0; k < k1; ++k) {
+                if (r.id.safe[k] > i) {
+                    r.id.safe[o] = r.id.safe[k];
+                    r.d.safe[o] = r.d.safe[k];
+                    ++o;
+                }
             }
         }
 
-        return ret;
+        r.offset.safe[n] = o;
+        r.id.resize(o);
+        r.d.resize(o);
+        r.id.data.shrink_to_fit();
+        r.d.data.shrink_to_fit();
+
+        return r;
     }
 }
 }
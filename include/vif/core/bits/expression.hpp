@@ -0,0 +1,265 @@
+#ifndef VIF_INCLUDING_CORE_VEC_BITS
+#error this file is not meant to be included separately, include "vif/core/vec.hpp" instead
+#endif
+
+namespace vif {
+    ////////////////////////////////////////////
+    //           Lazy expressions             //
+    ////////////////////////////////////////////
+
+    // Operators on vectors are eager: 'a*b + c*d' creates one temporary vector per
+    // operator. Wrapping one of the operands with lazy() instead creates an expression
+    // tree, where each node only stores references to its operands. The expression is
+    // evaluated in a single loop when it is assigned to a vector (or fed to a reduction
+    // like total()), with no temporary vector allocated:
+    //
+    //     vec2d r = lazy(a)*b + c*d - e;
+    //
+    // Note: nodes only store references, so an expression must be evaluated within the
+    // statement where it is built. Do not store expressions with 'auto'.
+
+    namespace impl {
+        // Leaf node: reference to an existing vector (or view)
+        template<std::size_t Dim, typename Type>
+        struct lazy_leaf : lazy_expr_base {
+            static const std::size_t dim = Dim;
+            using value_type = meta::rtype_t<Type>;
+
+            const vec<Dim,Type>& v;
+
+            explicit lazy_leaf(const vec<Dim,Type>& tv) : v(tv) {}
+
+            const std::array<uint_t,Dim>& dims() const {
+                return v.dims;
+            }
+
+            uint_t size() const {
+                return v.size();
+            }
+
+            const value_type& operator[] (uint_t i) const {
+                return v.safe[i];
+            }
+
+            template<typename V>
+            bool view_same(const V& t) const {
+                return v.view_same(t);
+            }
+        };
+
+        // Leaf node: scalar value, broadcast to all elements
+        template<typename T>
+        struct lazy_scalar {
+            static const std::size_t dim = 0;
+            using value_type = T;
+
+            T value;
+
+            explicit lazy_scalar(const T& t) : value(t) {}
+
+            const value_type& operator[] (uint_t) const {
+                return value;
+            }
+
+            template<typename V>
+            bool view_same(const V&) const {
+                return false;
+            }
+        };
+
+        // Operations
+        #define VIF_LAZY_OPERATION(name, op) \
+            struct lazy_op_##name { \
+                static const char* symbol() { \
+                    return #op; \
+                } \
+                template<typename T, typename U> \
+                static auto apply(const T& t, const U& u) -> decltype(t op u) { \
+                    return t op u; \
+                } \
+            };
+
+        VIF_LAZY_OPERATION(mul, *)
+        VIF_LAZY_OPERATION(div, /)
+        VIF_LAZY_OPERATION(mod, %)
+        VIF_LAZY_OPERATION(add, +)
+        VIF_LAZY_OPERATION(sub, -)
+
+        #undef VIF_LAZY_OPERATION
+
+        // Get the dimensions of a binary node from its operands
+        template<std::size_t Dim, typename L, typename R>
+        std::array<uint_t,Dim> lazy_dims_(const L& l, const R& r, const char* op,
+            std::true_type, std::true_type) {
+            vif_check(l.dims() == r.dims(), "incompatible dimensions in operator '", op,
+                "' (", l.dims(), " vs ", r.dims(), ")");
+            return l.dims();
+        }
+
+        template<std::size_t Dim, typename L, typename R>
+        std::array<uint_t,Dim> lazy_dims_(const L& l, const R&, const char*,
+            std::true_type, std::false_type) {
+            return l.dims();
+        }
+
+        template<std::size_t Dim, typename L, typename R>
+        std::array<uint_t,Dim> lazy_dims_(const L&, const R& r, const char*,
+            std::false_type, std::true_type) {
+            return r.dims();
+        }
+
+        // Binary node: element-wise operation between two nodes
+        template<typename Op, typename L, typename R>
+        struct lazy_binary : lazy_expr_base {
+            static_assert(L::dim == 0 || R::dim == 0 || L::dim == R::dim,
+                "incompatible number of dimensions in lazy expression");
+
+            static const std::size_t dim = (L::dim > R::dim ? L::dim : R::dim);
+            using value_type = typename std::decay<decltype(Op::apply(
+                std::declval<typename L::value_type>(), std::declval<typename R::value_type>()
+            ))>::type;
+
+            L l;
+            R r;
+            std::array<uint_t,dim> dims_;
+            uint_t size_ = 1;
+
+            lazy_binary(const L& tl, const R& tr) : l(tl), r(tr) {
+                dims_ = lazy_dims_<dim>(l, r, Op::symbol(),
+                    meta::bool_constant<L::dim != 0>{}, meta::bool_constant<R::dim != 0>{});
+                for (uint_t i = 0; i < dim; ++i) {
+                    size_ *= dims_[i];
+                }
+            }
+
+            const std::array<uint_t,dim>& dims() const {
+                return dims_;
+            }
+
+            uint_t size() const {
+                return size_;
+            }
+
+            value_type operator[] (uint_t i) const {
+                return Op::apply(l[i], r[i]);
+            }
+
+            template<typename V>
+            bool view_same(const V& t) const {
+                return l.view_same(t) || r.view_same(t);
+            }
+
+            vec<dim,value_type> concretise() const {
+                return *this;
+            }
+        };
+
+        // Unary node: negation
+        template<typename E>
+        struct lazy_negate : lazy_expr_base {
+            static const std::size_t dim = E::dim;
+            using value_type = typename std::decay<decltype(-std::declval<typename E::value_type>())>::type;
+
+            E e;
+
+            explicit lazy_negate(const E& te) : e(te) {}
+
+            const std::array<uint_t,dim>& dims() const {
+                return e.dims();
+            }
+
+            uint_t size() const {
+                return e.size();
+            }
+
+            value_type operator[] (uint_t i) const {
+                return -e[i];
+            }
+
+            template<typename V>
+            bool view_same(const V& t) const {
+                return e.view_same(t);
+            }
+
+            vec<dim,value_type> concretise() const {
+                return *this;
+            }
+        };
+
+        // Convert an operand into an expression node
+        template<typename T, typename enable = void>
+        struct lazy_node;
+
+        template<typename T>
+        struct lazy_node<T, typename std::enable_if<meta::is_lazy_expr<T>::value>::type> {
+            using type = T;
+            static const T& make(const T& t) {
+                return t;
+            }
+        };
+
+        template<std::size_t Dim, typename Type>
+        struct lazy_node<vec<Dim,Type>> {
+            using type = lazy_leaf<Dim,Type>;
+            static type make(const vec<Dim,Type>& v) {
+                return type(v);
+            }
+        };
+
+        template<typename T>
+        struct lazy_node<T, typename std::enable_if<meta::is_scalar<T>::value>::type> {
+            using type = lazy_scalar<T>;
+            static type make(const T& t) {
+                return type(t);
+            }
+        };
+
+        template<typename T>
+        using lazy_node_t = typename lazy_node<T>::type;
+
+        // Check if a pair of operands should produce a lazy expression
+        template<typename T>
+        struct is_lazy_operand : std::integral_constant<bool,
+            meta::is_lazy_expr<T>::value || meta::is_vec<T>::value || meta::is_scalar<T>::value> {};
+
+        template<typename L, typename R>
+        struct is_lazy_operand_pair : std::integral_constant<bool,
+            (meta::is_lazy_expr<L>::value || meta::is_lazy_expr<R>::value) &&
+            is_lazy_operand<L>::value && is_lazy_operand<R>::value> {};
+    }
+
+    // Start a lazy expression from a vector.
+    template<std::size_t Dim, typename Type>
+    impl::lazy_leaf<Dim,Type> lazy(const vec<Dim,Type>& v) {
+        return impl::lazy_leaf<Dim,Type>(v);
+    }
+
+    #define VIF_LAZY_OPERATOR(op, name) \
+        template<typename L, typename R, typename enable = typename std::enable_if< \
+            impl::is_lazy_operand_pair<L,R>::value>::type> \
+        impl::lazy_binary<impl::lazy_op_##name, impl::lazy_node_t<L>, impl::lazy_node_t<R>> \
+        operator op (const L& l, const R& r) { \
+            return impl::lazy_binary<impl::lazy_op_##name, impl::lazy_node_t<L>, impl::lazy_node_t<R>>( \
+                impl::lazy_node<L>::make(l), impl::lazy_node<R>::make(r)); \
+        }
+
+    VIF_LAZY_OPERATOR(*, mul)
+    VIF_LAZY_OPERATOR(/, div)
+    VIF_LAZY_OPERATOR(%, mod)
+    VIF_LAZY_OPERATOR(+, add)
+    VIF_LAZY_OPERATOR(-, sub)
+
+    #undef VIF_LAZY_OPERATOR
+
+    template<typename E, typename enable = typename std::enable_if<
+        meta::is_lazy_expr<E>::value>::type>
+    impl::lazy_negate<E> operator - (const E& e) {
+        return impl::lazy_negate<E>(e);
+    }
+
+    template<typename E, typename enable = typename std::enable_if<
+        meta::is_lazy_expr<E>::value>::type>
+    const E& operator + (const E& e) {
+        return e;
+    }
+}
@@ -313,6 +313,9 @@ namespace meta {
 }
 
 namespace impl {
+    // Base class of all lazy expression nodes.
+    struct lazy_expr_base {};
+
     namespace meta_impl {
         inline bool same_dims_or_scalar_(uint_t size) {
             return true;
@@ -356,6 +359,18 @@ namespace meta {
         return size == 0 || impl::meta_impl::same_dims_or_scalar_(size, args...);
     }
 
+    // Trait to identify lazy expression nodes (see "vif/core/bits/expression.hpp")
+    template<typename T>
+    using is_lazy_expr = std::is_base_of<impl::lazy_expr_base, typename std::decay<T>::type>;
+
+    // Return the number of dimensions of a lazy expression (0 if not an expression)
+    template<typename T, bool IsLazy = is_lazy_expr<T>::value>
+    struct lazy_expr_dim : std::integral_constant<std::size_t, 0> {};
+
+    template<typename T>
+    struct lazy_expr_dim<T,true> : std::integral_constant<std::size_t,
+        std::decay<T>::type::dim> {};
+
     // Trait to identify output types: vec<D,T>& or vec<D,T*>
     template<typename T>
     struct is_output_type : std::integral_constant<bool,
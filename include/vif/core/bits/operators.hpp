@@ -62,6 +62,14 @@ namespace vif {
                 std::declval<math_bake_type<U>>())>::type;
         };
 
+        // Check if the result of an operation is of type R, only instantiating op_res_t
+        // if Enable is true (i.e., for operands that are known to be compatible).
+        template<typename OP, typename T, typename U, typename R, bool Enable>
+        struct op_res_is_ : std::false_type {};
+
+        template<typename OP, typename T, typename U, typename R>
+        struct op_res_is_<OP, T, U, R, true> : std::is_same<typename op_res_t<OP,T,U>::type, R> {};
+
         template<typename T>
         const T& get_element_(const T& t, uint_t i) {
             return t;
@@ -78,19 +86,19 @@ namespace vif {
         vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> operator op (const vec<Dim,T>& v, const vec<Dim,U>& u) { \
             vif_check(v.dims == u.dims, "incompatible dimensions in operator '" #op \
                 "' (", v.dims, " vs ", u.dims, ")"); \
-            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; tv.reserve(v.size()); \
-            for (uint_t i : range(v)) { \
-                tv.data.push_back(impl::get_element_(v, i) op impl::get_element_(u, i)); \
-            } \
+            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; \
+            impl::parallel_fill(tv.data, v.size(), [&](uint_t i) { \
+                return impl::get_element_(v, i) op impl::get_element_(u, i); \
+            }); \
             return tv; \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
             meta::is_scalar<U>::value>::type> \
         vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> operator op (const vec<Dim,T>& v, const U& u) { \
-            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; tv.reserve(v.size()); \
-            for (uint_t i : range(v)) { \
-                tv.data.push_back(impl::get_element_(v, i) op u); \
-            } \
+            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; \
+            impl::parallel_fill(tv.data, v.size(), [&](uint_t i) { \
+                return impl::get_element_(v, i) op u; \
+            }); \
             return tv; \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
@@ -98,27 +106,26 @@ namespace vif {
         vec<Dim,T> operator op (vec<Dim,T>&& v, const vec<Dim,U>& u) { \
             vif_check(v.dims == u.dims, "incompatible dimensions in operator '" #op \
                 "' (", v.dims, " vs ", u.dims, ")"); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<T>(v.size(), [&](uint_t i) { \
                 v.data[i] sop impl::get_element_(u, i); \
-            } \
+            }); \
             return std::move(v); \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
-            std::is_same<typename impl::op_res_t<OP_TYPE(op),T,U>::type, T>::value && \
-            meta::is_scalar<U>::value>::type> \
+            impl::op_res_is_<OP_TYPE(op),T,U,T,meta::is_scalar<U>::value>::value>::type> \
         vec<Dim,T> operator op (vec<Dim,T>&& v, const U& u) { \
-            for (auto& t : v) { \
-                t sop u; \
-            } \
+            impl::parallel_each<T>(v.size(), [&](uint_t i) { \
+                v.data[i] sop u; \
+            }); \
             return std::move(v); \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
             meta::is_scalar<U>::value>::type> \
         vec<Dim,typename impl::op_res_t<OP_TYPE(op),U,T>::type> operator op (const U& u, const vec<Dim,T>& v) { \
-            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; tv.reserve(v.size()); \
-            for (uint_t i : range(v)) { \
-                tv.data.push_back(u op impl::get_element_(v, i)); \
-            } \
+            vec<Dim,typename impl::op_res_t<OP_TYPE(op),T,U>::type> tv; tv.dims = v.dims; \
+            impl::parallel_fill(tv.data, v.size(), [&](uint_t i) { \
+                return u op impl::get_element_(v, i); \
+            }); \
             return tv; \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
@@ -126,18 +133,17 @@ namespace vif {
         vec<Dim,T> operator op (const vec<Dim,U>& u, vec<Dim,T>&& v) { \
             vif_check(v.dims == u.dims, "incompatible dimensions in operator '" #op \
                 "' (", v.dims, " vs ", u.dims, ")"); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<T>(v.size(), [&](uint_t i) { \
                 v.data[i] = impl::get_element_(u, i) op v.data[i]; \
-            } \
+            }); \
             return std::move(v); \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
-            std::is_same<typename impl::op_res_t<OP_TYPE(op),U,T>::type, T>::value && \
-            meta::is_scalar<U>::value>::type> \
+            impl::op_res_is_<OP_TYPE(op),U,T,T,meta::is_scalar<U>::value>::value>::type> \
         vec<Dim,T> operator op (const U& u, vec<Dim,T>&& v) { \
-            for (auto& t : v) { \
-                t = u op t; \
-            } \
+            impl::parallel_each<T>(v.size(), [&](uint_t i) { \
+                v.data[i] = u op v.data[i]; \
+            }); \
             return std::move(v); \
         } \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if< \
@@ -146,9 +152,9 @@ namespace vif {
         vec<Dim,T> operator op (vec<Dim,T>&& v, vec<Dim,U>&& u) { \
             vif_check(v.dims == u.dims, "incompatible dimensions in operator '" #op \
                 "' (", v.dims, " vs ", u.dims, ")"); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<T>(v.size(), [&](uint_t i) { \
                 v.data[i] sop u.data[i]; \
-            } \
+            }); \
             return std::move(v); \
         }
 
@@ -165,18 +171,18 @@ namespace vif {
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if<!meta::is_vec<U>::value>::type> \
         vec<Dim,bool> operator op (const vec<Dim,T>& v, const U& u) { \
             vec<Dim,bool> tv(v.dims); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<meta::rtype_t<T>>(v.size(), [&](uint_t i) { \
                 tv.safe[i] = (v.safe[i] op u); \
-            } \
+            }); \
             return tv; \
         } \
         \
         template<std::size_t Dim, typename T, typename U, typename enable = typename std::enable_if<!meta::is_vec<U>::value>::type> \
         vec<Dim,bool> operator op (const U& u, const vec<Dim,T>& v) { \
             vec<Dim,bool> tv(v.dims); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<meta::rtype_t<T>>(v.size(), [&](uint_t i) { \
                 tv.safe[i] = (u op v.safe[i]); \
-            } \
+            }); \
             return tv; \
         } \
         \
@@ -185,9 +191,9 @@ namespace vif {
             vif_check(v.dims == u.dims, "incompatible dimensions in operator '" #op \
                 "' (", v.dims, " vs ", u.dims, ")"); \
             vec<Dim,bool> tv(v.dims); \
-            for (uint_t i : range(v)) { \
+            impl::parallel_each<meta::rtype_t<T>>(v.size(), [&](uint_t i) { \
                 tv.safe[i] = (v.safe[i] op u.safe[i]); \
-            } \
+            }); \
             return tv; \
         }
 
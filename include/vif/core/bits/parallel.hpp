@@ -0,0 +1,318 @@
+#ifndef VIF_INCLUDING_CORE_VEC_BITS
+#error this file is not meant to be included separately, include "vif/core/vec.hpp" instead
+#endif
+
+namespace vif {
+    ////////////////////////////////////////////
+    //          Parallel execution            //
+    ////////////////////////////////////////////
+
+    // By default, operations on vectors run on a single thread. Creating a parallel_scope
+    // allows element-wise operations (arithmetic and comparison operators, vectorized
+    // functions like sqrt() or exp()) and reductions (total(), mean(), min(), max(), rms(),
+    // stddev()) to be split across a pool of threads, until the scope is destroyed:
+    //
+    //     {
+    //         parallel_scope ps(16);       // use 16 threads (0: one per core)
+    //         vec2d r = sqrt(a*b + c);     // runs on 16 threads
+    //         double t = total(r);         // idem
+    //     }
+    //
+    // Only vectors with at least 'threshold' elements (second argument of the constructor)
+    // are processed in parallel, to avoid paying the synchronization cost on small vectors.
+    // The threads are created on first use and kept alive until the end of the program.
+    //
+    // Floating point sums are always computed by blocks of fixed size, which are then
+    // combined pairwise in a fixed order. The result therefore does not depend on the
+    // number of threads, and is the same with or without a parallel_scope.
+    //
+    // Note: the policy is local to the thread that creates the scope, and operations
+    // executed by the pool threads themselves are never parallelized further. Functions
+    // applied to vectors within a parallel scope must be thread-safe.
+
+    namespace impl {
+    namespace parallel_impl {
+        struct policy_t {
+            uint_t nthread = 1;
+            uint_t threshold = 65536;
+        };
+
+        inline policy_t& policy() {
+            static thread_local policy_t p;
+            return p;
+        }
+
+        // Size of the blocks used in reductions. This must not depend on the number of
+        // threads, to keep results reproducible.
+        static const uint_t reduce_chunk = 16384;
+
+        // Persistent pool of threads. The thread calling run() takes part in the work, so
+        // running with N threads uses N-1 threads from the pool.
+        class pool_t {
+            std::mutex run_mutex_;
+            std::mutex mutex_;
+            std::condition_variable start_cv_;
+            std::condition_variable done_cv_;
+            std::vector<std::thread> threads_;
+
+            const std::function<void(uint_t)>* job_ = nullptr;
+            uint_t nchunk_ = 0;
+            std::atomic<uint_t> next_;
+            uint_t nworker_ = 0;
+            uint_t pending_ = 0;
+            uint_t generation_ = 0;
+            std::exception_ptr error_;
+
+            // Exceptions thrown by the job are caught here and rethrown by run() once all
+            // the threads are done; the remaining chunks are then skipped
+            void work_() {
+                uint_t c;
+                while ((c = next_++) < nchunk_) {
+                    try {
+                        (*job_)(c);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> l(mutex_);
+                        if (!error_) {
+                            error_ = std::current_exception();
+                        }
+
+                        next_ = nchunk_;
+                    }
+                }
+            }
+
+            // Operations called from within the job must not start another one
+            struct serial_guard {
+                uint_t old_nthread;
+
+                serial_guard() : old_nthread(policy().nthread) {
+                    policy().nthread = 1;
+                }
+
+                ~serial_guard() {
+                    policy().nthread = old_nthread;
+                }
+            };
+
+            void loop_(uint_t id, uint_t gen) {
+                std::unique_lock<std::mutex> l(mutex_);
+                while (true) {
+                    start_cv_.wait(l, [&]() { return generation_ != gen; });
+                    gen = generation_;
+                    if (id >= nworker_) continue;
+
+                    l.unlock();
+                    work_();
+                    l.lock();
+
+                    if (--pending_ == 0) {
+                        done_cv_.notify_one();
+                    }
+                }
+            }
+
+        public :
+            pool_t() : next_(0) {}
+
+            // Call job(c) for all c in [0,nchunk), using up to 'nthread' threads
+            void run(uint_t nthread, uint_t nchunk, const std::function<void(uint_t)>& job) {
+                // Only one parallel job at a time; other callers run serially
+                std::unique_lock<std::mutex> rl(run_mutex_, std::try_to_lock);
+                if (!rl.owns_lock() || nthread <= 1 || nchunk <= 1) {
+                    for (uint_t c = 0; c < nchunk; ++c) {
+                        job(c);
+                    }
+                    return;
+                }
+
+                uint_t nw = std::min(nthread, nchunk) - 1;
+
+                {
+                    std::lock_guard<std::mutex> l(mutex_);
+                    while (threads_.size() < nw) {
+                        threads_.emplace_back(&pool_t::loop_, this, threads_.size(), generation_);
+                    }
+
+                    job_ = &job;
+                    nchunk_ = nchunk;
+                    next_ = 0;
+                    nworker_ = nw;
+                    pending_ = nw;
+                    ++generation_;
+                }
+
+                start_cv_.notify_all();
+
+                {
+                    serial_guard g;
+                    work_();
+                }
+
+                // Always wait for the workers, which still use 'job'
+                std::exception_ptr e;
+                {
+                    std::unique_lock<std::mutex> l(mutex_);
+                    done_cv_.wait(l, [&]() { return pending_ == 0; });
+                    job_ = nullptr;
+                    std::swap(e, error_);
+                }
+
+                if (e) {
+                    std::rethrow_exception(e);
+                }
+            }
+        };
+
+        // The pool is never destroyed, so that no thread is joined during static
+        // destruction (which could happen after a call to exit() from a pool thread).
+        inline pool_t& pool() {
+            static pool_t* p = new pool_t();
+            return *p;
+        }
+    }
+
+    // Check if a loop over 'n' elements should run in parallel
+    inline bool parallel_enabled(uint_t n) {
+        const parallel_impl::policy_t& p = parallel_impl::policy();
+        return p.nthread > 1 && n != 0 && n >= p.threshold;
+    }
+
+    // Call f(i0,i1) on sub-ranges covering [0,n), in parallel if enabled
+    template<typename F>
+    void parallel_range(uint_t n, F&& f) {
+        if (!parallel_enabled(n)) {
+            f(uint_t(0), n);
+            return;
+        }
+
+        const uint_t nthread = parallel_impl::policy().nthread;
+        const uint_t chunk = (n + 4*nthread - 1)/(4*nthread);
+        const uint_t nchunk = (n + chunk - 1)/chunk;
+        parallel_impl::pool().run(nthread, nchunk, [&](uint_t c) {
+            uint_t i0 = c*chunk;
+            f(i0, std::min(n, i0 + chunk));
+        });
+    }
+
+    // Call f(i) for all i in [0,n), in parallel if enabled and T is arithmetic.
+    // Each call must only modify the i-th element.
+    template<typename T, typename F>
+    void parallel_each_(uint_t n, F& f, std::true_type) {
+        parallel_range(n, [&](uint_t i0, uint_t i1) {
+            for (uint_t i = i0; i < i1; ++i) {
+                f(i);
+            }
+        });
+    }
+
+    template<typename T, typename F>
+    void parallel_each_(uint_t n, F& f, std::false_type) {
+        for (uint_t i = 0; i < n; ++i) {
+            f(i);
+        }
+    }
+
+    template<typename T, typename F>
+    void parallel_each(uint_t n, F&& f) {
+        parallel_each_<T>(n, f, std::is_arithmetic<T>{});
+    }
+
+    // Append f(i) for all i in [0,n) to an empty std::vector, in parallel if enabled
+    // and T is arithmetic.
+    template<typename T, typename F>
+    void parallel_fill_(std::vector<T>& data, uint_t n, F& f, std::false_type) {
+        data.reserve(n);
+        for (uint_t i = 0; i < n; ++i) {
+            data.push_back(f(i));
+        }
+    }
+
+    template<typename T, typename F>
+    void parallel_fill_(std::vector<T>& data, uint_t n, F& f, std::true_type) {
+        if (!parallel_enabled(n)) {
+            parallel_fill_(data, n, f, std::false_type{});
+            return;
+        }
+
+        data.resize(n);
+        T* d = data.data();
+        parallel_range(n, [&](uint_t i0, uint_t i1) {
+            for (uint_t i = i0; i < i1; ++i) {
+                d[i] = f(i);
+            }
+        });
+    }
+
+    template<typename T, typename F>
+    void parallel_fill(std::vector<T>& data, uint_t n, F&& f) {
+        parallel_fill_(data, n, f, std::is_arithmetic<T>{});
+    }
+
+    // Reduce [0,n) by blocks of fixed size: r = f(i0,i1) is computed for each block
+    // (in parallel if enabled), and the results are combined pairwise in a fixed order
+    // with combine(r1,r2), where r1 always comes from lower indices than r2.
+    template<typename T, typename F, typename C>
+    T parallel_reduce(uint_t n, F&& f, C&& combine) {
+        const uint_t chunk = parallel_impl::reduce_chunk;
+        if (n <= chunk) {
+            return f(uint_t(0), n);
+        }
+
+        const uint_t nchunk = (n + chunk - 1)/chunk;
+        std::vector<T> part(nchunk);
+        auto job = [&](uint_t c) {
+            uint_t i0 = c*chunk;
+            part[c] = f(i0, std::min(n, i0 + chunk));
+        };
+
+        if (parallel_enabled(n)) {
+            parallel_impl::pool().run(parallel_impl::policy().nthread, nchunk, job);
+        } else {
+            for (uint_t c = 0; c < nchunk; ++c) {
+                job(c);
+            }
+        }
+
+        for (uint_t s = 1; s < nchunk; s *= 2) {
+            for (uint_t c = 0; c + s < nchunk; c += 2*s) {
+                part[c] = combine(part[c], part[c+s]);
+            }
+        }
+
+        return part[0];
+    }
+    }
+
+    // Enable parallel execution of vector operations in the current thread, until the
+    // object is destroyed. 'nthread' is the total number of threads to use (0: as many as
+    // there are cores), 'threshold' is the minimum number of elements of a vector for it to
+    // be processed in parallel.
+    class parallel_scope {
+        impl::parallel_impl::policy_t old_;
+
+    public :
+        explicit parallel_scope(uint_t nthread, uint_t threshold = 65536) :
+            old_(impl::parallel_impl::policy()) {
+
+            if (nthread == 0) {
+                nthread = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            impl::parallel_impl::policy_t& p = impl::parallel_impl::policy();
+            p.nthread = nthread;
+            p.threshold = std::max(threshold, uint_t(1));
+        }
+
+        parallel_scope(const parallel_scope&) = delete;
+        parallel_scope& operator = (const parallel_scope&) = delete;
+
+        ~parallel_scope() {
+            impl::parallel_impl::policy() = old_;
+        }
+
+        // Number of threads used in this scope
+        uint_t nthread() const {
+            return impl::parallel_impl::policy().nthread;
+        }
+    };
+}
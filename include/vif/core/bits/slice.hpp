@@ -0,0 +1,311 @@
+#ifndef VIF_INCLUDING_CORE_VEC_BITS
+#error this file is not meant to be included separately, include "vif/core/vec.hpp" instead
+#endif
+
+namespace vif {
+    ////////////////////////////////////////////
+    //            Strided slices              //
+    ////////////////////////////////////////////
+
+    // Views created with ranges, as in 'img(_, 10-_-200)', store one pointer per element. A
+    // slice instead only stores a pointer to the first element, and the extent and stride
+    // of each dimension, so creating it costs O(1) memory and time regardless of its size:
+    //
+    //     auto row = img.slice(10, _);         // one row, 1D
+    //     img.slice(_, 10-_-200) *= 2.0;       // sub-block, 2D
+    //     vec2d cut = img.slice(5-_-9, 5-_-9); // copy of a sub-block
+    //
+    // Slices can only be built from integers and ranges. Indexing with a vector of indices
+    // requires the regular views described above. Slices are also lazy expressions (see
+    // lazy()), so they can be mixed with vectors in operations without creating temporaries.
+    //
+    // Note: like views, slices reference the data of the original vector and must not
+    // outlive it; any operation that resizes the vector invalidates them.
+
+    namespace impl {
+        // Build the base pointer, extents and strides of a slice from a list of indices
+        template<std::size_t Dim, std::size_t ODim, typename Type>
+        void slice_build_(const std::array<uint_t,Dim>&, const std::array<uint_t,Dim>&, Type*&,
+            std::array<uint_t,ODim>&, std::array<uint_t,ODim>&, meta::cte_t<Dim>, meta::cte_t<ODim>) {}
+
+        template<std::size_t Dim, std::size_t ODim, typename Type, std::size_t ID, std::size_t OD,
+            typename T, typename ... Args>
+        void slice_build_(const std::array<uint_t,Dim>& dims, const std::array<uint_t,Dim>& strides,
+            Type*& base, std::array<uint_t,ODim>& odims, std::array<uint_t,ODim>& ostrides,
+            meta::cte_t<ID>, meta::cte_t<OD>, const T& i, const Args& ... args);
+
+        template<std::size_t Dim, std::size_t ODim, typename Type, std::size_t ID, std::size_t OD,
+            typename T, typename ... Args>
+        void slice_build_impl_(const std::array<uint_t,Dim>& dims, const std::array<uint_t,Dim>& strides,
+            Type*& base, std::array<uint_t,ODim>& odims, std::array<uint_t,ODim>& ostrides,
+            meta::cte_t<ID>, meta::cte_t<OD>, std::false_type, const T& i, const Args& ... args) {
+
+            base += vec_access::to_idx<ID>(dims, i)*strides[ID];
+            slice_build_(dims, strides, base, odims, ostrides,
+                meta::cte_t<ID+1>{}, meta::cte_t<OD>{}, args...);
+        }
+
+        template<std::size_t Dim, std::size_t ODim, typename Type, std::size_t ID, std::size_t OD,
+            typename T, typename ... Args>
+        void slice_build_impl_(const std::array<uint_t,Dim>& dims, const std::array<uint_t,Dim>& strides,
+            Type*& base, std::array<uint_t,ODim>& odims, std::array<uint_t,ODim>& ostrides,
+            meta::cte_t<ID>, meta::cte_t<OD>, std::true_type, const T& rng, const Args& ... args) {
+
+            range_impl::check_bounds(rng, dims[ID]);
+            uint_t b = range_begin(rng, dims[ID]);
+            uint_t e = range_end(rng, dims[ID]);
+
+            base += b*strides[ID];
+            odims[OD] = (e > b ? e - b : 0);
+            ostrides[OD] = strides[ID];
+            slice_build_(dims, strides, base, odims, ostrides,
+                meta::cte_t<ID+1>{}, meta::cte_t<OD+1>{}, args...);
+        }
+
+        template<std::size_t Dim, std::size_t ODim, typename Type, std::size_t ID, std::size_t OD,
+            typename T, typename ... Args>
+        void slice_build_(const std::array<uint_t,Dim>& dims, const std::array<uint_t,Dim>& strides,
+            Type*& base, std::array<uint_t,ODim>& odims, std::array<uint_t,ODim>& ostrides,
+            meta::cte_t<ID> id, meta::cte_t<OD> od, const T& i, const Args& ... args) {
+
+            static_assert(std::is_integral<T>::value || meta::is_range<T>::value,
+                "slices can only be made with integers or ranges");
+            slice_build_impl_(dims, strides, base, odims, ostrides, id, od,
+                meta::is_range<T>{}, i, args...);
+        }
+
+        // Element-wise assignment operations
+        #define VIF_SLICE_OPERATION(name, op) \
+            struct slice_op_##name { \
+                template<typename T, typename U> \
+                static void apply(T& t, const U& u) { \
+                    t op u; \
+                } \
+            };
+
+        VIF_SLICE_OPERATION(assign, =)
+        VIF_SLICE_OPERATION(mul,   *=)
+        VIF_SLICE_OPERATION(div,   /=)
+        VIF_SLICE_OPERATION(mod,   %=)
+        VIF_SLICE_OPERATION(add,   +=)
+        VIF_SLICE_OPERATION(sub,   -=)
+
+        #undef VIF_SLICE_OPERATION
+    }
+
+    template<std::size_t Dim, typename Type>
+    struct vec_slice : impl::lazy_expr_base {
+        static_assert(Dim > 0, "cannot create a slice of dimension zero");
+
+        static const std::size_t dim = Dim;
+        using value_type = typename std::remove_const<Type>::type;
+        using vec_type = meta::constify<vec<Dim,value_type>, Type>;
+        using effective_type = vec<Dim,value_type>;
+        using dim_type = std::array<uint_t,Dim>;
+
+        // Data
+        void*    parent = nullptr;
+        Type*    base_ = nullptr;
+        dim_type dims_ = {{0}};
+        dim_type strides_ = {{0}};
+        uint_t   size_ = 0;
+
+        // Constructors
+        vec_slice() = default;
+        vec_slice(const vec_slice&) = default;
+
+        // Slice covering all the elements of a vector
+        explicit vec_slice(vec_type& v) : parent(static_cast<void*>(const_cast<vec<Dim,value_type>*>(&v))),
+            base_(reinterpret_cast<Type*>(v.data.data())), dims_(v.dims), size_(v.size()) {
+            for (uint_t i = 0; i < Dim; ++i) {
+                strides_[i] = v.pitch(i);
+            }
+        }
+
+        vec_slice(void* p, Type* b, const dim_type& d, const dim_type& s) :
+            parent(p), base_(b), dims_(d), strides_(s) {
+            size_ = 1;
+            for (uint_t i = 0; i < Dim; ++i) {
+                size_ *= dims_[i];
+            }
+        }
+
+        // Lazy expression interface
+        const dim_type& dims() const {
+            return dims_;
+        }
+
+        uint_t size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        uint_t stride(uint_t i) const {
+            return strides_[i];
+        }
+
+        // Offset of the i-th element (in row-major order) from the first element
+        uint_t offset(uint_t i) const {
+            uint_t o = 0;
+            for (uint_t d = Dim-1; d > 0; --d) {
+                o += (i % dims_[d])*strides_[d];
+                i /= dims_[d];
+            }
+            return o + i*strides_[0];
+        }
+
+        Type& operator [] (uint_t i) {
+            return base_[offset(i)];
+        }
+
+        const Type& operator [] (uint_t i) const {
+            return base_[offset(i)];
+        }
+
+        template<std::size_t D, typename T>
+        bool view_same(const vec<D,T>& v) const {
+            return static_cast<const void*>(&v) == parent;
+        }
+
+        template<std::size_t D, typename T>
+        bool view_same(const vec<D,T*>& v) const {
+            return v.parent == parent;
+        }
+
+        template<std::size_t D, typename T>
+        bool view_same(const vec_slice<D,T>& s) const {
+            return s.parent == parent;
+        }
+
+        // Sub-slicing
+        template<typename ... Args>
+        vec_slice<impl::vec_access::result_dim<Args...>::value, Type> slice(const Args& ... i) const {
+            static_assert(impl::vec_access::accessed_dim<Args...>::value == Dim,
+                "wrong number of indices for this slice");
+
+            const std::size_t ODim = impl::vec_access::result_dim<Args...>::value;
+            Type* b = base_;
+            std::array<uint_t,ODim> d, s;
+            impl::slice_build_(dims_, strides_, b, d, s, meta::cte_t<0>{}, meta::cte_t<0>{}, i...);
+            return vec_slice<ODim,Type>(parent, b, d, s);
+        }
+
+        // Element access
+        template<typename ... Args>
+        Type& operator () (const Args& ... i) const {
+            static_assert(impl::vec_access::result_dim<Args...>::value == 0,
+                "use slice() to access multiple elements");
+            static_assert(impl::vec_access::accessed_dim<Args...>::value == Dim,
+                "wrong number of indices for this slice");
+
+            Type* b = base_;
+            std::array<uint_t,0> d, s;
+            impl::slice_build_(dims_, strides_, b, d, s, meta::cte_t<0>{}, meta::cte_t<0>{}, i...);
+            return *b;
+        }
+
+        // Call f(i,o) for each element, with 'i' the flat index and 'o' the offset in memory
+        template<typename F>
+        void for_each_offset(F&& f) const {
+            dim_type idx = {{0}};
+            uint_t o = 0;
+            for (uint_t i = 0; i < size_; ++i) {
+                f(i, o);
+
+                for (uint_t d = Dim-1; ; --d) {
+                    ++idx[d];
+                    o += strides_[d];
+                    if (idx[d] < dims_[d] || d == 0) break;
+                    o -= idx[d]*strides_[d];
+                    idx[d] = 0;
+                }
+            }
+        }
+
+        // Assignment
+        template<typename Op, typename E>
+        void apply_(const char* op, const E& e) {
+            static_assert(E::dim == 0 || E::dim == Dim, "incompatible number of dimensions "
+                "in slice assignment");
+
+            apply_dims_(op, e, meta::bool_constant<E::dim != 0>{});
+
+            Type* b = base_;
+            vec<Dim,Type*> probe(impl::vec_ref_tag, parent);
+            if (e.view_same(probe)) {
+                // The expression reads the same data as this slice, evaluate into a
+                // temporary copy first to avoid aliasing issues.
+                vec<1,typename E::value_type> t;
+                t.reserve(size_);
+                for (uint_t i = 0; i < size_; ++i) {
+                    t.push_back(e[i]);
+                }
+
+                for_each_offset([&](uint_t i, uint_t o) {
+                    Op::apply(b[o], t.safe[i]);
+                });
+            } else {
+                for_each_offset([&](uint_t i, uint_t o) {
+                    Op::apply(b[o], e[i]);
+                });
+            }
+        }
+
+        template<typename E>
+        void apply_dims_(const char* op, const E& e, std::true_type) const {
+            vif_check(e.dims() == dims_, "incompatible dimensions in operator '", op,
+                "' (", dims_, " vs ", e.dims(), ")");
+        }
+
+        template<typename E>
+        void apply_dims_(const char*, const E&, std::false_type) const {}
+
+        #define VIF_SLICE_OPERATOR(op, name) \
+            template<typename T, typename enable = typename std::enable_if< \
+                impl::is_lazy_operand<T>::value>::type> \
+            vec_slice& operator op (const T& t) { \
+                apply_<impl::slice_op_##name>(#op, impl::lazy_node<T>::make(t)); \
+                return *this; \
+            }
+
+        VIF_SLICE_OPERATOR(=,  assign)
+        VIF_SLICE_OPERATOR(*=, mul)
+        VIF_SLICE_OPERATOR(/=, div)
+        VIF_SLICE_OPERATOR(%=, mod)
+        VIF_SLICE_OPERATOR(+=, add)
+        VIF_SLICE_OPERATOR(-=, sub)
+
+        #undef VIF_SLICE_OPERATOR
+
+        // Assigning a slice writes into the referenced data, it does not re-bind the slice
+        vec_slice& operator = (const vec_slice& s) {
+            apply_<impl::slice_op_assign>("=", s);
+            return *this;
+        }
+
+        // Conversions
+        effective_type concretise() const {
+            effective_type v(dims_);
+            const Type* b = base_;
+            for_each_offset([&](uint_t i, uint_t o) {
+                v.safe[i] = b[o];
+            });
+            return v;
+        }
+
+        // Build a regular view (one pointer per element) on the same data
+        vec<Dim,Type*> view() const {
+            vec<Dim,Type*> v(impl::vec_ref_tag, parent);
+            v.dims = dims_;
+            v.data.resize(size_);
+            Type* b = base_;
+            for_each_offset([&](uint_t i, uint_t o) {
+                v.data[i] = impl::ptr<value_type>(b[o]);
+            });
+            return v;
+        }
+    };
+}
@@ -12,19 +12,19 @@ namespace vif {
         auto name(const vec<Dim,Type>& v, const Args& ... args) -> \
             vec<Dim,decltype(name(v[0], args...))> { \
             using ntype = decltype(name(v[0], args...)); \
-            vec<Dim,ntype> r; r.dims = v.dims; r.data.reserve(v.size()); \
-            for (auto& t : v.data) { \
-                r.data.push_back(name(impl::dref<Type>(t), args...)); \
-            } \
+            vec<Dim,ntype> r; r.dims = v.dims; \
+            impl::parallel_fill(r.data, v.size(), [&](uint_t i) { \
+                return name(impl::dref<Type>(v.data[i]), args...); \
+            }); \
             return r; \
         } \
         template<std::size_t Dim, typename Type, typename ... Args> \
         auto name(vec<Dim,Type>&& v, const Args& ... args) -> typename std::enable_if< \
             !std::is_pointer<Type>::value && std::is_same<decltype(name(v[0], args...)), Type>::value, \
             vec<Dim,Type>>::type { \
-            for (auto& t : v) { \
-                t = name(t, args...); \
-            } \
+            impl::parallel_each<Type>(v.size(), [&](uint_t i) { \
+                v.safe[i] = name(v.safe[i], args...); \
+            }); \
             return std::move(v); \
         }
 
@@ -35,10 +35,10 @@ namespace vif {
             vif_check(v1.dims == v2.dims, "incompatible dimensions between V1 and V2 (", \
                 v1.dims, " vs. ", v2.dims, ")"); \
             using ntype = decltype(name(v1[0], v2[0], args...)); \
-            vec<D,ntype> r; r.dims = v1.dims; r.data.reserve(v1.size()); \
-            for (uint_t i : range(v1)) { \
-                r.data.push_back(name(v1.safe[i], v2.safe[i], args...)); \
-            } \
+            vec<D,ntype> r; r.dims = v1.dims; \
+            impl::parallel_fill(r.data, v1.size(), [&](uint_t i) { \
+                return name(v1.safe[i], v2.safe[i], args...); \
+            }); \
             return r; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
@@ -47,9 +47,9 @@ namespace vif {
             vec<D,T1>>::type { \
             vif_check(v1.dims == v2.dims, "incompatible dimensions between V1 and V2 (", \
                 v1.dims, " vs. ", v2.dims, ")"); \
-            for (uint_t i : range(v1)) { \
+            impl::parallel_each<T1>(v1.size(), [&](uint_t i) { \
                 v1.safe[i] = name(v1.safe[i], v2.safe[i], args...); \
-            } \
+            }); \
             return v1; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
@@ -58,9 +58,9 @@ namespace vif {
             vec<D,T2>>::type { \
             vif_check(v1.dims == v2.dims, "incompatible dimensions between V1 and V2 (", \
                 v1.dims, " vs. ", v2.dims, ")"); \
-            for (uint_t i : range(v1)) { \
+            impl::parallel_each<T2>(v1.size(), [&](uint_t i) { \
                 v2.safe[i] = name(v1.safe[i], v2.safe[i], args...); \
-            } \
+            }); \
             return v2; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
@@ -69,47 +69,47 @@ namespace vif {
             vec<D,T1>>::type { \
             vif_check(v1.dims == v2.dims, "incompatible dimensions between V1 and V2 (", \
                 v1.dims, " vs. ", v2.dims, ")"); \
-            for (uint_t i : range(v1)) { \
+            impl::parallel_each<T1>(v1.size(), [&](uint_t i) { \
                 v1.safe[i] = name(v1.safe[i], v2.safe[i], args...); \
-            } \
+            }); \
             return v1; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
         auto name(T1 v1, const vec<D,T2>& v2, const Args& ... args) -> typename std::enable_if<!meta::is_vec<T1>::value, \
             vec<D,decltype(name(v1, v2[0], args...))>>::type { \
             using ntype = decltype(name(v1, v2[0], args...)); \
-            vec<D,ntype> r; r.dims = v2.dims; r.data.reserve(v2.size()); \
-            for (uint_t i : range(v2)) { \
-                r.data.push_back(name(v1, v2.safe[i], args...)); \
-            } \
+            vec<D,ntype> r; r.dims = v2.dims; \
+            impl::parallel_fill(r.data, v2.size(), [&](uint_t i) { \
+                return name(v1, v2.safe[i], args...); \
+            }); \
             return r; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
         auto name(const vec<D,T1>& v1, T2 v2, const Args& ... args) -> typename std::enable_if<!meta::is_vec<T2>::value, \
             vec<D,decltype(name(v1[0], v2, args...))>>::type { \
             using ntype = decltype(name(v1[0], v2, args...)); \
-            vec<D,ntype> r; r.dims = v1.dims; r.data.reserve(v1.size()); \
-            for (uint_t i : range(v1)) { \
-                r.data.push_back(name(v1.safe[i], v2, args...)); \
-            } \
+            vec<D,ntype> r; r.dims = v1.dims; \
+            impl::parallel_fill(r.data, v1.size(), [&](uint_t i) { \
+                return name(v1.safe[i], v2, args...); \
+            }); \
             return r; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
         auto name(T1 v1, vec<D,T2>&& v2, const Args& ... args) -> typename std::enable_if<!meta::is_vec<T1>::value && \
             !std::is_pointer<T2>::value && std::is_same<decltype(name(v1, v2[0], args...)), T2>::value, \
             vec<D,decltype(name(v1, v2[0], args...))>>::type { \
-            for (uint_t i : range(v2)) { \
+            impl::parallel_each<T2>(v2.size(), [&](uint_t i) { \
                 v2.safe[i] = name(v1, v2.safe[i], args...); \
-            } \
+            }); \
             return v2; \
         } \
         template<std::size_t D, typename T1, typename T2, typename ... Args> \
         auto name(vec<D,T1>&& v1, T2 v2, const Args& ... args) -> typename std::enable_if<!meta::is_vec<T2>::value && \
             !std::is_pointer<T1>::value && std::is_same<decltype(name(v1[0], v2, args...)), T1>::value, \
             vec<D,decltype(name(v1[0], v2, args...))>>::type { \
-            for (uint_t i : range(v1)) { \
+            impl::parallel_each<T1>(v1.size(), [&](uint_t i) { \
                 v1.safe[i] = name(v1.safe[i], v2, args...); \
-            } \
+            }); \
             return v1; \
         } \
 
@@ -118,19 +118,19 @@ namespace vif {
         auto name(const vec<Dim,Type>& v, const Args& ... args) -> \
             vec<Dim,decltype(orig(v[0], args...))> { \
             using ntype = decltype(orig(v[0], args...)); \
-            vec<Dim,ntype> r; r.dims = v.dims; r.data.reserve(v.size()); \
-            for (auto& t : v.data) { \
-                r.data.push_back(orig(impl::dref<Type>(t), args...)); \
-            } \
+            vec<Dim,ntype> r; r.dims = v.dims; \
+            impl::parallel_fill(r.data, v.size(), [&](uint_t i) { \
+                return orig(impl::dref<Type>(v.data[i]), args...); \
+            }); \
             return r; \
         } \
         template<std::size_t Dim, typename Type, typename ... Args> \
         auto name(vec<Dim,Type>&& v, const Args& ... args) -> typename std::enable_if< \
             !std::is_pointer<Type>::value && std::is_same<decltype(orig(v[0], args...)), Type>::value, \
             vec<Dim,Type>>::type { \
-            for (auto& t : v) { \
-                t = orig(t, args...); \
-            } \
+            impl::parallel_each<Type>(v.size(), [&](uint_t i) { \
+                v.safe[i] = orig(v.safe[i], args...); \
+            }); \
             return std::move(v); \
         } \
         template<typename ... Args> \
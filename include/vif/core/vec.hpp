@@ -9,6 +9,12 @@
 #include <utility>
 #include <initializer_list>
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
 #include "vif/core/typedefs.hpp"
 #include "vif/core/range.hpp"
 #include "vif/core/meta.hpp"
@@ -27,6 +33,7 @@ namespace vif {
 // Helper code is located in separate headers for clarity
 #define VIF_INCLUDING_CORE_VEC_BITS
 #include "vif/core/bits/helpers.hpp"
+#include "vif/core/bits/parallel.hpp"
 #include "vif/core/bits/iterator.hpp"
 #include "vif/core/bits/access.hpp"
 #include "vif/core/bits/initializer_list.hpp"
@@ -40,6 +47,9 @@ namespace vif {
     template<std::size_t Dim, typename Type>
     struct vec;
 
+    template<std::size_t Dim, typename Type>
+    struct vec_slice;
+
     // Disable dimension zero
     template<typename Type>
     struct vec<0,Type> {};
@@ -133,11 +143,49 @@ namespace vif {
             }
         }
 
+        // Lazy expression evaluation
+        template<typename E, typename enable = typename std::enable_if<
+            meta::lazy_expr_dim<E>::value == Dim>::type>
+        vec(const E& e) : dims(e.dims()), safe(*this) {
+            static_assert(meta::vec_implicit_convertible<typename E::value_type,Type>::value,
+                "could not construct vector from non-convertible type");
+
+            const uint_t n = e.size();
+            data.reserve(n);
+            for (uint_t i = 0; i < n; ++i) {
+                data.push_back(e[i]);
+            }
+        }
+
         vec& operator = (meta::nested_initializer_list<Dim,meta::dtype_t<Type>> il) {
             impl::vec_ilist::helper<Dim, Type>::fill(*this, il);
             return *this;
         }
 
+        template<typename E, typename enable = typename std::enable_if<
+            meta::lazy_expr_dim<E>::value == Dim>::type>
+        vec& operator = (const E& e) {
+            static_assert(meta::vec_implicit_convertible<typename E::value_type,Type>::value,
+                "could not assign vectors of non-implicitly-convertible types");
+
+            if (e.dims() != dims || e.view_same(*this)) {
+                // The expression cannot be evaluated in place: either this vector needs to be
+                // resized (its data may be read by the expression), or a view to this vector
+                // reads elements in a different order than they are written. Evaluate into a
+                // new vector first.
+                *this = vec(e);
+            } else {
+                // Each element only depends on the elements at the same position, so the
+                // expression can be evaluated in place (even if it reads this vector).
+                const uint_t n = data.size();
+                for (uint_t i = 0; i < n; ++i) {
+                    data[i] = e[i];
+                }
+            }
+
+            return *this;
+        }
+
         vec& operator = (const vec& v) {
             data = v.data;
             dims = v.dims;
@@ -576,13 +624,13 @@ namespace vif {
                     for (uint_t i : range(data)) { \
                         t[i] = u.safe[i]; \
                     } \
-                    for (uint_t i : range(data)) { \
+                    impl::parallel_each<dtype>(data.size(), [&](uint_t i) { \
                         data[i] op t[i]; \
-                    } \
+                    }); \
                 } else { \
-                    for (uint_t i : range(data)) { \
+                    impl::parallel_each<dtype>(data.size(), [&](uint_t i) { \
                         data[i] op u.safe[i]; \
-                    } \
+                    }); \
                 } \
                 return *this; \
             } \
@@ -590,9 +638,9 @@ namespace vif {
                 meta::is_scalar<U>::value \
             >::type> \
             vec& operator op (const U& u) { \
-                for (auto& v : data) { \
-                    v op u; \
-                } \
+                impl::parallel_each<dtype>(data.size(), [&](uint_t i) { \
+                    data[i] op u; \
+                }); \
                 return *this; \
             }
 
@@ -670,6 +718,16 @@ namespace vif {
         impl::vec_access::strided_range<const vec,impl::raw_strided_iterator_policy<vec>> raw_stride(const Args& ... i) const {
             return impl::vec_access::strided_range<const vec,impl::raw_strided_iterator_policy<vec>>(*this, i...);
         }
+
+        template<typename ... Args>
+        vec_slice<impl::vec_access::result_dim<Args...>::value, Type> slice(const Args& ... i) {
+            return vec_slice<Dim,Type>(*this).slice(i...);
+        }
+
+        template<typename ... Args>
+        vec_slice<impl::vec_access::result_dim<Args...>::value, const Type> slice(const Args& ... i) const {
+            return vec_slice<Dim,const Type>(*this).slice(i...);
+        }
     };
 
 
@@ -749,6 +807,30 @@ namespace vif {
             return *this;
         }
 
+        template<typename E, typename enable = typename std::enable_if<
+            meta::lazy_expr_dim<E>::value == Dim>::type>
+        vec& operator = (const E& e) {
+            static_assert(meta::vec_implicit_convertible<typename E::value_type,Type>::value,
+                "could not assign vectors of non-implicitly-convertible types");
+            vif_check(data.size() == e.size(), "incompatible size in assignment (assigning ",
+                e.dims(), " to ", dims, ")");
+
+            if (e.view_same(*this)) {
+                // The expression reads the same data as this view, evaluate into a temporary
+                // copy first to avoid aliasing issues.
+                effective_type t = e;
+                for (uint_t i = 0; i < data.size(); ++i) {
+                    *data[i] = t.safe[i];
+                }
+            } else {
+                for (uint_t i = 0; i < data.size(); ++i) {
+                    *data[i] = e[i];
+                }
+            }
+
+            return *this;
+        }
+
         template<typename T>
         void assign_(const vec<Dim,T>& v) {
             using other_dtype = typename vec<Dim,T>::dtype;
@@ -1251,6 +1333,8 @@ namespace vif {
 #define VIF_INCLUDING_CORE_VEC_BITS
 #include "vif/core/bits/operators.hpp"
 #include "vif/core/bits/vectorize.hpp"
+#include "vif/core/bits/expression.hpp"
+#include "vif/core/bits/slice.hpp"
 #undef VIF_INCLUDING_CORE_VEC_BITS
 
 #endif
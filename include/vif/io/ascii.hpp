@@ -2,12 +2,22 @@
 #define VIF_IO_ASCII_HPP
 
 #include <fstream>
+#include <sstream>
+#include <locale>
+#include <clocale>
 #include <tuple>
 #include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
 #include "vif/core/vec.hpp"
 #include "vif/core/error.hpp"
 #include "vif/core/range.hpp"
 #include "vif/math/base.hpp"
+#include "vif/io/filesystem.hpp"
+#include "vif/utility/thread.hpp"
 
 namespace vif {
 namespace ascii {
@@ -23,6 +33,8 @@ namespace ascii {
         uint_t skip_first = 0;
         std::string delim = " \t";
         bool delim_single = false;
+        // Number of threads used to parse large files (0: one per core)
+        uint_t thread = 1;
 
         input_format() = default;
         input_format(bool sk, const std::string sp, uint_t sf, const std::string& d, bool ds) :
@@ -44,6 +56,8 @@ namespace ascii {
         std::string delim = " ";
         std::string header_chars = "# ";
         vec1s header;
+        // Write floating point values with as many digits as needed to read them back exactly
+        bool round_trip = false;
 
         output_format() = default;
         output_format(bool aw, uint_t mw, const std::string& d) :
@@ -75,76 +89,249 @@ namespace impl {
     namespace ascii_impl {
         using placeholder_t = vif::impl::placeholder_t;
 
+        // Split a line into words, without copying them. The line is not owned.
         struct line_splitter_t {
-            std::string line;
-            uint_t pos = 0;
+            const char* begin = nullptr;
+            const char* end = nullptr;
+            const char* pos = nullptr;
 
-            std::string delim = " \t";
+            std::string delim;
             bool delim_single = false;
+            bool is_delim[256];
 
-            bool skip_word() {
-                if (delim_single) {
-                    if (pos == line.npos) return false;
+            line_splitter_t() {
+                set_delim(" \t", false);
+            }
 
-                    if (pos != 0) {
-                        pos += delim.size();
-                    }
+            void set_delim(const std::string& d, bool single) {
+                vif_check(!d.empty(), "the column delimiter cannot be empty");
 
-                    uint_t p1 = line.find(delim, pos);
-                    if (p1 == line.npos) {
-                        pos = p1;
-                    } else {
-                        pos = p1 + delim.size();
-                    }
+                delim = d;
+                delim_single = single;
+                std::fill(is_delim, is_delim+256, false);
+                for (char c : delim) {
+                    is_delim[static_cast<unsigned char>(c)] = true;
+                }
+            }
 
-                    pos = p1;
+            void reset(const char* b, const char* e) {
+                begin = b;
+                end = e;
+                pos = b;
+            }
+
+            // Find the next word, and store its position in [wb,we)
+            bool next_word(const char*& wb, const char*& we) {
+                if (delim_single) {
+                    if (pos == nullptr) return false;
+
+                    wb = pos;
+                    we = std::search(pos, end, delim.begin(), delim.end());
+                    pos = (we == end ? nullptr : we + delim.size());
                 } else {
-                    uint_t p0 = line.find_first_not_of(delim, pos);
-                    if (p0 == line.npos) return false;
+                    const char* p0 = pos;
+                    while (p0 != end && is_delim[static_cast<unsigned char>(*p0)]) ++p0;
+                    if (p0 == end) return false;
+
+                    const char* p1 = p0;
+                    while (p1 != end && !is_delim[static_cast<unsigned char>(*p1)]) ++p1;
 
-                    pos = line.find_first_of(delim, p0);
+                    wb = p0;
+                    we = p1;
+                    pos = p1;
                 }
 
                 return true;
             }
 
             bool next_word(std::string& sub) {
-                if (delim_single) {
-                    if (pos == line.npos) return false;
+                const char* wb;
+                const char* we;
+                if (!next_word(wb, we)) return false;
+                sub.assign(wb, we);
+                return true;
+            }
 
-                    if (pos != 0) {
-                        pos += delim.size();
-                    }
+            bool skip_word() {
+                const char* wb;
+                const char* we;
+                return next_word(wb, we);
+            }
 
-                    uint_t p1 = line.find(delim, pos);
-                    if (p1 == line.npos) {
-                        sub = line.substr(pos);
-                        pos = p1;
-                    } else {
-                        sub = line.substr(pos, p1-pos);
-                        pos = p1 + delim.size();
-                    }
+            std::string line() const {
+                return std::string(begin, end);
+            }
+        };
 
-                    pos = p1;
+        // Parse numbers directly from a range of characters, without going through
+        // std::stringstream and independently of the current locale. Values that cannot be
+        // converted exactly by the fast path (long mantissas, large exponents) use a stream
+        // with the classic locale, and anything else falls back to from_string().
+        inline void trim_blanks_(const char*& b, const char*& e) {
+            while (b != e && (*b == ' ' || *b == '\t')) ++b;
+            while (e != b && (*(e-1) == ' ' || *(e-1) == '\t')) --e;
+        }
+
+        template<typename T>
+        bool parse_integer_(const char* b, const char* e, T& v) {
+            const char* b0 = b;
+            const char* e0 = e;
+            trim_blanks_(b, e);
+
+            bool neg = false;
+            if (b != e && (*b == '+' || *b == '-')) {
+                neg = (*b == '-');
+                ++b;
+            }
+
+            if (b == e || (neg && std::is_unsigned<T>::value)) {
+                return from_string(std::string(b0, e0), v);
+            }
+
+            const std::uint64_t vmax = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) +
+                (neg ? 1 : 0);
+
+            std::uint64_t acc = 0;
+            for (; b != e; ++b) {
+                unsigned d = static_cast<unsigned char>(*b) - '0';
+                if (d > 9 || acc > (vmax - d)/10) {
+                    return from_string(std::string(b0, e0), v);
+                }
+
+                acc = acc*10 + d;
+            }
+
+            v = (neg ? static_cast<T>(-static_cast<std::int64_t>(acc - 1) - 1) : static_cast<T>(acc));
+            return true;
+        }
+
+        inline double pow10_(int e) {
+            static const double p[] = {
+                1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            return p[e];
+        }
+
+        // Values too large for the type are an error, like with from_string(). This does not
+        // use strtod(), which depends on the C locale (LC_NUMERIC), but a stream using the
+        // classic locale.
+        template<typename T>
+        bool parse_float_slow_(const char* b, const char* e, T& v) {
+            std::istringstream ss(std::string(b, e));
+            ss.imbue(std::locale::classic());
+            ss >> v;
+            return !ss.fail() && std::abs(v) != std::numeric_limits<T>::infinity();
+        }
+
+        template<typename T>
+        bool parse_float_(const char* b, const char* e, T& v) {
+            const char* b0 = b;
+            const char* e0 = e;
+            trim_blanks_(b, e);
+
+            const char* p = b;
+            bool neg = false;
+            if (p != e && (*p == '+' || *p == '-')) {
+                neg = (*p == '-');
+                ++p;
+            }
+
+            // Mantissa, with at most 19 significant digits
+            std::uint64_t m = 0;
+            int nsig = 0, e10 = 0;
+            bool any = false, exact = true, dot = false;
+            for (; p != e; ++p) {
+                if (*p == '.' && !dot) {
+                    dot = true;
+                    continue;
+                }
+
+                unsigned d = static_cast<unsigned char>(*p) - '0';
+                if (d > 9) break;
+
+                any = true;
+                if (nsig < 19) {
+                    m = m*10 + d;
+                    if (m != 0) ++nsig;
+                    if (dot) --e10;
                 } else {
-                    uint_t p0 = line.find_first_not_of(delim, pos);
-                    if (p0 == line.npos) return false;
+                    if (d != 0) exact = false;
+                    if (!dot) ++e10;
+                }
+            }
 
-                    pos = line.find_first_of(delim, p0);
-                    if (pos == line.npos) {
-                        sub = line.substr(p0);
-                    } else {
-                        sub = line.substr(p0, pos-p0);
-                    }
+            // Exponent
+            if (any && p != e && (*p == 'e' || *p == 'E')) {
+                ++p;
+                bool eneg = false;
+                if (p != e && (*p == '+' || *p == '-')) {
+                    eneg = (*p == '-');
+                    ++p;
                 }
 
+                if (p == e) any = false;
+
+                int ex = 0;
+                for (; p != e; ++p) {
+                    unsigned d = static_cast<unsigned char>(*p) - '0';
+                    if (d > 9) break;
+                    if (ex < 100000) ex = ex*10 + d;
+                }
+
+                e10 += (eneg ? -ex : ex);
+            }
+
+            if (!any || p != e) {
+                // Not a plain number (NaN, Inf, or invalid)
+                return from_string(std::string(b0, e0), v);
+            }
+
+            if (m == 0) {
+                v = (neg ? -T(0) : T(0));
                 return true;
             }
 
-            void reset() {
-                pos = 0;
+            // When both the mantissa and the power of ten are exactly representable,
+            // a single multiplication or division is correctly rounded
+            const bool is_float = std::is_same<T,float>::value;
+            const std::uint64_t mmax = (is_float ? (std::uint64_t(1) << 24) : (std::uint64_t(1) << 53));
+            const int emax = (is_float ? 10 : 22);
+            if (exact && m <= mmax && e10 >= -emax && e10 <= emax) {
+                T r = T(m);
+                r = (e10 < 0 ? r/T(pow10_(-e10)) : r*T(pow10_(e10)));
+                v = (neg ? -r : r);
+                return true;
+            } else {
+                return parse_float_slow_(b, e, v);
             }
-        };
+        }
+
+        template<typename T>
+        bool parse_value_(const char* b, const char* e, T& v, std::true_type, std::false_type) {
+            return parse_integer_(b, e, v);
+        }
+
+        template<typename T>
+        bool parse_value_(const char* b, const char* e, T& v, std::false_type, std::true_type) {
+            return parse_float_(b, e, v);
+        }
+
+        template<typename T>
+        bool parse_value_(const char* b, const char* e, T& v, std::false_type, std::false_type) {
+            return from_string(std::string(b, e), v);
+        }
+
+        // Characters and booleans keep the behavior of from_string()
+        template<typename T>
+        bool parse_value(const char* b, const char* e, T& v) {
+            return parse_value_(b, e, v,
+                std::integral_constant<bool, std::is_integral<T>::value &&
+                    !std::is_same<T,bool>::value && (sizeof(T) > 1)>{},
+                std::integral_constant<bool, std::is_same<T,float>::value ||
+                    std::is_same<T,double>::value>{});
+        }
 
         template<typename T>
         struct is_tuple : std::false_type {};
@@ -215,15 +402,17 @@ namespace impl {
 
         template<typename T>
         void read_value_(line_splitter_t& spl, uint_t i, uint_t j, T& v) {
-            std::string fallback;
-            if (!spl.next_word(fallback)) {
+            const char* wb;
+            const char* we;
+            if (!spl.next_word(wb, we)) {
                 throw ascii::exception("cannot extract value from file, too few columns on line l."+
                     to_string(i+1));
             }
 
-            if (!from_string(fallback, v)) {
-                throw ascii::exception("cannot extract value '"+fallback+"' from file, wrong type for l."+
-                    to_string(i+1)+":"+to_string(j+1)+" (expected '"+pretty_type(T())+"'):\n"+spl.line);
+            if (!parse_value(wb, we, v)) {
+                throw ascii::exception("cannot extract value '"+std::string(wb, we)+"' from file, "
+                    "wrong type for l."+to_string(i+1)+":"+to_string(j+1)+" (expected '"+
+                    pretty_type(T())+"'):\n"+spl.line());
             }
         }
 
@@ -307,6 +496,112 @@ namespace impl {
     }
 }
 
+namespace impl {
+    namespace ascii_impl {
+        // End of the line starting at 'b', excluding the end-of-line characters
+        inline const char* line_end(const char* b, const char* end) {
+            const char* e = static_cast<const char*>(std::memchr(b, '\n', end - b));
+            if (!e) e = end;
+            while (e != b && (*(e-1) == '\r' || *(e-1) == '\n')) --e;
+            return e;
+        }
+
+        // Append to 'lines' the beginning of all the lines starting in [b,e) which are not
+        // empty and not comments. The last line may extend beyond 'e', up to 'end'.
+        inline void find_data_lines_(const char* b, const char* e, const char* end,
+            const ascii::input_format& opts, std::vector<const char*>& lines) {
+
+            const std::string& pattern = opts.skip_pattern;
+            // A pattern that does not start with a blank can only be found at the first
+            // non-blank character if it is there
+            const bool fast_skip = !pattern.empty() && pattern[0] != ' ' && pattern[0] != '\t';
+
+            while (b < e) {
+                const char* nl = static_cast<const char*>(std::memchr(b, '\n', end - b));
+                const char* le = (nl ? nl : end);
+                while (le != b && *(le-1) == '\r') --le;
+
+                const char* p = b;
+                while (p != le && (*p == ' ' || *p == '\t')) ++p;
+
+                bool skip = (p == le);
+                if (!skip && opts.auto_skip) {
+                    if (fast_skip) {
+                        skip = uint_t(le - p) >= pattern.size() &&
+                            std::equal(pattern.begin(), pattern.end(), p);
+                    } else {
+                        skip = std::search(b, le, pattern.begin(), pattern.end()) == p;
+                    }
+                }
+
+                if (!skip) {
+                    lines.push_back(b);
+                }
+
+                b = (nl ? nl + 1 : end);
+            }
+        }
+
+        // Minimum number of bytes given to each thread
+        static const uint_t parse_chunk_size = 4*1024*1024;
+
+        inline uint_t parse_threads(const ascii::input_format& opts, uint_t nbyte) {
+            uint_t nthread = opts.thread;
+            if (nthread == 0) {
+                nthread = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            return std::max(uint_t(1), std::min(nthread, nbyte/parse_chunk_size));
+        }
+
+        // Find the beginning of all the lines in [b,end) which are not empty, not comments,
+        // and not skipped by 'opts.skip_first'. Large files are split in byte ranges, each
+        // starting after a new line, and processed by several threads.
+        inline std::vector<const char*> find_data_lines(const char* b, const char* end,
+            const ascii::input_format& opts) {
+
+            std::vector<const char*> lines;
+            if (b == end) return lines;
+
+            const uint_t nbyte = end - b;
+            const uint_t nthread = parse_threads(opts, nbyte);
+            if (nthread <= 1) {
+                find_data_lines_(b, end, end, opts, lines);
+            } else {
+                // A line belongs to the range in which it starts
+                const uint_t nchunk = 4*nthread;
+                std::vector<const char*> starts(nchunk+1, end);
+                starts[0] = b;
+                for (uint_t c : range(1, nchunk)) {
+                    const char* p = b + c*(nbyte/nchunk);
+                    const char* nl = static_cast<const char*>(std::memchr(p - 1, '\n', end - p + 1));
+                    starts[c] = std::max(starts[c-1], nl ? nl + 1 : end);
+                }
+
+                std::vector<std::vector<const char*>> clines(nchunk);
+                thread::scheduler().execute(nthread, 0, nchunk, 1, [&](uint_t c0, uint_t c1) {
+                    for (uint_t c = c0; c < c1; ++c) {
+                        find_data_lines_(starts[c], starts[c+1], end, opts, clines[c]);
+                    }
+                });
+
+                uint_t ntot = 0;
+                for (auto& cl : clines) ntot += cl.size();
+                lines.reserve(ntot);
+                for (auto& cl : clines) {
+                    lines.insert(lines.end(), cl.begin(), cl.end());
+                    std::vector<const char*>().swap(cl);
+                }
+            }
+
+            uint_t nskip = std::min(opts.skip_first, uint_t(lines.size()));
+            lines.erase(lines.begin(), lines.begin() + nskip);
+
+            return lines;
+        }
+    }
+}
+
 namespace ascii {
     template<typename Input>
     bool getline(Input& in, std::string& out) {
@@ -321,57 +616,63 @@ namespace ascii {
 
     template<typename ... Args>
     void read_table(const std::string& name, const input_format& opts, Args&& ... args) {
-        vif_check(file::exists(name), "cannot open file '"+name+"'");
+        // The file is read only once, directly from memory (it is opened only once, so this
+        // also works with pipes)
+        file::mapped_file buffer;
+        vif_check(buffer.open(name), "cannot open file '"+name+"'");
 
         try {
             impl::ascii_impl::line_splitter_t spl;
-            spl.delim = opts.delim;
-            spl.delim_single = opts.delim_single;
-
-            std::ifstream file(name);
-
-            // Count number of lines
-            uint_t n = 0; {
-                while (!file.eof()) {
-                    ascii::getline(file, spl.line);
-
-                    auto p = spl.line.find_first_not_of(" \t");
-                    if (p == spl.line.npos || (opts.auto_skip && spl.line.find(opts.skip_pattern) == p)) {
-                        continue;
-                    }
+            spl.set_delim(opts.delim, opts.delim_single);
 
-                    ++n;
-                }
+            // Locate the lines containing data
+            std::vector<const char*> lines = impl::ascii_impl::find_data_lines(
+                buffer.data(), buffer.data() + buffer.size(), opts);
 
-                n -= opts.skip_first;
-            }
+            const uint_t n = lines.size();
 
             // Resize all vectors
             impl::ascii_impl::read_table_resize_(n, args...);
 
             // Read data
-            file.clear();
-            file.seekg(0);
-
-            uint_t i = 0;
-            uint_t to_skip = opts.skip_first;
-            while (!file.eof()) {
-                spl.reset();
-                ascii::getline(file, spl.line);
+            const char* end = buffer.data() + buffer.size();
+            auto read_lines = [&](impl::ascii_impl::line_splitter_t& tspl, uint_t i0, uint_t i1) {
+                for (uint_t i = i0; i < i1; ++i) {
+                    tspl.reset(lines[i], impl::ascii_impl::line_end(lines[i], end));
 
-                auto p = spl.line.find_first_not_of(" \t");
-                if (p == spl.line.npos || (opts.auto_skip && spl.line.find(opts.skip_pattern) == p)) {
-                    continue;
+                    uint_t j = 0;
+                    impl::ascii_impl::read_table_(tspl, i, j, args...);
                 }
+            };
 
-                if (to_skip > 0) {
-                    --to_skip;
-                    continue;
-                }
+            const uint_t nthread = impl::ascii_impl::parse_threads(opts, buffer.size());
+            if (nthread <= 1) {
+                read_lines(spl, 0, n);
+            } else {
+                // Each thread fills different rows. If errors occur, report the one on the
+                // first line, as when reading with a single thread.
+                std::mutex mutex;
+                uint_t first_error = npos;
+                std::string error;
+
+                thread::scheduler().execute(nthread, 0, n, std::max(uint_t(1), n/(64*nthread)),
+                    [&](uint_t i0, uint_t i1) {
+                    impl::ascii_impl::line_splitter_t tspl;
+                    tspl.set_delim(opts.delim, opts.delim_single);
+                    try {
+                        read_lines(tspl, i0, i1);
+                    } catch (ascii::exception& e) {
+                        std::lock_guard<std::mutex> l(mutex);
+                        if (i0 < first_error) {
+                            first_error = i0;
+                            error = e.what();
+                        }
+                    }
+                });
 
-                uint_t j = 0;
-                impl::ascii_impl::read_table_(spl, i, j, args...);
-                ++i;
+                if (first_error != npos) {
+                    throw ascii::exception(error);
+                }
             }
         } catch (ascii::exception& e) {
             vif_check(false, std::string(e.what())+" (reading "+name+")");
@@ -388,9 +689,165 @@ namespace ascii {
 
 namespace impl {
     namespace ascii_impl {
+        // A formatted cell, pointing either to the formatter's buffer or to the original string
+        struct cell_t {
+            const char* data;
+            uint_t size;
+        };
+
+        // Format values the same way as to_string(), without allocating memory.
+        // Note: snprintf() uses the decimal point of the C locale (LC_NUMERIC), while
+        // to_string() uses the classic locale; the decimal point is replaced by '.'.
+        struct cell_formatter {
+            bool round_trip = false;
+            char buf[64];
+            std::string tmp;
+            std::string point = std::localeconv()->decimal_point;
+
+            cell_t format(const std::string& s) {
+                return {s.data(), s.size()};
+            }
+
+            cell_t format(bool b) {
+                buf[0] = (b ? '1' : '0');
+                return {buf, 1};
+            }
+
+            template<typename T>
+            typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 1), cell_t>::type
+            format(T t) {
+                using utype = typename std::make_unsigned<T>::type;
+                char* e = buf + sizeof(buf);
+                char* p = e;
+                utype u = static_cast<utype>(t);
+                if (t < T(0)) u = utype(0) - u;
+
+                do {
+                    *--p = '0' + char(u % 10);
+                    u /= 10;
+                } while (u != 0);
+
+                if (t < T(0)) *--p = '-';
+
+                return {p, uint_t(e - p)};
+            }
+
+            cell_t format(float f) {
+                return round_trip ? shortest_(f, 6, 9) : printf_("%.*g", 6, f);
+            }
+
+            cell_t format(double d) {
+                return round_trip ? shortest_(d, 15, 17) : printf_("%.*g", 6, d);
+            }
+
+            // Floating point values with format tags
+            template<typename T>
+            typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value &&
+                !std::is_same<typename std::decay<T>::type, long double>::value, cell_t>::type
+            format(const impl::format_t<impl::format_scientific_t,T>& f) {
+                return printf_("%.*e", 6, f.obj);
+            }
+
+            template<typename T>
+            typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value &&
+                !std::is_same<typename std::decay<T>::type, long double>::value, cell_t>::type
+            format(const impl::format_t<impl::format_fixed_t,T>& f) {
+                return printf_("%.*f", 6, f.obj);
+            }
+
+            template<typename T>
+            typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value &&
+                !std::is_same<typename std::decay<T>::type, long double>::value, cell_t>::type
+            format(const impl::format_t<impl::format_precision_t,T>& f) {
+                return printf_("%.*g", f.fmt.pre, f.obj);
+            }
+
+            // Anything else goes through the output stream
+            template<typename T>
+            typename std::enable_if<!std::is_arithmetic<T>::value || sizeof(T) == 1 ||
+                std::is_same<T, long double>::value, cell_t>::type
+            format(const T& t) {
+                tmp = to_string(t);
+                return {tmp.data(), tmp.size()};
+            }
+
+            // Upper bound on the width of a formatted value, or npos if unknown
+            template<typename T>
+            uint_t max_width(const T&) const {
+                return std::is_same<T,bool>::value ? 1 :
+                    std::is_integral<T>::value && sizeof(T) > 1 ?
+                        std::numeric_limits<T>::digits10 + 2 : npos;
+            }
+
+            // Sign, significant digits, decimal point and exponent (e.g., "-1.23457e+38")
+            uint_t max_width(float) const {
+                return (round_trip ? 9 : 6) + 6;
+            }
+
+            uint_t max_width(double) const {
+                return (round_trip ? 17 : 6) + 7;
+            }
+
+        private :
+
+            // Replace the decimal point of the C locale by '.', in place
+            uint_t classic_point_(char* p, uint_t n) const {
+                if (point == ".") return n;
+
+                char* d = std::search(p, p+n, point.begin(), point.end());
+                if (d != p+n) {
+                    *d = '.';
+                    std::memmove(d+1, d+point.size(), (p+n) - (d+point.size()));
+                    n -= point.size()-1;
+                }
+
+                return n;
+            }
+
+            cell_t printf_(const char* fmt, uint_t pre, double d) {
+                int n = std::snprintf(buf, sizeof(buf), fmt, int(pre), d);
+                if (n < 0 || uint_t(n) >= sizeof(buf)) {
+                    // Very large numbers in fixed notation
+                    tmp.resize(std::snprintf(nullptr, 0, fmt, int(pre), d) + 1);
+                    n = std::snprintf(&tmp[0], tmp.size(), fmt, int(pre), d);
+                    tmp.resize(classic_point_(&tmp[0], n));
+                    return {tmp.data(), tmp.size()};
+                }
+
+                return {buf, classic_point_(buf, n)};
+            }
+
+            // Use the smallest number of digits that reads back to the same value
+            // (strtod() reads back in the same locale as snprintf())
+            template<typename T>
+            cell_t shortest_(T t, int pmin, int pmax) {
+                int n = 0;
+                for (int p = pmin; p <= pmax; ++p) {
+                    n = std::snprintf(buf, sizeof(buf), "%.*g", p, double(t));
+                    if (p == pmax || !std::isfinite(t)) break;
+
+                    T r;
+                    if (std::is_same<T,float>::value) {
+                        r = std::strtof(buf, nullptr);
+                    } else {
+                        r = std::strtod(buf, nullptr);
+                    }
+
+                    if (r == t) break;
+                }
+
+                return {buf, classic_point_(buf, n)};
+            }
+        };
+
+        // Write formatted cells in a memory buffer, flushed to the file in large blocks
         struct file_writer {
             std::ofstream out;
             std::string delim;
+            cell_formatter fmt;
+
+            std::string buffer;
+            static const uint_t block_size = 1024*1024;
 
             uint_t j = 0;
             vec1u cwidth;
@@ -398,17 +855,47 @@ namespace impl {
             vec1s header;
             std::string header_chars;
 
+            file_writer() {
+                buffer.reserve(block_size + 4096);
+            }
+
+            void flush() {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+
             void end_line() {
-                out << '\n';
+                buffer += '\n';
                 j = 0;
+
+                if (buffer.size() >= block_size) {
+                    flush();
+                }
             }
 
-            void write(std::string s) {
+            void write_cell(const cell_t& c, uint_t w) {
+                if (c.size < w) {
+                    buffer.append(w - c.size, ' ');
+                }
+
+                buffer.append(c.data, c.size);
+            }
+
+            void write_cell_left(const cell_t& c, uint_t w) {
+                buffer.append(c.data, c.size);
+
+                if (c.size < w) {
+                    buffer.append(w - c.size, ' ');
+                }
+            }
+
+            template<typename T>
+            void write(const T& t) {
                 if (j != 0) {
-                    out << delim;
+                    buffer += delim;
                 }
 
-                out << align_right(std::move(s), cwidth[j]);
+                write_cell(fmt.format(t), cwidth.safe[j]);
 
                 ++j;
             }
@@ -416,7 +903,7 @@ namespace impl {
             void write_header() {
                 if (header.empty()) return;
 
-                out << header_chars;
+                buffer += header_chars;
                 for (uint_t i : range(header)) {
                     uint_t hw = cwidth[i];
                     if (i == 0 && hw >= header_chars.size()) {
@@ -424,19 +911,19 @@ namespace impl {
                     }
 
                     if (i != 0) {
-                        out << delim;
+                        buffer += delim;
                     }
 
-                    out << align_right(header[i], hw);
+                    write_cell(fmt.format(header[i]), hw);
                 }
 
-                out << "\n";
+                buffer += '\n';
             }
         };
 
-        struct cache_writer {
-            vec2s data;
-            uint_t k = 0;
+        // Compute the width of each column, without keeping the formatted values
+        struct width_writer {
+            cell_formatter fmt;
 
             uint_t j = 0;
             vec1u cwidth;
@@ -445,9 +932,14 @@ namespace impl {
                 j = 0;
             }
 
-            void write(std::string s) {
-                data.safe[k] = align_right(std::move(s), cwidth[j]);
-                ++k;
+            template<typename T>
+            void write(const T& t) {
+                uint_t& w = cwidth.safe[j];
+                // Skip formatting if this column cannot get any wider
+                if (w < fmt.max_width(t)) {
+                    w = std::max(w, fmt.format(t).size);
+                }
+
                 ++j;
             }
         };
@@ -546,8 +1038,8 @@ namespace impl {
         template<typename O, uint_t D, typename Type, typename ... Args>
         void write_table_do_(O&& out, uint_t i, const vec<D,Type>& v, const Args& ... args) {
             using DType = typename std::decay<decltype(v[0])>::type;
-            write_table_do_impl_(out, i, v, [](const DType& t) {
-                return to_string(t);
+            write_table_do_impl_(out, i, v, [](const DType& t) -> const DType& {
+                return t;
             }, args...);
         }
 
@@ -555,7 +1047,7 @@ namespace impl {
         void write_table_do_(O&& out, uint_t i, const F& v, const Args& ... args) {
             using DType = typename std::decay<decltype(v.obj[0])>::type;
             write_table_do_impl_(out, i, v.obj, [&](const DType& t) {
-                return to_string(v.forward(t));
+                return v.forward(t);
             }, args...);
         }
 
@@ -584,8 +1076,8 @@ namespace impl {
             const Args& ... args) {
 
             using DType = typename std::decay<decltype(v[0])>::type;
-            write_table_do_tuple_impl_(out, i, k, v, [](const DType& t) {
-                return to_string(t);
+            write_table_do_tuple_impl_(out, i, k, v, [](const DType& t) -> const DType& {
+                return t;
             }, args...);
         }
 
@@ -593,7 +1085,7 @@ namespace impl {
         void write_table_do_tuple_(O&& out, uint_t i, uint_t k, const F& v, const Args& ... args) {
             using DType = typename std::decay<decltype(v.obj[0])>::type;
             write_table_do_tuple_impl_(out, i, k, v.obj, [&](const DType& t) {
-                return to_string(v.forward(t));
+                return v.forward(t);
             }, args...);
         }
 
@@ -630,6 +1122,7 @@ namespace ascii {
         file.delim = opts.delim;
         file.header = opts.header;
         file.header_chars = opts.header_chars;
+        file.fmt.round_trip = opts.round_trip;
 
         // Check we can write to the file
         vif_check(file.out.is_open(), "could not open file "+filename+" to write data");
@@ -647,20 +1140,15 @@ namespace ascii {
 
         try {
             if (opts.auto_width) {
-                // Pre-serialize data to compute column width
-                impl::ascii_impl::cache_writer cache;
-                cache.data.resize(r, c);
-                cache.cwidth = file.cwidth;
+                // Format the data once to compute the column widths
+                impl::ascii_impl::width_writer width;
+                width.fmt.round_trip = opts.round_trip;
+                width.cwidth = file.cwidth;
                 for (uint_t i : range(r)) {
-                    impl::ascii_impl::write_table_do_(cache, i, args...);
+                    impl::ascii_impl::write_table_do_(width, i, args...);
                 }
 
-                // Compute width
-                for (uint_t j : range(c)) {
-                    for (auto& s : cache.data.stride(_,j)) {
-                        cache.cwidth.safe[j] = std::max(cache.cwidth.safe[j], s.size());
-                    }
-                }
+                file.cwidth = width.cwidth;
 
                 // Increase width if header is larger
                 if (!opts.header.empty()) {
@@ -669,35 +1157,20 @@ namespace ascii {
                         if (j == 0) {
                             hs += opts.header_chars.size();
                         }
-                        cache.cwidth.safe[j] = std::max(cache.cwidth.safe[j], hs);
+                        file.cwidth.safe[j] = std::max(file.cwidth.safe[j], hs);
                     }
                 }
+            }
 
-                // Go back to writing to file
-                file.cwidth = cache.cwidth;
-
-                // Write header
-                file.write_header();
-
-                // Write pre-serialized data
-                for (uint_t i : range(r)) {
-                    for (uint_t j : range(c)) {
-                        file.write(cache.data.safe(i,j));
-                    }
-
-                    file.end_line();
-                }
-            } else {
-                // Write directly to file
-
-                // Write header
-                file.write_header();
+            // Write header
+            file.write_header();
 
-                // Write data
-                for (uint_t i : range(r)) {
-                    impl::ascii_impl::write_table_do_(file, i, args...);
-                }
+            // Write data
+            for (uint_t i : range(r)) {
+                impl::ascii_impl::write_table_do_(file, i, args...);
             }
+
+            file.flush();
         } catch (ascii::exception& e) {
             vif_check(false, std::string(e.what())+" (writing "+filename+")");
         }
@@ -6,7 +6,11 @@
 #include <fnmatch.h>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <ctime>
@@ -70,6 +74,101 @@ namespace file {
         return dst;
     }
 
+    // Read-only view of the content of a file. The file is memory mapped when possible, and
+    // read into memory otherwise (e.g., pipes). Copies share the same data.
+    class mapped_file {
+        std::shared_ptr<const char> data_;
+        uint_t size_ = 0;
+
+        void copy_(const std::string& tmp) {
+            if (tmp.empty()) return;
+
+            char* d = new char[tmp.size()];
+            std::copy(tmp.begin(), tmp.end(), d);
+            data_ = std::shared_ptr<const char>(d, std::default_delete<char[]>());
+            size_ = tmp.size();
+        }
+
+    public :
+        mapped_file() = default;
+
+        // 'sequential' tells the system whether the file will be read in order (read-ahead)
+        // or at random positions
+        explicit mapped_file(const std::string& file_name, bool sequential = true) {
+            open(file_name, sequential);
+        }
+
+        bool open(const std::string& file_name, bool sequential = true) {
+            close();
+
+            int fd = ::open(file_name.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                return false;
+            }
+
+            bool ok = true;
+            if (S_ISREG(st.st_mode)) {
+                const uint_t nbyte = st.st_size;
+                if (nbyte != 0) {
+                    void* m = ::mmap(nullptr, nbyte, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (m != MAP_FAILED) {
+                        ::madvise(m, nbyte, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                        data_ = std::shared_ptr<const char>(static_cast<const char*>(m),
+                            [nbyte](const char* p) {
+                                ::munmap(const_cast<char*>(p), nbyte);
+                            });
+                        size_ = nbyte;
+                    } else {
+                        // Could not map the file, read it instead
+                        copy_(file::to_string(file_name));
+                    }
+                }
+            } else {
+                // Pipes, terminals, etc: the size is not known in advance, read until the end
+                std::string tmp;
+                char chunk[65536];
+                while (true) {
+                    ssize_t n = ::read(fd, chunk, sizeof(chunk));
+                    if (n > 0) {
+                        tmp.append(chunk, n);
+                    } else if (n == 0 || errno != EINTR) {
+                        ok = (n == 0);
+                        break;
+                    }
+                }
+
+                copy_(tmp);
+            }
+
+            ::close(fd);
+
+            if (!ok) close();
+
+            return ok;
+        }
+
+        void close() {
+            data_.reset();
+            size_ = 0;
+        }
+
+        const char* data() const {
+            return data_.get();
+        }
+
+        uint_t size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+    };
+
     class explorer {
         std::string directory;
         std::string pattern;
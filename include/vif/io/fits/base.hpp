@@ -2,6 +2,8 @@
 #define VIF_IO_FITS_BASE_HPP
 
 #include <string>
+#include <cstring>
+#include <cstdint>
 #include "vif/core/vec.hpp"
 #include "vif/core/print.hpp"
 #include "vif/core/error.hpp"
@@ -316,6 +318,34 @@ namespace impl {
             }
         };
 
+        // Convert values stored in a FITS file (big endian) to the native byte order
+        template<std::size_t N>
+        struct uint_of_size;
+
+        template<> struct uint_of_size<1> { using type = std::uint8_t; };
+        template<> struct uint_of_size<2> { using type = std::uint16_t; };
+        template<> struct uint_of_size<4> { using type = std::uint32_t; };
+        template<> struct uint_of_size<8> { using type = std::uint64_t; };
+
+        inline std::uint8_t swap_bytes_(std::uint8_t v) { return v; }
+        inline std::uint16_t swap_bytes_(std::uint16_t v) { return __builtin_bswap16(v); }
+        inline std::uint32_t swap_bytes_(std::uint32_t v) { return __builtin_bswap32(v); }
+        inline std::uint64_t swap_bytes_(std::uint64_t v) { return __builtin_bswap64(v); }
+
+        template<typename T>
+        void swap_bytes(T* p, uint_t n) {
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            using utype = typename uint_of_size<sizeof(T)>::type;
+            // Simple loop over contiguous values, vectorized by the compiler
+            for (uint_t i = 0; i < n; ++i) {
+                utype u;
+                std::memcpy(&u, p + i, sizeof(T));
+                u = swap_bytes_(u);
+                std::memcpy(p + i, &u, sizeof(T));
+            }
+        #endif
+        }
+
         inline int bitpix_to_type(int bitpix) {
             switch(bitpix) {
                 case BYTE_IMG     : return TBYTE;
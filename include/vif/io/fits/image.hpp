@@ -196,6 +196,406 @@ namespace fits {
         }
     };
 
+    // Read-only view of an uncompressed FITS image, memory mapped from the disk. Pixels are only
+    // read from the file when they are accessed, and are converted from big endian on the fly.
+    // This is much faster than input_image to extract small regions out of very large images.
+    // Indices follow the vec convention: v(y,x) for a 2D image. All the read functions are
+    // const and can be called from multiple threads at once.
+    template<std::size_t Dim, typename Type>
+    class mapped_image {
+        static_assert(std::is_arithmetic<Type>::value, "mapped images can only be read as numbers");
+
+        file::mapped_file file_;
+        std::string filename_;
+        const unsigned char* data_ = nullptr;
+        uint_t size_ = 0;
+        uint_t bytes_ = 0;
+        std::array<uint_t,Dim> pitch_;
+
+        // Conversion from the stored type, with scaling and blank values applied as in cfitsio
+        using convert_t = void (*)(const mapped_image&, const unsigned char*, Type*, uint_t);
+        convert_t convert_ = nullptr;
+        bool scaled_ = false;
+        double bscale_ = 1.0;
+        double bzero_ = 0.0;
+        bool has_blank_ = false;
+        int_t blank_ = 0;
+
+        template<typename S>
+        void store_(const S* s, Type* d, uint_t n, std::true_type) const {
+            if (has_blank_) {
+                for (uint_t i = 0; i < n; ++i) {
+                    d[i] = int_t(s[i]) == blank_ ?
+                        std::numeric_limits<Type>::quiet_NaN() : Type(s[i]*bscale_ + bzero_);
+                }
+            } else if (scaled_) {
+                for (uint_t i = 0; i < n; ++i) {
+                    d[i] = Type(s[i]*bscale_ + bzero_);
+                }
+            } else {
+                for (uint_t i = 0; i < n; ++i) {
+                    d[i] = Type(s[i]);
+                }
+            }
+        }
+
+        template<typename S>
+        void store_(const S* s, Type* d, uint_t n, std::false_type) const {
+            // Only integer offsets are allowed here (checked in open())
+            const int_t zero = bzero_;
+            for (uint_t i = 0; i < n; ++i) {
+                d[i] = Type(s[i] + zero);
+            }
+        }
+
+        template<typename S>
+        static void convert_as_(const mapped_image& m, const unsigned char* src, Type* dst, uint_t n) {
+            // Go through a small buffer, since the data in the file may not be aligned
+            const uint_t nbuf = 512;
+            S buf[nbuf];
+            while (n != 0) {
+                uint_t nb = std::min(n, nbuf);
+                std::memcpy(buf, src, nb*sizeof(S));
+                impl::fits_impl::swap_bytes(buf, nb);
+                m.store_(buf, dst, nb, std::is_floating_point<Type>());
+                src += nb*sizeof(S);
+                dst += nb;
+                n -= nb;
+            }
+        }
+
+        void read_bounds_(uint_t, std::array<uint_t,Dim>&, std::array<uint_t,Dim>&) const {}
+
+        template<typename ... Args>
+        void read_bounds_(uint_t idim, std::array<uint_t,Dim>& first, std::array<uint_t,Dim>& last,
+            impl::range_impl::full_range_t, const Args& ... args) const {
+
+            vif_check_fits(dims[idim] != 0, "image subset goes outside of the image boundaries "
+                "(axis "+to_string(idim)+" is empty)");
+
+            first[idim] = 0;
+            last[idim] = dims[idim]-1;
+
+            read_bounds_(idim+1, first, last, args...);
+        }
+
+        template<typename ... Args>
+        void read_bounds_(uint_t idim, std::array<uint_t,Dim>& first, std::array<uint_t,Dim>& last,
+            impl::range_impl::left_range_t r, const Args& ... args) const {
+
+            vif_check_fits(r.last < dims[idim], "image subset goes outside of the image boundaries "
+                "(axis "+to_string(idim)+": "+to_string(r.last)+" vs. "+to_string(dims[idim])+")");
+
+            first[idim] = 0;
+            last[idim] = r.last;
+
+            read_bounds_(idim+1, first, last, args...);
+        }
+
+        template<typename ... Args>
+        void read_bounds_(uint_t idim, std::array<uint_t,Dim>& first, std::array<uint_t,Dim>& last,
+            impl::range_impl::right_range_t r, const Args& ... args) const {
+
+            vif_check_fits(r.first < dims[idim], "image subset goes outside of the image boundaries "
+                "(axis "+to_string(idim)+": "+to_string(r.first)+" vs. "+to_string(dims[idim])+")");
+
+            first[idim] = r.first;
+            last[idim] = dims[idim]-1;
+
+            read_bounds_(idim+1, first, last, args...);
+        }
+
+        template<typename ... Args>
+        void read_bounds_(uint_t idim, std::array<uint_t,Dim>& first, std::array<uint_t,Dim>& last,
+            impl::range_impl::left_right_range_t r, const Args& ... args) const {
+
+            vif_check_fits(r.last < dims[idim] && r.first <= r.last, "image subset goes outside of "
+                "the image boundaries (axis "+to_string(idim)+": "+to_string(r.first)+"-"+
+                to_string(r.last)+" vs. "+to_string(dims[idim])+")");
+
+            first[idim] = r.first;
+            last[idim] = r.last;
+
+            read_bounds_(idim+1, first, last, args...);
+        }
+
+        template<typename ... Args>
+        void read_bounds_(uint_t idim, std::array<uint_t,Dim>& first, std::array<uint_t,Dim>& last,
+            uint_t i, const Args& ... args) const {
+
+            vif_check_fits(i < dims[idim], "image subset goes outside of the image boundaries "
+                "(axis "+to_string(idim)+": "+to_string(i)+" vs. "+to_string(dims[idim])+")");
+
+            first[idim] = i;
+            last[idim] = i;
+
+            read_bounds_(idim+1, first, last, args...);
+        }
+
+        uint_t flat_index_(uint_t) const {
+            return 0;
+        }
+
+        template<typename ... Args>
+        uint_t flat_index_(uint_t idim, uint_t i, Args ... args) const {
+            vif_check(i < dims[idim], "index out of bounds (axis ", idim, ": ", i, " vs. ",
+                dims[idim], ")");
+            return i*pitch_[idim] + flat_index_(idim+1, args...);
+        }
+
+        void check_is_open_() const {
+            vif_check(data_ != nullptr, "no mapped FITS image");
+        }
+
+    public :
+        std::array<uint_t,Dim> dims;
+
+        mapped_image() {
+            dims.fill(0);
+            pitch_.fill(0);
+        }
+
+        explicit mapped_image(const std::string& filename) : mapped_image() {
+            open(filename);
+        }
+
+        mapped_image(const std::string& filename, uint_t hdu) : mapped_image() {
+            open(filename, hdu);
+        }
+
+        void open(const std::string& filename) {
+            fits::input_image img(filename);
+            open(img);
+        }
+
+        void open(const std::string& filename, uint_t hdu) {
+            fits::input_image img(filename);
+            img.reach_hdu(hdu);
+            open(img);
+        }
+
+        // Map the current HDU of an opened FITS image
+        void open(const fits::input_image& img) {
+            close();
+
+            filename_ = img.filename();
+            fitsfile* fptr = const_cast<fitsfile*>(img.cfitsio_ptr());
+            int status = 0;
+
+            int compressed = fits_is_compressed_image(fptr, &status);
+            fits::vif_check_cfitsio(status, "could not read image parameters of HDU");
+            vif_check_fits(!compressed, "cannot memory map the compressed image in '"+
+                filename_+"', use input_image instead");
+
+            int naxis = 0;
+            fits_get_img_dim(fptr, &naxis, &status);
+            fits::vif_check_cfitsio(status, "could not read dimensions of HDU");
+            vif_check_fits(naxis == int(Dim), "FITS file has wrong number of dimensions "
+                "(expected "+to_string(Dim)+", got "+to_string(naxis)+")");
+
+            int bitpix = 0;
+            std::vector<long> naxes(naxis);
+            fits_get_img_param(fptr, naxis, &bitpix, &naxis, naxes.data(), &status);
+            fits::vif_check_cfitsio(status, "could not read image parameters of HDU");
+
+            int type = impl::fits_impl::bitpix_to_type(bitpix);
+            vif_check_fits(impl::fits_impl::traits<Type>::is_convertible(type), "wrong image type "
+                "(expected "+pretty_type_t(Type)+", got "+impl::fits_impl::type_to_string_(type)+")");
+
+            LONGLONG headstart = 0, datastart = 0, dataend = 0;
+            fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status);
+            fits::vif_check_cfitsio(status, "could not locate image data in HDU");
+
+            img.read_keyword("BSCALE", bscale_);
+            img.read_keyword("BZERO", bzero_);
+            scaled_ = bscale_ != 1.0 || bzero_ != 0.0;
+            if (std::is_floating_point<Type>::value) {
+                if (bitpix > 0) {
+                    has_blank_ = img.read_keyword("BLANK", blank_);
+                }
+            } else {
+                vif_check_fits(bscale_ == 1.0 && bzero_ == std::floor(bzero_), "cannot memory map "
+                    "the scaled image in '"+filename_+"' as integers, read it as floating point "
+                    "values or use input_image instead");
+            }
+
+            size_ = 1;
+            for (uint_t i : range(Dim)) {
+                dims[i] = naxes[Dim-1-i];
+                size_ *= dims[i];
+            }
+
+            pitch_[Dim-1] = 1;
+            for (uint_t i = Dim-1; i > 0; --i) {
+                pitch_[i-1] = pitch_[i]*dims[i];
+            }
+
+            bytes_ = std::abs(bitpix)/8;
+
+            switch (bitpix) {
+                case BYTE_IMG   : convert_ = &convert_as_<std::uint8_t>; break;
+                case SHORT_IMG  : convert_ = &convert_as_<std::int16_t>; break;
+                case LONG_IMG   : convert_ = &convert_as_<std::int32_t>; break;
+                case LONGLONG_IMG : convert_ = &convert_as_<std::int64_t>; break;
+                case FLOAT_IMG  : convert_ = &convert_as_<float>; break;
+                case DOUBLE_IMG : convert_ = &convert_as_<double>; break;
+                default : vif_check_fits(false, "unsupported BITPIX="+to_string(bitpix));
+            }
+
+            // The file on disk must contain the raw FITS data (not, e.g., gzipped)
+            bool mapped = file_.open(filename_, false);
+            const char* fdata = file_.data();
+            vif_check_fits(mapped && file_.size() >= uint_t(datastart) + size_*bytes_ &&
+                uint_t(headstart) + 8 <= file_.size() &&
+                (std::strncmp(fdata + headstart, "SIMPLE  ", 8) == 0 ||
+                 std::strncmp(fdata + headstart, "XTENSION", 8) == 0),
+                "cannot memory map '"+filename_+"', it is not an uncompressed FITS file "
+                "on disk, use input_image instead");
+
+            data_ = reinterpret_cast<const unsigned char*>(fdata) + datastart;
+        }
+
+        void close() {
+            file_.close();
+            filename_.clear();
+            data_ = nullptr;
+            size_ = 0;
+            dims.fill(0);
+            pitch_.fill(0);
+            convert_ = nullptr;
+            scaled_ = false;
+            bscale_ = 1.0;
+            bzero_ = 0.0;
+            has_blank_ = false;
+        }
+
+        bool is_open() const {
+            return data_ != nullptr;
+        }
+
+        const std::string& filename() const {
+            return filename_;
+        }
+
+        uint_t size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        // Read one pixel, with a flat index
+        Type operator[] (uint_t i) const {
+            check_is_open_();
+            vif_check(i < size_, "index out of bounds (", i, " vs. ", size_, ")");
+
+            Type v;
+            convert_(*this, data_ + i*bytes_, &v, 1);
+            return v;
+        }
+
+        // Read one pixel, with one index per dimension
+        template<typename ... Args>
+        Type operator() (Args ... idx) const {
+            static_assert(sizeof...(Args) == Dim, "wrong number of indices for this image");
+            check_is_open_();
+
+            Type v;
+            convert_(*this, data_ + flat_index_(0, idx...)*bytes_, &v, 1);
+            return v;
+        }
+
+        // Read the whole image
+        void read(vec<Dim,Type>& v) const {
+            check_is_open_();
+
+            v.dims = dims;
+            v.resize();
+            convert_(*this, data_, v.raw_data(), size_);
+        }
+
+        // Read a subset of the image, with the same syntax as input_image::read_subset()
+        template<typename ... Args>
+        void read_subset(vec<Dim,Type>& v, const Args& ... args) const {
+            static_assert(Dim == sizeof...(Args), "incompatible subset and vector dimensions");
+            check_is_open_();
+
+            std::array<uint_t,Dim> first, last;
+            read_bounds_(0, first, last, args...);
+
+            std::array<int_t,Dim> ifirst, ilast;
+            for (uint_t i : range(Dim)) {
+                ifirst[i] = first[i];
+                ilast[i] = last[i];
+            }
+
+            read_region(v, ifirst, ilast);
+        }
+
+        // Read a region of the image, from 'first' to 'last' (inclusive). The region may extend
+        // beyond the image boundaries, in which case the pixels outside of the image are set to
+        // 'fill'.
+        void read_region(vec<Dim,Type>& v, const std::array<int_t,Dim>& first,
+            const std::array<int_t,Dim>& last,
+            Type fill = impl::fits_impl::traits<Type>::def()) const {
+
+            check_is_open_();
+
+            // Clip the region to the image
+            bool inside = true;
+            std::array<int_t,Dim> c0, c1;
+            for (uint_t i : range(Dim)) {
+                vif_check(last[i] >= first[i], "invalid region (axis ", i, ": ", first[i],
+                    " to ", last[i], ")");
+
+                v.dims[i] = last[i] - first[i] + 1;
+                c0[i] = std::max(first[i], int_t(0));
+                c1[i] = std::min(last[i], int_t(dims[i]) - 1);
+                if (c0[i] > c1[i]) inside = false;
+            }
+
+            v.resize();
+
+            bool full = true;
+            for (uint_t i : range(Dim)) {
+                if (c0[i] != first[i] || c1[i] != last[i]) full = false;
+            }
+
+            if (!full) {
+                std::fill(v.begin(), v.end(), fill);
+            }
+
+            if (!inside) return;
+
+            // Copy contiguous runs along the last dimension
+            const uint_t nrun = c1[Dim-1] - c0[Dim-1] + 1;
+            std::array<int_t,Dim> idx = c0;
+            while (true) {
+                uint_t src = 0, dst = 0;
+                for (uint_t i : range(Dim)) {
+                    src += idx[i]*pitch_[i];
+                    dst += (idx[i] - first[i])*v.pitch(i);
+                }
+
+                convert_(*this, data_ + src*bytes_, v.raw_data() + dst, nrun);
+
+                // Next run
+                int_t i = int_t(Dim)-2;
+                for (; i >= 0; --i) {
+                    if (idx[i] < c1[i]) {
+                        ++idx[i];
+                        break;
+                    }
+
+                    idx[i] = c0[i];
+                }
+
+                if (i < 0) break;
+            }
+        }
+    };
+
     // Output FITS table (write only, overwrites existing files)
     class output_image : public impl::fits_impl::output_file_base {
     public :
@@ -118,6 +118,108 @@ namespace impl {
 
         template<typename T>
         struct is_readable_column_type<impl::named_t<T>> : is_readable_column_type<meta::decay_t<T>> {};
+
+        // A column of a row-oriented binary table, read together with other columns
+        struct batch_column {
+            uint_t offset = 0; // position of the column in a row, in bytes
+            uint_t repeat = 0; // number of elements per row
+            void* data = nullptr;
+
+            using scatter_t = void (*)(const batch_column&, const unsigned char*, uint_t,
+                uint_t, uint_t, std::vector<unsigned char>&);
+            scatter_t scatter = nullptr;
+        };
+
+        // Copy the values of a column from 'nrow' rows in 'rows' into rows [r0,r0+nrow) of
+        // the output vector
+        template<typename S, typename D>
+        void batch_scatter_(const batch_column& c, const unsigned char* rows, uint_t rowlen,
+            uint_t r0, uint_t nrow, std::vector<unsigned char>& tmp) {
+
+            const uint_t n = c.repeat;
+            D* out = static_cast<D*>(c.data) + r0*n;
+
+            // Gather the values in a contiguous array, directly in the output if possible
+            S* src;
+            if (std::is_same<S,D>::value) {
+                src = reinterpret_cast<S*>(out);
+            } else {
+                tmp.resize(nrow*n*sizeof(S));
+                src = reinterpret_cast<S*>(tmp.data());
+            }
+
+            rows += c.offset;
+            for (uint_t r = 0; r < nrow; ++r, rows += rowlen) {
+                std::memcpy(src + r*n, rows, n*sizeof(S));
+            }
+
+            swap_bytes(src, nrow*n);
+
+            if (!std::is_same<S,D>::value) {
+                for (uint_t i = 0; i < nrow*n; ++i) {
+                    out[i] = static_cast<D>(src[i]);
+                }
+            }
+        }
+
+        inline void batch_scatter_logical_(const batch_column& c, const unsigned char* rows,
+            uint_t rowlen, uint_t r0, uint_t nrow, std::vector<unsigned char>&) {
+
+            const uint_t n = c.repeat;
+            char* out = static_cast<char*>(c.data) + r0*n;
+
+            rows += c.offset;
+            for (uint_t r = 0; r < nrow; ++r, rows += rowlen) {
+                for (uint_t k = 0; k < n; ++k) {
+                    out[r*n + k] = (rows[k] == 'T');
+                }
+            }
+        }
+
+        template<typename T>
+        batch_column::scatter_t batch_scatter_(int, uint_t, meta::type_list<T>, long) {
+            return nullptr;
+        }
+
+        inline batch_column::scatter_t batch_scatter_(int type, uint_t width,
+            meta::type_list<bool>, int) {
+
+            if (type == TLOGICAL && width == 1) return &batch_scatter_logical_;
+            if (type == TBYTE && width == 1)    return &batch_scatter_<std::uint8_t,char>;
+            return nullptr;
+        }
+
+        template<typename T, typename enable = typename std::enable_if<meta::is_any_type_of<T,
+            meta::type_list<short, int_t, uint_t, float, double>>::value>::type>
+        batch_column::scatter_t batch_scatter_(int type, uint_t width, meta::type_list<T>, int) {
+
+            const bool is_float = std::is_floating_point<T>::value;
+            const bool is_large = sizeof(T) >= 8;
+
+            if (type == TBYTE && width == 1) {
+                return &batch_scatter_<std::uint8_t,T>;
+            } else if (type == TSHORT && width == 2) {
+                return &batch_scatter_<std::int16_t,T>;
+            } else if (type == TLONG && width == 4 && (is_large || is_float)) {
+                return &batch_scatter_<std::int32_t,T>;
+            } else if (type == TLONGLONG && width == 8 && is_large) {
+                return &batch_scatter_<std::int64_t,T>;
+            } else if (type == TFLOAT && width == 4 && is_float) {
+                return &batch_scatter_<float,T>;
+            } else if (type == TDOUBLE && width == 8 && std::is_same<T,double>::value) {
+                return &batch_scatter_<double,T>;
+            }
+
+            return nullptr;
+        }
+
+        // Scatter function from a FITS column type to a vector of type T, for the conversions
+        // that cfitsio does without scaling, clipping or rounding. Returns null for the other
+        // conversions, which are left to cfitsio.
+        template<typename T>
+        batch_column::scatter_t batch_scatter(int type, uint_t width) {
+            return batch_scatter_(type, width, meta::type_list<T>{}, 0);
+        }
     }
 }
 
@@ -571,20 +673,95 @@ namespace fits {
             return read_column_check_dim_impl_(opts, naxis, vdim);
         }
 
+        // Columns of a row-oriented table to read together, in a single pass over the rows
+        struct column_batch_ {
+            std::vector<impl::fits_impl::batch_column> columns;
+        };
+
+        // Size of the groups of rows read at once, in bytes
+        static constexpr uint_t batch_size = 1024*1024;
+
         struct do_read_struct_ {
             const input_table* tbl;
             const table_read_options& opts;
             std::string base;
+            column_batch_* batch;
 
             template<typename P>
             void operator () (reflex::member_t& m, P&& v) {
-                tbl->read_column(opts, base+to_upper(m.name), std::forward<P>(v));
+                tbl->read_column_(opts, base+to_upper(m.name), std::forward<P>(v),
+                    reflex::enabled<meta::decay_t<P>>{}, batch);
             }
         };
 
+        template<typename T>
+        bool batch_column_(column_batch_*, T&, int, int, long, long, uint_t) const {
+            return false;
+        }
+
+        template<std::size_t Dim, typename Type>
+        bool batch_column_(column_batch_* batch, vec<Dim,Type>& v, int cid, int type,
+            long repeat, long width, uint_t nrow) const {
+
+            auto scatter = impl::fits_impl::batch_scatter<Type>(type, width);
+            if (!scatter || repeat <= 0 || v.size() != nrow*uint_t(repeat)) {
+                return false;
+            }
+
+            // Scaled columns are left to cfitsio
+            double tscal = 1.0, tzero = 0.0;
+            read_keyword("TSCAL"+to_string(cid), tscal);
+            read_keyword("TZERO"+to_string(cid), tzero);
+            if (tscal != 1.0 || tzero != 0.0) {
+                return false;
+            }
+
+            // So are integer columns with null values, which cfitsio replaces by the default
+            // value (e.g., NaN for floating point vectors)
+            long long tnull = 0;
+            if (read_keyword("TNULL"+to_string(cid), tnull)) {
+                return false;
+            }
+
+            impl::fits_impl::batch_column c;
+            c.offset = fptr_->Fptr->tableptr[cid-1].tbcol;
+            c.repeat = repeat;
+            c.data = v.raw_data();
+            c.scatter = scatter;
+            batch->columns.push_back(c);
+
+            return true;
+        }
+
+        // Read all the columns of the batch, one group of rows at a time
+        void read_batch_(const column_batch_& batch) const {
+            if (batch.columns.empty()) return;
+
+            uint_t rowlen = 0, nrow = 0;
+            read_keyword("NAXIS1", rowlen);
+            read_keyword("NAXIS2", nrow);
+            if (rowlen == 0 || nrow == 0) return;
+
+            const uint_t group = std::min(nrow, std::max(uint_t(1), batch_size/rowlen));
+            std::vector<unsigned char> buffer(group*rowlen);
+            std::vector<unsigned char> tmp;
+
+            for (uint_t r0 = 0; r0 < nrow; r0 += group) {
+                uint_t nr = std::min(group, nrow - r0);
+                fits_read_tblbytes(fptr_, r0+1, 1, nr*rowlen, buffer.data(), &status_);
+                fits::vif_check_cfitsio(status_, "could not read rows "+to_string(r0)+" to "+
+                    to_string(r0+nr)+" of table");
+
+                for (auto& c : batch.columns) {
+                    c.scatter(c, buffer.data(), rowlen, r0, nr, tmp);
+                }
+            }
+        }
+
         template<typename T>
         read_sentry read_column_(table_read_options opts,
-            const std::string& tcolname, T& value, std::false_type) const {
+            const std::string& tcolname, T& value, std::false_type,
+            column_batch_* batch = nullptr) const {
 
             static_assert(impl::fits_impl::is_readable_column_type<typename std::decay<T>::type>::value,
                 "this value cannot be read from a FITS file");
@@ -625,7 +802,8 @@ namespace fits {
 
             // Support ASCII tables with string columns
             std::string extension;
-            if (read_keyword("XTENSION", extension) && extension == "TABLE") {
+            const bool ascii_table = read_keyword("XTENSION", extension) && extension == "TABLE";
+            if (ascii_table) {
                 std::string tform;
                 if (read_keyword("TFORM"+to_string(cid), tform) && tform[0] == 'A') {
                     from_string(erase_begin(tform, "A"), axes[0]);
@@ -652,9 +830,13 @@ namespace fits {
             // Resize vector
             read_column_resize_(value, naxis, axes);
 
-            // Read
+            // Read, or defer reading to read_batch_() for binary tables with many rows
             if (nrow != 0) {
-                read_column_impl_(opts, value, tcolname, cid, naxis, axes, repeat, nrow);
+                bool batched = batch && !ascii_table && format_ == table_format::row_oriented &&
+                    batch_column_(batch, value, cid, type, repeat, width, nrow);
+                if (!batched) {
+                    read_column_impl_(opts, value, tcolname, cid, naxis, axes, repeat, nrow);
+                }
             }
 
             return read_sentry{};
@@ -662,14 +844,15 @@ namespace fits {
 
         template<typename T>
         read_sentry read_column_(const table_read_options& opts,
-            const std::string& colname, reflex::struct_t<T> value, std::true_type) const {
+            const std::string& colname, reflex::struct_t<T> value, std::true_type,
+            column_batch_* batch = nullptr) const {
 
             #ifdef NO_REFLECTION
             static_assert(!std::is_same<T,T>::value,
                 "this function requires reflection capabilities (NO_REFLECTION=0)");
             #endif
 
-            do_read_struct_ run{this, opts, to_upper(colname)+"."};
+            do_read_struct_ run{this, opts, to_upper(colname)+".", batch};
             reflex::foreach_member(value, run);
 
             return read_sentry{};
@@ -677,14 +860,15 @@ namespace fits {
 
         template<typename T>
         read_sentry read_column_(const table_read_options& opts,
-            const std::string& colname, T& value, std::true_type) const {
+            const std::string& colname, T& value, std::true_type,
+            column_batch_* batch = nullptr) const {
 
             #ifdef NO_REFLECTION
             static_assert(!std::is_same<T,T>::value,
                 "this function requires reflection capabilities (NO_REFLECTION=0)");
             #endif
 
-            do_read_struct_ run{this, opts, to_upper(colname)+"."};
+            do_read_struct_ run{this, opts, to_upper(colname)+".", batch};
             reflex::foreach_member(reflex::wrap(value), run);
 
             return read_sentry{};
@@ -707,16 +891,16 @@ namespace fits {
 
     private :
 
-        void read_columns_impl_(const table_read_options&) const {
+        void read_columns_impl_(const table_read_options&, column_batch_*) const {
             // Nothing more to do
         }
 
         template<typename T, typename ... Args>
-        void read_columns_impl_(const table_read_options& opts,
+        void read_columns_impl_(const table_read_options& opts, column_batch_* batch,
             const std::string& tcolname, T& value, Args&& ... args) const {
 
-            read_column(opts, tcolname, value);
-            read_columns_impl_(opts, std::forward<Args>(args)...);
+            read_column_(opts, tcolname, value, reflex::enabled<meta::decay_t<T>>{}, batch);
+            read_columns_impl_(opts, batch, std::forward<Args>(args)...);
         }
 
     public :
@@ -739,7 +923,9 @@ namespace fits {
 
             // Read
             check_is_open_();
-            read_columns_impl_(opts, std::forward<Args>(args)...);
+            column_batch_ batch;
+            read_columns_impl_(opts, &batch, std::forward<Args>(args)...);
+            read_batch_(batch);
         }
 
         template<typename ... Args, typename enable = typename std::enable_if<
@@ -761,35 +947,35 @@ namespace fits {
 
             // Read
             check_is_open_();
-            read_columns_impl_(table_read_options{}, std::forward<Args>(args)...);
+            column_batch_ batch;
+            read_columns_impl_(table_read_options{}, &batch, std::forward<Args>(args)...);
+            read_batch_(batch);
         }
 
     private :
 
-        void read_columns_impl_(const table_read_options&, impl::ascii_impl::macroed_t, const std::string&) const {
+        void read_columns_impl_(const table_read_options&, column_batch_*, impl::ascii_impl::macroed_t,
+            const std::string&) const {
             // Nothing more to do
         }
 
         template<typename T, typename ... Args>
-        void read_columns_impl_(const table_read_options& opts, impl::ascii_impl::macroed_t,
-            std::string names, T& value, Args&& ... args) const {
+        void read_columns_impl_(const table_read_options& opts, column_batch_* batch,
+            impl::ascii_impl::macroed_t, std::string names, T& value, Args&& ... args) const {
 
             std::string tcolname = impl::ascii_impl::pop_macroed_name(names);
-            read_column(opts, impl::ascii_impl::bake_macroed_name(tcolname), value);
-            read_columns_impl_(opts, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
+            read_column_(opts, impl::ascii_impl::bake_macroed_name(tcolname), value,
+                reflex::enabled<meta::decay_t<T>>{}, batch);
+            read_columns_impl_(opts, batch, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
         }
         template<typename T, typename ... Args>
-        void read_columns_impl_(const table_read_options& opts, impl::ascii_impl::macroed_t,
-            std::string names, const impl::named_t<T>& value, Args&& ... args) const {
+        void read_columns_impl_(const table_read_options& opts, column_batch_* batch,
+            impl::ascii_impl::macroed_t, std::string names, const impl::named_t<T>& value,
+            Args&& ... args) const {
 
             impl::ascii_impl::pop_macroed_name(names);
-            read_column(opts, value.name, value.obj);
-            read_columns_impl_(opts, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
-        }
-
-        template<typename ... Args>
-        void read_columns_impl_(impl::ascii_impl::macroed_t, const std::string& names, Args&& ... args) const {
-            read_columns_impl_(table_read_options{}, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
+            read_column_(opts, value.name, value.obj, reflex::enabled<meta::decay_t<T>>{}, batch);
+            read_columns_impl_(opts, batch, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
         }
 
     public :
@@ -808,7 +994,9 @@ namespace fits {
 
             // Read
             check_is_open_();
-            read_columns_impl_(opts, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
+            column_batch_ batch;
+            read_columns_impl_(opts, &batch, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
+            read_batch_(batch);
         }
 
         template<typename ... Args>
@@ -823,7 +1011,10 @@ namespace fits {
 
             // Read
             check_is_open_();
-            read_columns_impl_(table_read_options{}, impl::ascii_impl::macroed_t{}, names, std::forward<Args>(args)...);
+            column_batch_ batch;
+            read_columns_impl_(table_read_options{}, &batch, impl::ascii_impl::macroed_t{}, names,
+                std::forward<Args>(args)...);
+            read_batch_(batch);
         }
 
     public :
@@ -831,7 +1022,9 @@ namespace fits {
         template<typename T, typename enable = typename std::enable_if<reflex::enabled<T>::value>::type>
         void read_columns(const table_read_options& opts, T& t) {
             check_is_open_();
-            reflex::foreach_member(reflex::wrap(t), do_read_struct_{this, opts, ""});
+            column_batch_ batch;
+            reflex::foreach_member(reflex::wrap(t), do_read_struct_{this, opts, "", &batch});
+            read_batch_(batch);
         }
 
         template<typename T, typename enable = typename std::enable_if<reflex::enabled<T>::value>::type>
@@ -12,6 +12,10 @@
 #include "vif/core/range.hpp"
 #include "vif/core/error.hpp"
 
+#define VIF_INCLUDING_MATH_SIMD_BITS
+#include "vif/math/bits/simd.hpp"
+#undef VIF_INCLUDING_MATH_SIMD_BITS
+
 namespace vif {
     static constexpr const double dnan = std::numeric_limits<double>::quiet_NaN();
     static constexpr const float  fnan = std::numeric_limits<float>::quiet_NaN();
@@ -188,6 +192,41 @@ namespace vif {
     VIF_VECTORIZE_REN(bessel_y0, y0);
     VIF_VECTORIZE_REN(bessel_y1, y1);
 
+    // Explicitly vectorized versions for contiguous float and double vectors (see
+    // vif/math/bits/simd.hpp for the accuracy of each function). These are more specialized
+    // than the generic versions above, and are picked by overload resolution.
+    #define VIF_SIMD_VECTORIZE(name, type) \
+        template<std::size_t Dim> \
+        vec<Dim,type> name(const vec<Dim,type>& v) { \
+            vec<Dim,type> r(v.dims); \
+            const type* x = v.data.data(); type* y = r.data.data(); \
+            impl::parallel_range(v.size(), [&](uint_t i0, uint_t i1) { \
+                impl::simd_impl::name(x+i0, y+i0, i1-i0); \
+            }); \
+            return r; \
+        } \
+        template<std::size_t Dim> \
+        vec<Dim,type> name(vec<Dim,type>&& v) { \
+            type* y = v.data.data(); \
+            impl::parallel_range(v.size(), [&](uint_t i0, uint_t i1) { \
+                impl::simd_impl::name(y+i0, y+i0, i1-i0); \
+            }); \
+            return std::move(v); \
+        }
+
+    VIF_SIMD_VECTORIZE(sqrt,  float)
+    VIF_SIMD_VECTORIZE(sqrt,  double)
+    VIF_SIMD_VECTORIZE(exp,   float)
+    VIF_SIMD_VECTORIZE(exp,   double)
+    VIF_SIMD_VECTORIZE(log,   float)
+    VIF_SIMD_VECTORIZE(log,   double)
+    VIF_SIMD_VECTORIZE(log2,  float)
+    VIF_SIMD_VECTORIZE(log2,  double)
+    VIF_SIMD_VECTORIZE(log10, float)
+    VIF_SIMD_VECTORIZE(log10, double)
+
+    #undef VIF_SIMD_VECTORIZE
+
     #ifndef NO_GSL
     VIF_VECTORIZE_REN(bessel_i0, gsl_sf_bessel_I0);
     VIF_VECTORIZE_REN(bessel_i1, gsl_sf_bessel_I1);
@@ -0,0 +1,196 @@
+#ifndef VIF_INCLUDING_MATH_SIMD_BITS
+#error this file is not meant to be included separately, include "vif/math/base.hpp" instead
+#endif
+
+// Note: this file has no include guard on purpose. It is included once for each instruction set
+// in simd.hpp, inside the corresponding namespace, so that the kernels below are compiled with
+// the right target options. The struct 'ops' (register type, width, and basic operations) must
+// be declared in the including namespace.
+
+// exp(x): range reduction x = n*ln(2) + r, |r| < ln(2)/2, then Pade approximant for exp(r)
+// (from Cephes). The scaling by 2^n is done in two steps to get subnormal results right.
+template<typename O>
+typename O::reg exp_kernel(typename O::reg x) {
+    using reg = typename O::reg;
+    const reg magic = O::set1(6755399441055744.0); // 1.5*2^52, for rounding to integer
+
+    // Clamp to avoid overflows in the exponent (NaN is propagated)
+    reg xc = O::max(O::set1(-746.0), O::min(O::set1(710.0), x));
+
+    reg n = O::sub(O::add(O::mul(xc, O::set1(1.4426950408889634074)), magic), magic);
+    reg r = O::fma(n, O::set1(-6.93145751953125e-1), xc);
+    r = O::fma(n, O::set1(-1.42860682030941723212e-6), r);
+
+    reg rr = O::mul(r, r);
+    reg px = O::mul(r, O::fma(O::fma(O::set1(1.26177193074810590878e-4), rr,
+        O::set1(3.02994407707441961300e-2)), rr, O::set1(9.99999999999999999910e-1)));
+    reg qx = O::fma(O::fma(O::fma(O::set1(3.00198505138664455042e-6), rr,
+        O::set1(2.52448340349684104192e-3)), rr, O::set1(2.27265548208155028766e-1)), rr,
+        O::set1(2.00000000000000000009e0));
+    reg y = O::fma(O::div(px, O::sub(qx, px)), O::set1(2.0), O::set1(1.0));
+
+    // 2^n = 2^n1 * 2^n2, with n1 = floor(n/2)
+    reg n1 = O::sub(O::add(O::fma(n, O::set1(0.5), O::set1(-0.25)), magic), magic);
+    reg n2 = O::sub(n, n1);
+    const reg bias = O::set1(6755399441055744.0 + 1023.0);
+    y = O::mul(O::mul(y, O::slli52(O::add(n1, bias))), O::slli52(O::add(n2, bias)));
+
+    y = O::select(O::gt(x, O::set1(709.782712893383973096)),
+        O::set1(std::numeric_limits<double>::infinity()), y);
+    y = O::select(O::lt(x, O::set1(-745.133219101941108420)), O::set1(0.0), y);
+
+    return y;
+}
+
+// log(x) split as k*ln(2) + log(m), with sqrt(2)/2 <= m < sqrt(2), and log(m) computed from
+// the series in s = (m-1)/(m+1) (from fdlibm). Returns log(m) in 'lm' and k in 'k', and the
+// corresponding first order term (m-1) in 'f' and the rest in 'lr', such that
+// log(m) = f - lr.
+template<typename O>
+void log_kernel(typename O::reg x, typename O::reg& k, typename O::reg& f, typename O::reg& lr) {
+    using reg = typename O::reg;
+    using mask = typename O::mask;
+
+    // Bring subnormals into the normal range
+    mask sub = O::lt(x, O::set1(2.2250738585072014e-308));
+    reg xs = O::select(sub, O::mul(x, O::set1(18014398509481984.0)), x);
+    reg kadj = O::select(sub, O::set1(-54.0 - 1023.0), O::set1(-1023.0));
+
+    // Exponent (as double) and mantissa in [1,2)
+    reg e = O::sub(O::bor(O::srli52(xs), O::set1_bits(0x4330000000000000ull)),
+        O::set1(4503599627370496.0));
+    reg m = O::bor(O::band(xs, O::set1_bits(0x000fffffffffffffull)),
+        O::set1_bits(0x3ff0000000000000ull));
+
+    mask big = O::gt(m, O::set1(1.41421356237309504880));
+    m = O::select(big, O::mul(m, O::set1(0.5)), m);
+    k = O::add(O::add(e, kadj), O::select(big, O::set1(1.0), O::set1(0.0)));
+
+    f = O::sub(m, O::set1(1.0));
+    reg s = O::div(f, O::add(f, O::set1(2.0)));
+    reg z = O::mul(s, s);
+    reg r = O::set1(1.479819860511658591e-01);
+    r = O::fma(r, z, O::set1(1.531383769920937332e-01));
+    r = O::fma(r, z, O::set1(1.818357216161805012e-01));
+    r = O::fma(r, z, O::set1(2.222219843214978396e-01));
+    r = O::fma(r, z, O::set1(2.857142874366239149e-01));
+    r = O::fma(r, z, O::set1(3.999999999940941908e-01));
+    r = O::fma(r, z, O::set1(6.666666666666735130e-01));
+    r = O::mul(r, z);
+
+    reg hfsq = O::mul(O::set1(0.5), O::mul(f, f));
+    lr = O::sub(hfsq, O::mul(s, O::add(hfsq, r)));
+}
+
+// Special values of the logarithm: log(0) = -inf, log(x<0) = NaN, log(inf) = inf
+template<typename O>
+typename O::reg log_special(typename O::reg x, typename O::reg y) {
+    using reg = typename O::reg;
+    const reg inf = O::set1(std::numeric_limits<double>::infinity());
+    y = O::select(O::eq(x, O::set1(0.0)), O::sub(O::set1(0.0), inf), y);
+    y = O::select(O::lt(x, O::set1(0.0)), O::set1(std::numeric_limits<double>::quiet_NaN()), y);
+    y = O::select(O::eq(x, inf), inf, y);
+    y = O::select(O::unord(x, x), x, y);
+    return y;
+}
+
+template<typename O>
+typename O::reg log_kernel(typename O::reg x) {
+    using reg = typename O::reg;
+    reg k, f, lr;
+    log_kernel<O>(x, k, f, lr);
+    // k*ln2_hi - ((lr - k*ln2_lo) - f)
+    reg y = O::fma(k, O::set1(6.93147180369123816490e-01),
+        O::sub(f, O::fma(k, O::set1(-1.90821492927058770002e-10), lr)));
+    return log_special<O>(x, y);
+}
+
+template<typename O>
+typename O::reg log2_kernel(typename O::reg x) {
+    using reg = typename O::reg;
+    reg k, f, lr;
+    log_kernel<O>(x, k, f, lr);
+    reg y = O::add(k, O::mul(O::sub(f, lr), O::set1(1.44269504088896340736)));
+    return log_special<O>(x, y);
+}
+
+template<typename O>
+typename O::reg log10_kernel(typename O::reg x) {
+    using reg = typename O::reg;
+    reg k, f, lr;
+    log_kernel<O>(x, k, f, lr);
+    // k*log10(2)_hi + (k*log10(2)_lo + log(m)/ln(10))
+    reg y = O::fma(k, O::set1(3.01029995663611771306e-01),
+        O::fma(k, O::set1(3.69423907715893078616e-13),
+        O::mul(O::sub(f, lr), O::set1(4.34294481903251816668e-01))));
+    return log_special<O>(x, y);
+}
+
+template<typename O>
+typename O::reg sqrt_kernel(typename O::reg x) {
+    return O::sqrt(x);
+}
+
+// Apply a kernel to an array. The last elements that do not fill a whole register are
+// computed through a padded buffer, so they get the exact same treatment.
+#define VIF_SIMD_KERNEL_ARRAY(name) \
+    template<typename T> \
+    void name(const T* x, T* y, uint_t n) { \
+        uint_t i = 0; \
+        for (; i + ops::width <= n; i += ops::width) { \
+            ops::store(y+i, name##_kernel<ops>(ops::load(x+i))); \
+        } \
+        if (i < n) { \
+            T tx[ops::width], ty[ops::width]; \
+            for (uint_t j = 0; j < ops::width; ++j) { \
+                tx[j] = (i+j < n ? x[i+j] : T(1)); \
+            } \
+            ops::store(ty, name##_kernel<ops>(ops::load(tx))); \
+            for (uint_t j = 0; i+j < n; ++j) { \
+                y[i+j] = ty[j]; \
+            } \
+        } \
+    }
+
+VIF_SIMD_KERNEL_ARRAY(exp)
+VIF_SIMD_KERNEL_ARRAY(log)
+VIF_SIMD_KERNEL_ARRAY(log2)
+VIF_SIMD_KERNEL_ARRAY(log10)
+VIF_SIMD_KERNEL_ARRAY(sqrt)
+
+#undef VIF_SIMD_KERNEL_ARRAY
+
+// Weighted sum of arrays: y[i] += sum_k w[k]*x[k][i], for i < n. This is the inner loop of
+// direct convolutions, where the x[k] are shifted rows of the image; the sum over k is done
+// in registers, so 'y' is only loaded and stored once. Two registers are processed at once to
+// hide the latency of the FMA.
+template<typename T>
+void weighted_sum(const T* const* x, const double* w, uint_t nw, T* y, uint_t n) {
+    using reg = typename ops::reg;
+    uint_t i = 0;
+    for (; i + 2*ops::width <= n; i += 2*ops::width) {
+        reg a0 = ops::load(y+i);
+        reg a1 = ops::load(y+i+ops::width);
+        for (uint_t k = 0; k < nw; ++k) {
+            reg wk = ops::set1(w[k]);
+            a0 = ops::fma(wk, ops::load(x[k]+i), a0);
+            a1 = ops::fma(wk, ops::load(x[k]+i+ops::width), a1);
+        }
+        ops::store(y+i, a0);
+        ops::store(y+i+ops::width, a1);
+    }
+    for (; i + ops::width <= n; i += ops::width) {
+        reg a = ops::load(y+i);
+        for (uint_t k = 0; k < nw; ++k) {
+            a = ops::fma(ops::set1(w[k]), ops::load(x[k]+i), a);
+        }
+        ops::store(y+i, a);
+    }
+    for (; i < n; ++i) {
+        double a = y[i];
+        for (uint_t k = 0; k < nw; ++k) {
+            a += w[k]*x[k][i];
+        }
+        y[i] = a;
+    }
+}
@@ -4,6 +4,9 @@
 #ifndef NO_FFTW
 #include <fftw3.h>
 #endif
+#include <map>
+#include <memory>
+#include <tuple>
 #include "vif/core/vec.hpp"
 #include "vif/utility/thread.hpp"
 #include "vif/math/complex.hpp"
@@ -16,23 +19,218 @@ namespace vif {
         }
     }
 
+    // Effort spent by FFTW to find the fastest algorithm for a given FFT
+    enum class fft_planning {
+        estimate, measure, patient, exhaustive
+    };
+
+    // Smallest size larger or equal to 'n' that only has 2, 3, 5 or 7 as prime factors, for
+    // which FFTs are the fastest. Arrays can be padded to this size before an FFT.
+    inline uint_t fft_fast_size(uint_t n) {
+        if (n <= 1) return 1;
+
+        for (uint_t m = n;; ++m) {
+            uint_t r = m;
+            for (uint_t f : {2, 3, 5, 7}) {
+                while (r % f == 0) r /= f;
+            }
+
+            if (r == 1) return m;
+        }
+    }
+
     #ifndef NO_FFTW
-    // Compute the Fast Fourier Transform (FFT) of the provided 2d array
-    inline void fft(const vec2d& v, vec2cd& r) {
-        fftw_plan p;
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            p = fftw_plan_dft_r2c_2d(v.dims[0], v.dims[1],
-                const_cast<double*>(v.raw_data()),
-                reinterpret_cast<fftw_complex*>(r.raw_data()), FFTW_ESTIMATE);
+    namespace impl {
+    namespace fourier_impl {
+        enum plan_kind {
+            r2c, c2r, c2c_forward, c2c_backward
+        };
+
+        struct plan_key {
+            plan_kind kind;
+            uint_t n0, n1;
+            bool aligned, inplace;
+            uint_t threads;
+            unsigned flags;
+
+            bool operator < (const plan_key& k) const {
+                return std::tie(kind, n0, n1, aligned, inplace, threads, flags) <
+                    std::tie(k.kind, k.n0, k.n1, k.aligned, k.inplace, k.threads, k.flags);
+            }
+        };
+
+        // Destroying a plan is not thread safe, it must hold fftw_planner_mutex()
+        struct plan_deleter {
+            void operator() (fftw_plan p) const {
+                std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+                fftw_destroy_plan(p);
+            }
+        };
+
+        // Plans are shared with the transforms that use them, so that they are only destroyed
+        // once the last transform is done, even if the cache is cleared in the meantime
+        using plan_ptr = std::shared_ptr<std::remove_pointer<fftw_plan>::type>;
+
+        // Plans are created once per array shape and reused for all the transforms of the
+        // same shape (with fftw_execute_dft_*, which is thread safe).
+        // Access is protected by fftw_planner_mutex().
+        struct plan_cache {
+            std::map<plan_key,plan_ptr> plans;
+            unsigned flags = FFTW_ESTIMATE;
+            uint_t threads = 1;
+            bool threads_init = false;
+        };
+
+        inline plan_cache& fftw_plans() {
+            // Make sure the mutex outlives the cache, since it is used to destroy the plans
+            fftw_planner_mutex();
+            static plan_cache c;
+            return c;
+        }
+
+        inline bool is_aligned(const void* p) {
+            return fftw_alignment_of(const_cast<double*>(static_cast<const double*>(p))) == 0;
+        }
+
+        inline fftw_plan make_plan(plan_kind kind, uint_t n0, uint_t n1, unsigned flags,
+            void* in, void* out) {
+
+            fftw_complex* cin = static_cast<fftw_complex*>(in);
+            fftw_complex* cout = static_cast<fftw_complex*>(out);
+            switch (kind) {
+                case r2c : return fftw_plan_dft_r2c_2d(n0, n1, static_cast<double*>(in), cout, flags);
+                case c2r : return fftw_plan_dft_c2r_2d(n0, n1, cin, static_cast<double*>(out), flags);
+                case c2c_forward : return fftw_plan_dft_2d(n0, n1, cin, cout, FFTW_FORWARD, flags);
+                case c2c_backward : return fftw_plan_dft_2d(n0, n1, cin, cout, FFTW_BACKWARD, flags);
+            }
+
+            return nullptr;
         }
 
-        fftw_execute(p);
+        // Get a plan for transforming 'in' into 'out', creating it if needed
+        inline plan_ptr get_plan(plan_kind kind, uint_t n0, uint_t n1, const void* in, void* out) {
+            plan_cache& cache = fftw_plans();
+            std::lock_guard<std::mutex> lock(fftw_planner_mutex());
 
+            plan_key key;
+            key.kind = kind;
+            key.n0 = n0;
+            key.n1 = n1;
+            key.aligned = is_aligned(in) && is_aligned(out);
+            key.inplace = in == out;
+            key.threads = cache.threads;
+            key.flags = cache.flags;
+
+            auto iter = cache.plans.find(key);
+            if (iter != cache.plans.end()) {
+                return iter->second;
+            }
+
+        #ifndef NO_FFTW_THREADS
+            if (!cache.threads_init) {
+                fftw_init_threads();
+                cache.threads_init = true;
+            }
+
+            fftw_plan_with_nthreads(key.threads);
+        #endif
+
+            unsigned flags = key.flags | (key.aligned ? 0 : FFTW_UNALIGNED);
+
+            fftw_plan p;
+            if (key.flags == FFTW_ESTIMATE) {
+                // The arrays are not touched when planning
+                p = make_plan(kind, n0, n1, flags, const_cast<void*>(in), out);
+            } else {
+                // The planner will overwrite the arrays, use temporary ones
+                const uint_t nc = n0*(kind == c2c_forward || kind == c2c_backward ? n1 : n1/2+1);
+                const uint_t nbyte = std::max(nc*sizeof(fftw_complex), n0*n1*sizeof(double));
+                void* tin = fftw_malloc(nbyte);
+                void* tout = key.inplace ? tin : fftw_malloc(nbyte);
+                vif_check(tin && tout, "could not allocate memory to plan the FFT");
+
+                p = make_plan(kind, n0, n1, flags, tin, tout);
+
+                fftw_free(tin);
+                if (!key.inplace) fftw_free(tout);
+            }
+
+            vif_check(p != nullptr, "could not create FFTW plan (", n0, "x", n1, ")");
+
+            plan_ptr sp(p, plan_deleter{});
+            cache.plans.insert(std::make_pair(key, sp));
+            return sp;
+        }
+
+        // Real to complex FFT of 'v', 'r' must have dimensions {dims[0], dims[1]/2+1}
+        inline void execute_r2c(const vec2d& v, vec2cd& r) {
+            plan_ptr p = get_plan(r2c, v.dims[0], v.dims[1], v.raw_data(), r.raw_data());
+            fftw_execute_dft_r2c(p.get(), const_cast<double*>(v.raw_data()),
+                reinterpret_cast<fftw_complex*>(r.raw_data()));
+        }
+
+        // Complex to real FFT of 'v' into 'r', the inverse of execute_r2c()
+        // NB: the input array is destroyed
+        inline void execute_c2r(vec2cd& v, vec2d& r) {
+            plan_ptr p = get_plan(c2r, r.dims[0], r.dims[1], v.raw_data(), r.raw_data());
+            fftw_execute_dft_c2r(p.get(), reinterpret_cast<fftw_complex*>(v.raw_data()), r.raw_data());
+        }
+    }
+    }
+
+    // Set the effort used to plan the FFTs (fft_planning::estimate by default). Since plans
+    // are reused for all the arrays of the same shape, a higher effort can pay off when many
+    // transforms of the same size are computed.
+    inline void fft_set_planning(fft_planning p) {
+        auto& cache = impl::fourier_impl::fftw_plans();
+        std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
+        switch (p) {
+            case fft_planning::estimate :   cache.flags = FFTW_ESTIMATE; break;
+            case fft_planning::measure :    cache.flags = FFTW_MEASURE; break;
+            case fft_planning::patient :    cache.flags = FFTW_PATIENT; break;
+            case fft_planning::exhaustive : cache.flags = FFTW_EXHAUSTIVE; break;
+        }
+    }
+
+    // Set the number of threads used by each FFT (ignored if FFTW was built without threads)
+    inline void fft_set_threads(uint_t nthread) {
+        auto& cache = impl::fourier_impl::fftw_plans();
+        std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
+        cache.threads = std::max(nthread, uint_t(1));
+    }
+
+    // Destroy all the plans kept in memory (plans used by FFTs still running in other threads
+    // are destroyed when these FFTs are done)
+    inline void fft_clear_plans() {
+        auto& cache = impl::fourier_impl::fftw_plans();
+        std::map<impl::fourier_impl::plan_key,impl::fourier_impl::plan_ptr> plans;
         {
             std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            fftw_destroy_plan(p);
+            std::swap(plans, cache.plans);
         }
+
+        // The plans are destroyed here, once the lock is released
+    }
+
+    // Load FFTW wisdom (plans measured in a previous run) from a file
+    inline bool fft_load_wisdom(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
+        return fftw_import_wisdom_from_filename(filename.c_str()) != 0;
+    }
+
+    // Save the FFTW wisdom accumulated so far to a file
+    inline bool fft_save_wisdom(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
+        return fftw_export_wisdom_to_filename(filename.c_str()) != 0;
+    }
+
+    // Compute the Fast Fourier Transform (FFT) of the provided 2d array
+    inline void fft(const vec2d& v, vec2cd& r) {
+        impl::fourier_impl::plan_ptr p = impl::fourier_impl::get_plan(impl::fourier_impl::r2c,
+            v.dims[0], v.dims[1], v.raw_data(), r.raw_data());
+
+        fftw_execute_dft_r2c(p.get(), const_cast<double*>(v.raw_data()),
+            reinterpret_cast<fftw_complex*>(r.raw_data()));
     }
 
     // Compute the Fast Fourier Transform (FFT) of the provided 2d array
@@ -42,22 +240,48 @@ namespace vif {
         return r;
     }
 
+    // Compute the Fast Fourier Transform (FFT) of the provided 2d real array, only keeping the
+    // non-redundant half of the spectrum: the result has dimensions {dims[0], dims[1]/2+1}
+    inline void rfft(const vec2d& v, vec2cd& r) {
+        r.resize(v.dims[0], v.dims[1]/2+1);
+        impl::fourier_impl::execute_r2c(v, r);
+    }
+
+    // Compute the Fast Fourier Transform (FFT) of the provided 2d real array, only keeping the
+    // non-redundant half of the spectrum: the result has dimensions {dims[0], dims[1]/2+1}
+    inline vec2cd rfft(const vec2d& v) {
+        vec2cd r;
+        rfft(v, r);
+        return r;
+    }
+
+    // Compute the inverse of rfft(), 'r' must have the dimensions of the real array
+    // NB: the FFTW routine does not preserve the data in input, so the
+    // input array has to be copied
+    inline void irfft(vec2cd v, vec2d& r) {
+        vif_check(r.dims[0] == v.dims[0] && r.dims[1]/2+1 == v.dims[1], "incompatible "
+            "dimensions for inverse real FFT (", v.dims, " vs. ", r.dims, ")");
+
+        impl::fourier_impl::execute_c2r(v, r);
+    }
+
+    // Compute the inverse of rfft(), for a real array of dimensions 'dims'
+    // NB: the FFTW routine does not preserve the data in input, so the
+    // input array has to be copied
+    inline vec2d irfft(vec2cd v, const std::array<uint_t,2>& dims) {
+        vec2d r(dims);
+        irfft(std::move(v), r);
+        return r;
+    }
+
     // Compute the Fast Fourier Transform (FFT) of the provided 2d complex array
     inline void fft_c2c(const vec2cd& v, vec2cd& r) {
-        fftw_plan p;
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            p = fftw_plan_dft_2d(v.dims[0], v.dims[1],
-                const_cast<fftw_complex*>(reinterpret_cast<const fftw_complex*>(v.raw_data())),
-                reinterpret_cast<fftw_complex*>(r.raw_data()), FFTW_FORWARD, FFTW_ESTIMATE);
-        }
-
-        fftw_execute(p);
+        impl::fourier_impl::plan_ptr p = impl::fourier_impl::get_plan(impl::fourier_impl::c2c_forward,
+            v.dims[0], v.dims[1], v.raw_data(), r.raw_data());
 
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            fftw_destroy_plan(p);
-        }
+        fftw_execute_dft(p.get(),
+            const_cast<fftw_complex*>(reinterpret_cast<const fftw_complex*>(v.raw_data())),
+            reinterpret_cast<fftw_complex*>(r.raw_data()));
     }
 
     // Compute the Fast Fourier Transform (FFT) of the provided 2d array
@@ -71,20 +295,10 @@ namespace vif {
     // NB: the FFTW routine does not preserve the data in input, so the
     // input array has to be copied
     inline void ifft(vec2cd v, vec2d& r) {
-        fftw_plan p;
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            p = fftw_plan_dft_c2r_2d(v.dims[0], v.dims[1],
-                reinterpret_cast<fftw_complex*>(v.raw_data()),
-                r.raw_data(), FFTW_ESTIMATE);
-        }
+        impl::fourier_impl::plan_ptr p = impl::fourier_impl::get_plan(impl::fourier_impl::c2r,
+            v.dims[0], v.dims[1], v.raw_data(), r.raw_data());
 
-        fftw_execute(p);
-
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            fftw_destroy_plan(p);
-        }
+        fftw_execute_dft_c2r(p.get(), reinterpret_cast<fftw_complex*>(v.raw_data()), r.raw_data());
     }
 
     // Compute the Fast Fourier Transform (FFT) of the provided 2d array
@@ -100,20 +314,11 @@ namespace vif {
     // NB: the FFTW routine does not preserve the data in input, so the
     // input array has to be copied
     inline void ifft_c2c(vec2cd v, vec2cd& r) {
-        fftw_plan p;
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            p = fftw_plan_dft_2d(v.dims[0], v.dims[1],
-                reinterpret_cast<fftw_complex*>(v.raw_data()),
-                reinterpret_cast<fftw_complex*>(r.raw_data()), FFTW_BACKWARD, FFTW_ESTIMATE);
-        }
-
-        fftw_execute(p);
+        impl::fourier_impl::plan_ptr p = impl::fourier_impl::get_plan(impl::fourier_impl::c2c_backward,
+            v.dims[0], v.dims[1], v.raw_data(), r.raw_data());
 
-        {
-            std::lock_guard<std::mutex> lock(impl::fftw_planner_mutex());
-            fftw_destroy_plan(p);
-        }
+        fftw_execute_dft(p.get(), reinterpret_cast<fftw_complex*>(v.raw_data()),
+            reinterpret_cast<fftw_complex*>(r.raw_data()));
     }
 
     // Compute the Fast Fourier Transform (FFT) of the provided 2d array
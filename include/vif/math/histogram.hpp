@@ -186,84 +186,256 @@ namespace vif {
         return b.safe[1] - b.safe[0];
     }
 
-    template<std::size_t Dim, typename Type, typename TypeB>
-    vec1u histogram(const vec<Dim,Type>& data, const vec<2,TypeB>& bins) {
-        vif_check(bins.dims[0] == 2, "can only be called with a bin vector (expected "
-            "dims=[2,...], got dims=[", bins.dims, "])");
+    namespace impl {
+        // Locate the bin containing a value. As for in_bin(), a value t belongs to bin i if
+        // bins(0,i) <= t < bins(1,i); a value that belongs to several bins goes to the first
+        // one, and npos is returned if it belongs to none.
+        //
+        // The search strategy is chosen from the bins once: contiguous bins of (nearly)
+        // constant width use a direct index computation, other sorted and non-overlapping
+        // bins use a binary search on the lower edges, and all other bins are tested in turn.
+        template<typename TypeB>
+        struct bin_finder {
+            using btype = meta::rtype_t<TypeB>;
+
+            enum search_t {
+                uniform, sorted, linear
+            };
+
+            std::vector<btype> low, up;
+            uint_t nbin = 0;
+            search_t search = linear;
+            double x0 = 0.0;
+            double inv_width = 0.0;
+
+            explicit bin_finder(const vec<2,TypeB>& bins) : nbin(bins.dims[1]) {
+                vif_check(bins.dims[0] == 2, "can only be called with a bin vector (expected "
+                    "dims=[2, ...], got dims=[", bins.dims, "])");
+
+                low.resize(nbin);
+                up.resize(nbin);
+                for (uint_t i : range(nbin)) {
+                    low[i] = bins.safe(0,i);
+                    up[i]  = bins.safe(1,i);
+                }
 
-        using rtype = meta::rtype_t<Type>;
-        vec<Dim,rtype> tmp = data;
+                if (nbin == 0) return;
 
-        uint_t nbin = bins.dims[1];
-        vec1u counts(nbin);
+                bool is_sorted = true, contiguous = true;
+                for (uint_t i : range(nbin)) {
+                    if (!(low[i] <= up[i])) {
+                        is_sorted = false;
+                        break;
+                    }
 
-        auto first = tmp.data.begin();
-        for (uint_t i : range(nbin)) {
-            auto last = std::partition(first, tmp.data.end(), [&bins,i](rtype t) {
-                return t >= bins.safe(0,i) && t < bins.safe(1,i);
-            });
+                    if (i != nbin-1) {
+                        if (!(up[i] <= low[i+1])) {
+                            is_sorted = false;
+                            break;
+                        }
 
-            counts.safe[i] = last - first;
-            first = last;
+                        contiguous = contiguous && up[i] == low[i+1];
+                    }
+                }
 
-            if (last == tmp.data.end()) break;
-        }
+                if (!is_sorted) return;
 
-        return counts;
-    }
+                search = sorted;
+                if (!contiguous || !(low[0] < up[nbin-1])) return;
 
-    template<std::size_t Dim, typename Type, typename TypeB, typename TypeW>
-    vec<1,meta::rtype_t<TypeW>> histogram(const vec<Dim,Type>& data, const vec<Dim,TypeW>& weight,
-        const vec<2,TypeB>& bins) {
-        vif_check(bins.dims[0] == 2, "can only be called with a bin vector (expected "
-            "dims=[2, ...], got dims=[", bins.dims, "])");
-        vif_check(data.dims == weight.dims, "incompatible dimensions for data and weight "
-            "(", data.dims, " vs. ", weight.dims, ")");
+                // Uniform bins: the guessed index must be off by at most one bin
+                x0 = low[0];
+                double width = (double(up[nbin-1]) - x0)/nbin;
+                for (uint_t i : range(nbin)) {
+                    if (!(low[i] < up[i]) || std::abs(double(low[i]) - (x0 + i*width)) > 0.25*width) {
+                        return;
+                    }
+                }
+
+                search = uniform;
+                inv_width = 1.0/width;
+            }
+
+            template<typename T>
+            uint_t operator() (const T& t) const {
+                switch (search) {
+                case uniform : {
+                    if (!(t >= low[0] && t < up[nbin-1])) return npos;
+
+                    double d = (double(t) - x0)*inv_width;
+                    uint_t i = (d > 0.0 ? std::min(uint_t(d), nbin-1) : 0);
+                    while (t < low[i]) --i;
+                    while (!(t < up[i])) ++i;
+                    return i;
+                }
+                case sorted : {
+                    auto iter = std::upper_bound(low.begin(), low.end(), t);
+                    if (iter == low.begin()) return npos;
 
-        vec1u ids = indgen<uint_t>(data.size());
+                    uint_t i = (iter - low.begin()) - 1;
+                    return t < up[i] ? i : npos;
+                }
+                default : {
+                    for (uint_t i : range(nbin)) {
+                        if (t >= low[i] && t < up[i]) return i;
+                    }
+
+                    return npos;
+                }
+                }
+            }
+        };
 
-        uint_t nbin = bins.dims[1];
-        vec<1,meta::rtype_t<TypeW>> counts(nbin);
+        template<typename R, typename F>
+        vec<1,R> histogram_sum_dispatch_(uint_t n, uint_t nbin, F& accumulate, std::true_type) {
+            if (!parallel_enabled(n)) {
+                return accumulate(uint_t(0), n);
+            }
 
-        auto first = ids.data.begin();
-        for (uint_t i : range(nbin)) {
-            auto last = std::partition(first, ids.data.end(), [&bins,&data,i](uint_t id) {
-                return data.safe[id] >= bins.safe(0,i) && data.safe[id] < bins.safe(1,i);
+            // Integer sums: partial histograms can be merged in any order
+            vec<1,R> r(nbin);
+            std::mutex m;
+            parallel_range(n, [&](uint_t i0, uint_t i1) {
+                vec<1,R> p = accumulate(i0, i1);
+                std::lock_guard<std::mutex> l(m);
+                for (uint_t k : range(nbin)) {
+                    r.safe[k] += p.safe[k];
+                }
             });
 
-            for (; first != last; ++first) {
-                counts.safe[i] += weight.safe[*first];
+            return r;
+        }
+
+        // Floating point sums: the input is split into at most 64 chunks, each at least as
+        // large as a reduction block and as the number of bins. The chunks only depend on 'n'
+        // and 'nbin', and their partial histograms are added in order, so the result does
+        // not depend on the number of threads. Serial runs only keep one partial at a time.
+        template<typename R, typename F>
+        vec<1,R> histogram_sum_dispatch_(uint_t n, uint_t nbin, F& accumulate, std::false_type) {
+            const uint_t max_chunk = 64;
+            const uint_t chunk = std::max(std::max(parallel_impl::reduce_chunk, nbin),
+                (n + max_chunk - 1)/max_chunk);
+            const uint_t nchunk = (n + chunk - 1)/chunk;
+            if (nchunk <= 1) {
+                return accumulate(uint_t(0), n);
+            }
+
+            auto chunk_sum = [&](uint_t c) {
+                uint_t i0 = c*chunk;
+                return accumulate(i0, std::min(n, i0 + chunk));
+            };
+
+            vec<1,R> r;
+            if (parallel_enabled(n)) {
+                std::vector<vec<1,R>> part(nchunk);
+                parallel_impl::pool().run(parallel_impl::policy().nthread, nchunk, [&](uint_t c) {
+                    part[c] = chunk_sum(c);
+                });
+
+                r = std::move(part[0]);
+                for (uint_t c = 1; c < nchunk; ++c) {
+                    r += part[c];
+                }
+            } else {
+                r = chunk_sum(0);
+                for (uint_t c = 1; c < nchunk; ++c) {
+                    r += chunk_sum(c);
+                }
             }
 
-            if (last == ids.data.end()) break;
+            return r;
         }
 
-        return counts;
-    }
+        // Sum w(i) into bin b(i) for all i in [0,n), skipping elements with b(i) == npos.
+        // When parallel execution is enabled, each thread builds its own partial histogram.
+        template<typename R, typename FB, typename FW>
+        vec<1,R> histogram_sum_(uint_t n, uint_t nbin, const FB& b, const FW& w) {
+            auto accumulate = [&](uint_t i0, uint_t i1) {
+                vec<1,R> r(nbin);
+                for (uint_t i = i0; i < i1; ++i) {
+                    uint_t k = b(i);
+                    if (k != npos) {
+                        r.safe[k] += w(i);
+                    }
+                }
 
-    namespace impl {
-        template<std::size_t Dim, typename Type, typename TypeB, typename F>
-        void histogram_impl(const vec<Dim,Type>& data, const vec<2,TypeB>& bins, F&& func) {
-            vif_check(bins.dims[0] == 2, "can only be called with a bin vector (expected "
-                "dims=[2, ...], got dims=[", bins.dims, "])");
+                return r;
+            };
 
-            vec1u ids = indgen<uint_t>(data.size());
-            using iterator = vec1u::const_iterator;
+            return histogram_sum_dispatch_<R>(n, nbin, accumulate, std::is_integral<R>{});
+        }
+
+        // Find the bin of each element of 'data' (npos if none)
+        template<std::size_t Dim, typename Type, typename TypeB>
+        vec1u histogram_bin_ids_(const vec<Dim,Type>& data, const bin_finder<TypeB>& find) {
+            vec1u bid(data.size());
+            parallel_each<uint_t>(data.size(), [&](uint_t i) {
+                bid.safe[i] = find(data.safe[i]);
+            });
+
+            return bid;
+        }
+
+        // Sort the indices [0,n) by bin with a counting sort, keeping the original order
+        // within each bin, and call func(i, ids, i0, i1) for each bin, where [i0,i1) is the
+        // range of 'ids' holding the indices of the elements that fall in bin i.
+        template<typename F>
+        void histogram_group_(const vec1u& bid, uint_t nbin, F&& func) {
+            vec1u offset(nbin+1);
+            for (uint_t k : bid) {
+                if (k != npos) ++offset.safe[k+1];
+            }
 
-            uint_t nbin = bins.dims[1];
-            auto first = ids.data.begin();
             for (uint_t i : range(nbin)) {
-                auto last = std::partition(first, ids.data.end(), [&bins,&data,i](uint_t id) {
-                    return data.safe[id] >= bins.safe(0,i) && data.safe[id] < bins.safe(1,i);
-                });
+                offset.safe[i+1] += offset.safe[i];
+            }
 
-                func(i, meta::add_const(ids), iterator{first}, iterator{last});
+            vec1u ids(offset.safe[nbin]);
+            vec1u pos = offset;
+            for (uint_t i : range(bid)) {
+                uint_t k = bid.safe[i];
+                if (k != npos) ids.safe[pos.safe[k]++] = i;
+            }
 
-                if (last == ids.data.end()) break;
+            using iterator = vec1u::const_iterator;
+            auto first = meta::add_const(ids).data.begin();
+            for (uint_t i : range(nbin)) {
+                func(i, meta::add_const(ids),
+                    iterator{first + offset.safe[i]}, iterator{first + offset.safe[i+1]});
             }
         }
     }
 
+    template<std::size_t Dim, typename Type, typename TypeB>
+    vec1u histogram(const vec<Dim,Type>& data, const vec<2,TypeB>& bins) {
+        impl::bin_finder<TypeB> find(bins);
+
+        return impl::histogram_sum_<uint_t>(data.size(), find.nbin,
+            [&](uint_t i) { return find(data.safe[i]); },
+            [](uint_t) { return 1u; });
+    }
+
+    template<std::size_t Dim, typename Type, typename TypeB, typename TypeW>
+    vec<1,meta::rtype_t<TypeW>> histogram(const vec<Dim,Type>& data, const vec<Dim,TypeW>& weight,
+        const vec<2,TypeB>& bins) {
+        vif_check(data.dims == weight.dims, "incompatible dimensions for data and weight "
+            "(", data.dims, " vs. ", weight.dims, ")");
+
+        impl::bin_finder<TypeB> find(bins);
+
+        return impl::histogram_sum_<meta::rtype_t<TypeW>>(data.size(), find.nbin,
+            [&](uint_t i) { return find(data.safe[i]); },
+            [&](uint_t i) { return weight.safe[i]; });
+    }
+
+    namespace impl {
+        template<std::size_t Dim, typename Type, typename TypeB, typename F>
+        void histogram_impl(const vec<Dim,Type>& data, const vec<2,TypeB>& bins, F&& func) {
+            bin_finder<TypeB> find(bins);
+            histogram_group_(histogram_bin_ids_(data, find), find.nbin, func);
+        }
+    }
+
     template<std::size_t Dim, typename Type, typename TypeB, typename TypeF>
     void histogram(const vec<Dim,Type>& x, const vec<2,TypeB>& bins, TypeF&& func) {
         using iterator = vec1u::const_iterator;
@@ -284,46 +456,41 @@ namespace vif {
     }
 
     namespace impl {
+        // Find the 2D bin of each element, flattened as i*nybin + j (npos if none)
         template<std::size_t Dim, typename TypeX, typename TypeY, typename TypeBX,
-            typename TypeBY, typename TypeF>
-        void histogram2d_impl(const vec<Dim,TypeX>& x, const vec<Dim,TypeY>& y,
-            const vec<2,TypeBX>& xbins, const vec<2,TypeBY>& ybins, TypeF&& func) {
+            typename TypeBY>
+        vec1u histogram2d_bin_ids_(const vec<Dim,TypeX>& x, const vec<Dim,TypeY>& y,
+            const bin_finder<TypeBX>& findx, const bin_finder<TypeBY>& findy) {
 
-            vif_check(xbins.dims[0] == 2, "can only be called with a bin vector (expected "
-                "dims=[2, ...], got dims=[", xbins.dims, "])");
-            vif_check(ybins.dims[0] == 2, "can only be called with a bin vector (expected "
-                "dims=[2, ...], got dims=[", ybins.dims, "])");
             vif_check(x.dims == y.dims, "incompatible dimensions for x and y (", x.dims, " vs. ",
                 y.dims, ")");
 
-            vec1u ids = indgen<uint_t>(x.size());
-
-            uint_t nxbin = xbins.dims[1];
-            uint_t nybin = ybins.dims[1];
-
-            using iterator = vec1u::const_iterator;
+            const uint_t nybin = findy.nbin;
+            vec1u bid(x.size());
+            parallel_each<uint_t>(x.size(), [&](uint_t i) {
+                uint_t bx = findx(x.safe[i]);
+                uint_t by = (bx == npos ? npos : findy(y.safe[i]));
+                bid.safe[i] = (by == npos ? npos : bx*nybin + by);
+            });
 
-            auto firstx = ids.data.begin();
-            for (uint_t i : range(nxbin)) {
-                auto lastx = std::partition(firstx, ids.data.end(), [&xbins,&x,i](uint_t id) {
-                    return x.safe[id] >= xbins.safe(0,i) && x.safe[id] < xbins.safe(1,i);
-                });
+            return bid;
+        }
 
-                auto firsty = firstx;
-                for (uint_t j : range(nybin)) {
-                    auto lasty = std::partition(firsty, lastx, [&ybins,&y,j](uint_t id) {
-                        return y.safe[id] >= ybins.safe(0,j) && y.safe[id] < ybins.safe(1,j);
-                    });
+        template<std::size_t Dim, typename TypeX, typename TypeY, typename TypeBX,
+            typename TypeBY, typename TypeF>
+        void histogram2d_impl(const vec<Dim,TypeX>& x, const vec<Dim,TypeY>& y,
+            const vec<2,TypeBX>& xbins, const vec<2,TypeBY>& ybins, TypeF&& func) {
 
-                    func(i, j, meta::add_const(ids), iterator{firsty}, iterator{lasty});
+            bin_finder<TypeBX> findx(xbins);
+            bin_finder<TypeBY> findy(ybins);
 
-                    if (lasty == lastx) break;
-                    firsty = lasty;
+            const uint_t nybin = findy.nbin;
+            using iterator = vec1u::const_iterator;
+            histogram_group_(histogram2d_bin_ids_(x, y, findx, findy), findx.nbin*nybin,
+                [&](uint_t k, const vec1u& ids, iterator i0, iterator i1) {
+                    func(k/nybin, k%nybin, ids, i0, i1);
                 }
-
-                if (lastx == ids.data.end()) break;
-                firstx = lastx;
-            }
+            );
         }
     }
 
@@ -331,15 +498,23 @@ namespace vif {
     vec2u histogram2d(const vec<Dim,TypeX>& x, const vec<Dim,TypeY>& y,
         const vec<2,TypeBX>& xbins, const vec<2,TypeBY>& ybins) {
 
-        vec2u counts(xbins.dims[1], ybins.dims[1]);
+        vif_check(x.dims == y.dims, "incompatible dimensions for x and y (", x.dims, " vs. ",
+            y.dims, ")");
 
-        using iterator = vec1u::const_iterator;
-        impl::histogram2d_impl(x, y, xbins, ybins,
-            [&](uint_t i, uint_t j, const vec1u& ids, iterator i0, iterator i1) {
-                counts.safe(i,j) = i1 - i0;
-            }
-        );
+        impl::bin_finder<TypeBX> findx(xbins);
+        impl::bin_finder<TypeBY> findy(ybins);
+
+        const uint_t nybin = findy.nbin;
+        vec1u flat = impl::histogram_sum_<uint_t>(x.size(), findx.nbin*nybin,
+            [&](uint_t i) {
+                uint_t bx = findx(x.safe[i]);
+                uint_t by = (bx == npos ? npos : findy(y.safe[i]));
+                return by == npos ? npos : bx*nybin + by;
+            },
+            [](uint_t) { return 1u; });
 
+        vec2u counts(findx.nbin, nybin);
+        counts.data = std::move(flat.data);
         return counts;
     }
 
@@ -21,12 +21,15 @@ namespace vif {
         std::is_arithmetic<meta::rtype_t<Type>>::value
     >::type>
     meta::total_return_type<meta::rtype_t<Type>> total(const vec<Dim,Type>& v) {
-        meta::total_return_type<meta::rtype_t<Type>> total = 0;
-        for (auto& t : v) {
-            total += t;
-        }
+        using rtype = meta::total_return_type<meta::rtype_t<Type>>;
+        return impl::parallel_reduce<rtype>(v.size(), [&](uint_t i0, uint_t i1) {
+            rtype total = 0;
+            for (uint_t i = i0; i < i1; ++i) {
+                total += v.safe[i];
+            }
 
-        return total;
+            return total;
+        }, std::plus<rtype>());
     }
 
     template<std::size_t Dim = 1, typename Type = bool, typename enable =
@@ -44,14 +47,52 @@ namespace vif {
         std::is_arithmetic<meta::rtype_t<Type>>::value
     >::type>
     double mean(const vec<Dim,Type>& v) {
-        double total = 0.0;
-        for (auto& t : v) {
-            total += t;
-        }
+        double total = impl::parallel_reduce<double>(v.size(), [&](uint_t i0, uint_t i1) {
+            double total = 0.0;
+            for (uint_t i = i0; i < i1; ++i) {
+                total += v.safe[i];
+            }
+
+            return total;
+        }, std::plus<double>());
 
         return total/v.size();
     }
 
+    // Reductions of lazy expressions: the expression is evaluated on the fly, without
+    // creating a temporary vector.
+    template<typename E, typename enable = typename std::enable_if<
+        meta::is_lazy_expr<E>::value && std::is_arithmetic<typename E::value_type>::value
+    >::type>
+    meta::total_return_type<typename E::value_type> total(const E& e) {
+        using rtype = meta::total_return_type<typename E::value_type>;
+        return impl::parallel_reduce<rtype>(e.size(), [&](uint_t i0, uint_t i1) {
+            rtype total = 0;
+            for (uint_t i = i0; i < i1; ++i) {
+                total += e[i];
+            }
+
+            return total;
+        }, std::plus<rtype>());
+    }
+
+    template<typename E, typename enable = typename std::enable_if<
+        meta::is_lazy_expr<E>::value && std::is_arithmetic<typename E::value_type>::value
+    >::type>
+    double mean(const E& e) {
+        const uint_t n = e.size();
+        double total = impl::parallel_reduce<double>(n, [&](uint_t i0, uint_t i1) {
+            double total = 0.0;
+            for (uint_t i = i0; i < i1; ++i) {
+                total += e[i];
+            }
+
+            return total;
+        }, std::plus<double>());
+
+        return total/n;
+    }
+
     template<std::size_t Dim, typename Type, typename TypeW, typename enable = typename std::enable_if<
         std::is_arithmetic<meta::rtype_t<Type>>::value && std::is_arithmetic<meta::rtype_t<TypeW>>::value
     >::type>
@@ -265,26 +306,27 @@ namespace vif {
     }
 
     namespace impl {
+        // Find the first element for which no other element compares lower with 'Comp',
+        // like std::min_element, but by blocks (see parallel_reduce()).
+        template<typename Comp, std::size_t Dim, typename Type>
+        uint_t extremum_(const vec<Dim,Type>& v) {
+            return impl::parallel_reduce<uint_t>(v.size(), [&](uint_t i0, uint_t i1) {
+                return uint_t(std::min_element(v.begin()+i0, v.begin()+i1, Comp()) - v.begin());
+            }, [&](uint_t i1, uint_t i2) {
+                return Comp()(v.safe[i2], v.safe[i1]) ? i2 : i1;
+            });
+        }
+
         template<std::size_t Dim, typename Type>
         typename vec<Dim,Type>::const_iterator min_(const vec<Dim,Type>& v) {
             vif_check(!v.empty(), "cannot find the minimum of an empty vector");
-
-            auto iter = std::min_element(v.begin(), v.end(),
-                typename vec<Dim,Type>::comparator_less());
-
-            if (iter == v.end()) iter = v.begin();
-            return iter;
+            return v.begin() + extremum_<typename vec<Dim,Type>::comparator_less>(v);
         }
 
         template<std::size_t Dim, typename Type>
         typename vec<Dim,Type>::const_iterator max_(const vec<Dim,Type>& v) {
             vif_check(!v.empty(), "cannot find the maximum of an empty vector");
-
-            auto iter = std::min_element(v.begin(), v.end(),
-                typename vec<Dim,Type>::comparator_greater());
-
-            if (iter == v.end()) iter = v.begin();
-            return iter;
+            return v.begin() + extremum_<typename vec<Dim,Type>::comparator_greater>(v);
         }
 
         template<std::size_t Dim, typename Type>
@@ -298,29 +340,46 @@ namespace vif {
             // algorithm. This should not be noticeable, but could be improved by using a
             // filtered iterator that automatically skips NaN values.
             // See, e.g., boost::filter_iterator for a working implementation.
-            using iterator = typename vec<Dim,Type>::const_iterator;
-            std::pair<iterator,iterator> res;
+            // The search is done by blocks (see parallel_reduce()), and 'npos' marks blocks
+            // containing only NaN.
+            using ids_t = std::pair<uint_t,uint_t>;
+            ids_t ids = impl::parallel_reduce<ids_t>(v.size(), [&](uint_t i0, uint_t i1) {
+                ids_t res(npos, npos);
+
+                uint_t i = i0;
+                while (i != i1 && is_nan(v.safe[i])) {
+                    ++i;
+                }
 
-            iterator i = v.begin();
-            while (i != v.end() && is_nan(*i)) {
-                ++i;
-            }
+                if (i == i1) {
+                    return res;
+                }
+
+                res.first = i; res.second = i;
+
+                for (++i; i != i1; ++i) {
+                    if (is_nan(v.safe[i])) continue;
+                    if (v.safe[i] < v.safe[res.first])          res.first = i;
+                    else if (!(v.safe[i] < v.safe[res.second])) res.second = i;
+                }
 
-            if (i == v.end()) {
-                // Only NaN
-                res.first = v.begin(); res.second = v.begin();
                 return res;
-            }
+            }, [&](const ids_t& r1, const ids_t& r2) {
+                if (r1.first == npos) return r2;
+                if (r2.first == npos) return r1;
 
-            res.first = i; res.second = i;
+                ids_t res = r1;
+                if (v.safe[r2.first] < v.safe[r1.first])     res.first = r2.first;
+                if (!(v.safe[r2.second] < v.safe[r1.second])) res.second = r2.second;
+                return res;
+            });
 
-            for (++i; i != v.end(); ++i) {
-                if (is_nan(*i)) continue;
-                if (*i < *res.first)          res.first = i;
-                else if (!(*i < *res.second)) res.second = i;
+            if (ids.first == npos) {
+                // Only NaN
+                return std::make_pair(v.begin(), v.begin());
             }
 
-            return res;
+            return std::make_pair(v.begin() + ids.first, v.begin() + ids.second);
         }
     }
 
@@ -452,10 +511,14 @@ namespace vif {
         std::is_arithmetic<meta::rtype_t<Type>>::value
     >::type>
     double rms(const vec<Dim,Type>& v) {
-        double sum = 0;
-        for (auto& t : v) {
-            sum += t*t;
-        }
+        double sum = impl::parallel_reduce<double>(v.size(), [&](uint_t i0, uint_t i1) {
+            double sum = 0;
+            for (uint_t i = i0; i < i1; ++i) {
+                sum += v.safe[i]*v.safe[i];
+            }
+
+            return sum;
+        }, std::plus<double>());
 
         return sqrt(sum/v.size());
     }
@@ -9,66 +9,13 @@ namespace thread {
         bool verbose = false;
         uint_t progress_step = 1;
         double update_rate = 0.1;
+        // Largest number of iterations executed in one go by a thread (0: automatic).
+        // Ranges are split further only when other threads run out of work.
         uint_t chunk_size = 0;
 
     private :
 
-        struct worker_t {
-            thread_t thread;
-            parallel_for& pfor;
-
-            explicit worker_t(parallel_for& p) : pfor(p) {}
-
-            worker_t(worker_t&& w) : pfor(w.pfor) {}
-
-            worker_t(const worker_t& w) = delete;
-
-            template<typename F>
-            void start(const F& f, bool verbose) {
-                thread.start([this,&f,verbose]() {
-                    uint_t i0, i1;
-                    while (pfor.query_chunk(i0, i1)) {
-                        for (uint_t i : range(i0, i1)) {
-                            f(i);
-                            if (verbose) {
-                                ++pfor.iter;
-                            }
-                        }
-                    }
-                });
-            }
-
-            void join() {
-                thread.join();
-            }
-        };
-
-        // Workers
-        std::vector<parallel_for::worker_t> workers;
-
-        // Internal
-        std::mutex query_mutex;
-        std::atomic<uint_t> iter;
-        uint_t n, i0, i1, di;
-
-        bool query_chunk(uint_t& oi0, uint_t& oi1) {
-            std::unique_lock<std::mutex> l(query_mutex);
-
-            if (i0 == n) {
-                return false;
-            }
-
-            oi0 = i0;
-            oi1 = i1;
-
-            i0 = i1;
-            i1 += di;
-            if (i1 > n) {
-                i1 = n;
-            }
-
-            return true;
-        }
+        uint_t nthread = 0;
 
     public :
 
@@ -76,17 +23,19 @@ namespace thread {
         parallel_for(const parallel_for&) = delete;
         parallel_for(parallel_for&&) = delete;
 
-        explicit parallel_for(uint_t nthread) {
-            for (uint_t i = 0; i < nthread; ++i) {
-                workers.emplace_back(*this);
-            }
-        }
+        // Run with 'nthread' threads, taken from the work-stealing scheduler. Threads are not
+        // created for each call to execute().
+        // Note: the calling thread is one of the 'nthread' threads, and only nthread-1 threads
+        // come from the scheduler. Previously, 'nthread' new threads ran the loop while the
+        // calling thread waited idle: the number of threads running the loop is unchanged.
+        // With 'nthread' <= 1 the loop runs in the calling thread.
+        explicit parallel_for(uint_t nt) : nthread(nt) {}
 
         template<typename F>
         void execute(const F& f, uint_t ifirst, uint_t ilast) {
-            n = ilast - ifirst;
+            const uint_t n = (ilast > ifirst ? ilast - ifirst : 0);
 
-            if (workers.empty()) {
+            if (nthread <= 1) {
                 // Single-threaded execution
                 auto pg = progress_start(n);
                 for (uint_t i : range(ifirst, ilast)) {
@@ -97,40 +46,35 @@ namespace thread {
                 }
             } else {
                 // Multi-threaded execution
-                uint_t nchunk = (chunk_size == 0 ?
-                    workers.size() : std::max(workers.size(), n/chunk_size));
-
-                // Setup chunks
-                di = n/nchunk + 1;
-                i0 = ifirst;
-                i1 = ifirst + di;
-                iter = 0;
+                uint_t grain = (chunk_size == 0 ?
+                    std::max(uint_t(1), n/(256*nthread)) : chunk_size);
 
-                // Launch threads
-                for (auto& t : workers) {
-                    t.start(f, verbose);
-                }
-
-                progress_t pg;
-                if (verbose) {
-                    pg = progress_start(n);
-                }
-
-                // Wait for all threads to finish before returning
-                if (verbose) {
-                    while (iter < n) {
-                        thread::sleep_for(update_rate);
-                        print_progress(pg, iter);
+                std::atomic<uint_t> iter(0);
+                std::function<void(uint_t,uint_t)> run = [&](uint_t i0, uint_t i1) {
+                    for (uint_t i = i0; i < i1; ++i) {
+                        f(i);
                     }
-                }
 
-                // Join all
-                for (auto& t : workers) {
-                    t.join();
-                }
+                    if (verbose) {
+                        iter += i1 - i0;
+                    }
+                };
 
                 if (verbose) {
-                    print_progress(pg, iter);
+                    auto pg = progress_start(n);
+                    double last = now();
+                    std::function<void()> hook = [&]() {
+                        double t = now();
+                        if (t - last >= update_rate) {
+                            last = t;
+                            print_progress(pg, iter.load());
+                        }
+                    };
+
+                    scheduler().execute(nthread, ifirst, ilast, grain, run, &hook);
+                    print_progress(pg, iter.load());
+                } else {
+                    scheduler().execute(nthread, ifirst, ilast, grain, run);
                 }
             }
         }
@@ -141,7 +85,7 @@ namespace thread {
         }
 
         uint_t size() const {
-            return workers.size();
+            return nthread;
         }
     };
 }
@@ -123,5 +123,295 @@ namespace thread {
             last_ = dummy_ = first_;
         }
     };
+
+    /// Thread-safe and lock-free bounded FIFO queue.
+    /// Multiple Producers, Multiple Consumers (MPMC).
+    /** The queue is a ring buffer with a fixed capacity (rounded up to a power of two),
+        allocated once on construction: push() never allocates memory, and returns false if
+        the queue is full. Each cell stores a sequence number, which tells producers and
+        consumers whether the cell is ready to be written or read; the read and write
+        positions are kept on separate cache lines to avoid false sharing.
+        Note: implementation follows:
+        http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+    **/
+    template<typename T>
+    class mpmc_queue {
+        struct cell {
+            std::atomic<uint_t> seq;
+            T                   data;
+        };
+
+        static const std::size_t cache_line = 64;
+
+        std::unique_ptr<cell[]> buffer_;
+        uint_t                  mask_ = 0;
+        char                    pad0_[cache_line];
+        std::atomic<uint_t>     enqueue_pos_;
+        char                    pad1_[cache_line];
+        std::atomic<uint_t>     dequeue_pos_;
+        char                    pad2_[cache_line];
+
+    public :
+        explicit mpmc_queue(uint_t capacity = 1024) : enqueue_pos_(0), dequeue_pos_(0) {
+            uint_t n = 2;
+            while (n < capacity) {
+                n *= 2;
+            }
+
+            buffer_.reset(new cell[n]);
+            mask_ = n - 1;
+            for (uint_t i = 0; i < n; ++i) {
+                buffer_[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        mpmc_queue(const mpmc_queue& q) = delete;
+        mpmc_queue& operator = (const mpmc_queue& q) = delete;
+
+        /// Push a new element at the back of the queue, if there is room for it.
+        /** Can be called by any thread. Returns false (and leaves 't' untouched) if the
+            queue is full.
+        **/
+        template<typename U>
+        bool push(U&& t) {
+            cell* c;
+            uint_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            while (true) {
+                c = &buffer_[pos & mask_];
+                uint_t seq = c->seq.load(std::memory_order_acquire);
+                int_t diff = int_t(seq) - int_t(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            c->data = std::forward<U>(t);
+            c->seq.store(pos + 1);
+            return true;
+        }
+
+        /// Pop an element from the front of the queue.
+        /** Can be called by any thread. Returns false if the queue is empty.
+        **/
+        bool pop(T& t) {
+            cell* c;
+            uint_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            while (true) {
+                c = &buffer_[pos & mask_];
+                uint_t seq = c->seq.load(std::memory_order_acquire);
+                int_t diff = int_t(seq) - int_t(pos + 1);
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            t = std::move(c->data);
+            c->seq.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Compute the current number of elements in the queue.
+        /** This is only an estimate if other threads are using the queue.
+        **/
+        std::size_t size() const {
+            uint_t d = dequeue_pos_.load();
+            uint_t e = enqueue_pos_.load();
+            return e > d ? e - d : 0;
+        }
+
+        /// Check if this queue is empty.
+        bool empty() const {
+            uint_t pos = dequeue_pos_.load();
+            return int_t(buffer_[pos & mask_].seq.load()) - int_t(pos + 1) < 0;
+        }
+
+        /// Maximum number of elements in the queue.
+        std::size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        /// Delete all elements from the queue.
+        /** This method should not be used in concurrent situations
+        **/
+        void clear() {
+            T t;
+            while (pop(t)) {}
+        }
+    };
+
+    /// Thread-safe unbounded FIFO queue.
+    /// Multiple Producers, Multiple Consumers (MPMC).
+    /** The queue is a linked list of bounded mpmc_queue segments. Elements are pushed and
+        popped without locks within a segment; a mutex is only taken to link a new segment
+        when the last one is full, and to unlink the first one when it has been emptied.
+        Unlinked segments are kept and reused, so memory is only allocated when the queue
+        grows beyond its largest size so far (and is released when the queue is destroyed).
+    **/
+    template<typename T>
+    class segmented_queue {
+        struct segment {
+            mpmc_queue<T>          ring;
+            std::atomic<segment*>  next;
+            std::atomic<uint_t>    users;
+            std::atomic<uint_t>    writers;
+            std::atomic<bool>      closed;
+
+            explicit segment(uint_t n) : ring(n), next(nullptr), users(0), writers(0),
+                closed(false) {}
+        };
+
+        static const std::size_t cache_line = 64;
+
+        uint_t                                segment_size_;
+        std::mutex                            mutex_;
+        std::vector<std::unique_ptr<segment>> segments_;
+        std::vector<segment*>                 retired_;
+        char                                  pad0_[cache_line];
+        std::atomic<segment*>                 head_;
+        char                                  pad1_[cache_line];
+        std::atomic<segment*>                 tail_;
+        char                                  pad2_[cache_line];
+
+        // Get a reference on the segment pointed to by 'p', preventing its reuse
+        segment* acquire_(const std::atomic<segment*>& p) {
+            while (true) {
+                segment* s = p.load();
+                ++s->users;
+                if (p.load() == s) return s;
+                --s->users;
+            }
+        }
+
+        // Get an empty segment. Must be called with the mutex locked.
+        segment* new_segment_() {
+            for (uint_t i : range(retired_)) {
+                segment* s = retired_[i];
+                if (s->users == 0) {
+                    retired_.erase(retired_.begin() + i);
+                    s->ring.clear();
+                    s->next = nullptr;
+                    s->writers = 0;
+                    s->closed = false;
+                    return s;
+                }
+            }
+
+            segments_.emplace_back(new segment(segment_size_));
+            return segments_.back().get();
+        }
+
+    public :
+        explicit segmented_queue(uint_t segment_size = 1024) : segment_size_(segment_size) {
+            std::lock_guard<std::mutex> l(mutex_);
+            segment* s = new_segment_();
+            head_ = s;
+            tail_ = s;
+        }
+
+        segmented_queue(const segmented_queue& q) = delete;
+        segmented_queue& operator = (const segmented_queue& q) = delete;
+
+        /// Push a new element at the back of the queue.
+        /** Can be called by any thread.
+        **/
+        template<typename U>
+        void push(U&& t) {
+            while (true) {
+                segment* s = acquire_(tail_);
+
+                ++s->writers;
+                bool ok = !s->closed && s->ring.push(std::forward<U>(t));
+                --s->writers;
+
+                if (!ok) {
+                    // Segment is full, link a new one
+                    std::lock_guard<std::mutex> l(mutex_);
+                    if (tail_ == s) {
+                        segment* n = new_segment_();
+                        s->closed = true;
+                        s->next = n;
+                        tail_ = n;
+                    }
+                }
+
+                --s->users;
+                if (ok) return;
+            }
+        }
+
+        /// Pop an element from the front of the queue.
+        /** Can be called by any thread. Returns false if the queue is empty.
+        **/
+        bool pop(T& t) {
+            while (true) {
+                segment* s = acquire_(head_);
+
+                if (s->ring.pop(t)) {
+                    --s->users;
+                    return true;
+                }
+
+                // Once a segment is closed and no producer is writing in it, no element
+                // can be added anymore; if it is empty, move on to the next one
+                bool done = s->closed && s->writers == 0 && s->ring.empty();
+                if (done) {
+                    std::lock_guard<std::mutex> l(mutex_);
+                    if (head_ == s) {
+                        head_ = s->next.load();
+                        retired_.push_back(s);
+                    }
+                }
+
+                --s->users;
+                if (!done) return false;
+            }
+        }
+
+        /// Compute the current number of elements in the queue.
+        /** This is only an estimate if other threads are using the queue.
+        **/
+        std::size_t size() {
+            std::lock_guard<std::mutex> l(mutex_);
+            std::size_t n = 0;
+            for (segment* s = head_; s != nullptr; s = s->next) {
+                n += s->ring.size();
+            }
+
+            return n;
+        }
+
+        /// Check if this queue is empty.
+        bool empty() {
+            segment* s = acquire_(head_);
+            bool e = s->ring.empty() && s->next == nullptr;
+            --s->users;
+            if (!e && s->ring.empty()) {
+                // First segment is empty but there are more segments
+                return size() == 0;
+            }
+
+            return e;
+        }
+
+        /// Delete all elements from the queue.
+        /** This method should not be used in concurrent situations
+        **/
+        void clear() {
+            T t;
+            while (pop(t)) {}
+        }
+    };
 }
 }
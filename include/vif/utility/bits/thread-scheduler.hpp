@@ -0,0 +1,356 @@
+#ifndef VIF_INCLUDING_THREAD_BITS
+#error this file is not meant to be included separately, include "vif/utilty/thread.hpp" instead
+#endif
+
+namespace vif {
+namespace thread {
+    // Work-stealing scheduler for loops over a range of indices, used by parallel_for.
+    //
+    // Each loop ("job") is split into index ranges. Every thread taking part in a job owns a
+    // double-ended queue of ranges: it takes work from the bottom of its own queue, while
+    // idle threads steal from the top of the others' queues, without locks. A thread only
+    // splits its current range in two (pushing the upper half to its queue) when its queue
+    // is empty, so ranges are only cut as finely as needed to keep all threads busy; this
+    // handles loops where the cost of each iteration varies a lot.
+    //
+    // The threads are created once, and reused for all jobs until the end of the program.
+    // The thread that submits a job always takes part in it, so a job can be submitted from
+    // within another job (nested parallelism): the submitting thread will complete the job
+    // alone if no other thread is available. Threads that run out of work in a job help
+    // with jobs submitted after it.
+    //
+    // If the loop body throws, the job is cancelled: the ranges not yet started are dropped,
+    // and the first exception is rethrown by execute() in the submitting thread, once no
+    // thread is running the loop body anymore.
+
+    namespace impl {
+        // Chase-Lev deque of index ranges, with a fixed capacity. Only the owner thread can
+        // push() and pop(), any thread can steal().
+        class range_deque {
+            static const int_t capacity = 64;
+
+            struct slot_t {
+                std::atomic<uint_t> i0, i1;
+            };
+
+            // Keep the indices on separate cache lines, since top_ is written by thieves
+            slot_t slots_[capacity];
+            std::atomic<int_t> top_;
+            char pad_[64];
+            std::atomic<int_t> bottom_;
+
+        public :
+            range_deque() : top_(0), bottom_(0) {}
+            range_deque(const range_deque&) = delete;
+            range_deque& operator = (const range_deque&) = delete;
+
+            bool empty() const {
+                return bottom_.load(std::memory_order_relaxed) <=
+                    top_.load(std::memory_order_relaxed);
+            }
+
+            bool push(uint_t i0, uint_t i1) {
+                int_t b = bottom_.load(std::memory_order_relaxed);
+                int_t t = top_.load(std::memory_order_acquire);
+                if (b - t >= capacity) return false;
+
+                slots_[b % capacity].i0.store(i0, std::memory_order_relaxed);
+                slots_[b % capacity].i1.store(i1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return true;
+            }
+
+            bool pop(uint_t& i0, uint_t& i1) {
+                int_t b = bottom_.load(std::memory_order_relaxed) - 1;
+                bottom_.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int_t t = top_.load(std::memory_order_relaxed);
+
+                if (t > b) {
+                    // Empty
+                    bottom_.store(b + 1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                i0 = slots_[b % capacity].i0.load(std::memory_order_relaxed);
+                i1 = slots_[b % capacity].i1.load(std::memory_order_relaxed);
+                if (t != b) {
+                    return true;
+                }
+
+                // Last element, race against thieves
+                bool ok = top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return ok;
+            }
+
+            bool steal(uint_t& i0, uint_t& i1) {
+                int_t t = top_.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int_t b = bottom_.load(std::memory_order_acquire);
+                if (t >= b) return false;
+
+                i0 = slots_[t % capacity].i0.load(std::memory_order_relaxed);
+                i1 = slots_[t % capacity].i1.load(std::memory_order_relaxed);
+                return top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+            }
+        };
+
+        struct scheduler_job {
+            uint_t id = 0;
+            uint_t nthread = 1;
+            uint_t grain = 1;
+            uint_t nslot = 0;
+            std::atomic<uint_t> remaining;
+            std::atomic<uint_t> running;
+            std::atomic<bool> cancelled;
+            std::unique_ptr<range_deque[]> deques;
+            const std::function<void(uint_t,uint_t)>* run = nullptr;
+
+            std::mutex error_mutex;
+            std::exception_ptr error;
+
+            scheduler_job() : remaining(0), running(0), cancelled(false) {}
+
+            // Mark 'n' indices as done; the count may have been reset by cancel()
+            void done(uint_t n) {
+                uint_t r = remaining.load(std::memory_order_relaxed);
+                while (!remaining.compare_exchange_weak(r, r > n ? r - n : 0,
+                    std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+            }
+
+            // Keep the first exception, and drop all the ranges that are still queued
+            void cancel(std::exception_ptr e) {
+                {
+                    std::lock_guard<std::mutex> l(error_mutex);
+                    if (!error) error = e;
+                }
+
+                cancelled.store(true);
+
+                uint_t i0, i1;
+                for (uint_t k = 0; k < nthread; ++k) {
+                    while (!deques[k].empty()) {
+                        deques[k].steal(i0, i1);
+                    }
+                }
+
+                remaining.store(0, std::memory_order_release);
+            }
+        };
+    }
+
+    class scheduler_t {
+        using job_ptr = std::shared_ptr<impl::scheduler_job>;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<std::thread> threads_;
+        std::vector<job_ptr> jobs_;
+        uint_t next_id_ = 0;
+        std::atomic<uint_t> last_id_;
+
+        // Find a job with id >= min_id that needs more threads, and reserve a slot in it.
+        // Must be called with the mutex locked.
+        job_ptr find_job_(uint_t min_id, uint_t& slot) {
+            for (auto& j : jobs_) {
+                if (j->id >= min_id && j->nslot < j->nthread &&
+                    j->remaining.load(std::memory_order_relaxed) != 0) {
+                    slot = j->nslot++;
+                    return j;
+                }
+            }
+
+            return job_ptr();
+        }
+
+        void loop_() {
+            std::unique_lock<std::mutex> l(mutex_);
+            while (true) {
+                uint_t slot = 0;
+                job_ptr j;
+                cv_.wait(l, [&]() {
+                    j = find_job_(0, slot);
+                    return j != nullptr;
+                });
+
+                l.unlock();
+                participate_(*j, slot, 0, 0, nullptr);
+                j.reset();
+                l.lock();
+            }
+        }
+
+        // Help with a job submitted after job 'id', if any needs more threads
+        bool help_(uint_t id) {
+            if (last_id_.load(std::memory_order_relaxed) <= id) {
+                return false;
+            }
+
+            uint_t slot = 0;
+            job_ptr j;
+            {
+                std::lock_guard<std::mutex> l(mutex_);
+                j = find_job_(id + 1, slot);
+            }
+
+            if (!j) return false;
+
+            participate_(*j, slot, 0, 0, nullptr);
+            return true;
+        }
+
+        // Process the range [i0,i1) of a job, splitting it when our deque is empty
+        void process_(impl::scheduler_job& j, impl::range_deque& own, uint_t i0, uint_t i1,
+            const std::function<void()>* hook) {
+
+            while (i0 < i1) {
+                if (i1 - i0 > j.grain && own.empty()) {
+                    uint_t mid = i0 + (i1 - i0)/2;
+                    if (own.push(mid, i1)) {
+                        i1 = mid;
+                    }
+                }
+
+                // Announce we are running before checking for cancellation, so that
+                // execute() cannot return while we are in run()
+                j.running.fetch_add(1);
+                if (j.cancelled.load()) {
+                    j.running.fetch_sub(1);
+                    return;
+                }
+
+                uint_t e = std::min(i0 + j.grain, i1);
+                try {
+                    (*j.run)(i0, e);
+                } catch (...) {
+                    j.cancel(std::current_exception());
+                }
+
+                j.running.fetch_sub(1);
+                j.done(e - i0);
+                i0 = e;
+
+                if (hook) (*hook)();
+            }
+        }
+
+        bool steal_(impl::scheduler_job& j, uint_t slot, uint_t& i0, uint_t& i1) {
+            for (uint_t k = 1; k < j.nthread; ++k) {
+                if (j.deques[(slot + k) % j.nthread].steal(i0, i1)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void participate_(impl::scheduler_job& j, uint_t slot, uint_t i0, uint_t i1,
+            const std::function<void()>* hook) {
+
+            impl::range_deque& own = j.deques[slot];
+            process_(j, own, i0, i1, hook);
+
+            uint_t idle = 0;
+            while (j.remaining.load(std::memory_order_acquire) != 0) {
+                if (own.pop(i0, i1) || steal_(j, slot, i0, i1)) {
+                    process_(j, own, i0, i1, hook);
+                    idle = 0;
+                } else if (idle % 16 == 0 && help_(j.id)) {
+                    idle = 0;
+                } else {
+                    if (hook) (*hook)();
+                    if (++idle > 64) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+
+    public :
+        scheduler_t() : last_id_(0) {}
+        scheduler_t(const scheduler_t&) = delete;
+        scheduler_t& operator = (const scheduler_t&) = delete;
+
+        // Call run(i0,i1) on sub-ranges of [first,last) with at most 'nthread' threads
+        // (including the calling thread), and with sub-ranges of at most 'grain' indices.
+        // If provided, hook() is called regularly by the calling thread.
+        void execute(uint_t nthread, uint_t first, uint_t last, uint_t grain,
+            const std::function<void(uint_t,uint_t)>& run,
+            const std::function<void()>* hook = nullptr) {
+
+            if (first >= last) return;
+
+            job_ptr j = std::make_shared<impl::scheduler_job>();
+            j->nthread = std::max(nthread, uint_t(1));
+            j->grain = std::max(grain, uint_t(1));
+            j->remaining = last - first;
+            j->deques.reset(new impl::range_deque[j->nthread]);
+            j->run = &run;
+            j->nslot = 1; // slot 0 is ours
+
+            {
+                std::lock_guard<std::mutex> l(mutex_);
+                while (threads_.size() + 1 < j->nthread) {
+                    threads_.emplace_back(&scheduler_t::loop_, this);
+                }
+
+                j->id = ++next_id_;
+                jobs_.push_back(j);
+                last_id_.store(j->id, std::memory_order_relaxed);
+            }
+
+            cv_.notify_all();
+
+            // Unregister the job even if the hook throws, and wait until no thread uses 'run'
+            struct job_guard {
+                scheduler_t& s;
+                job_ptr& j;
+
+                ~job_guard() {
+                    {
+                        std::lock_guard<std::mutex> l(s.mutex_);
+                        s.jobs_.erase(std::find(s.jobs_.begin(), s.jobs_.end(), j));
+                    }
+
+                    while (j->running.load() != 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            };
+
+            {
+                job_guard g{*this, j};
+                try {
+                    participate_(*j, 0, first, last, hook);
+                } catch (...) {
+                    j->cancel(std::current_exception());
+                }
+            }
+
+            // Take the exception out of the job, which workers may still hold
+            std::exception_ptr error;
+            std::swap(error, j->error);
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        // Number of threads in the pool (excluding threads submitting jobs)
+        uint_t size() {
+            std::lock_guard<std::mutex> l(mutex_);
+            return threads_.size();
+        }
+    };
+
+    // The scheduler is never destroyed, so that its threads are never joined during
+    // static destruction.
+    inline scheduler_t& scheduler() {
+        static scheduler_t* s = new scheduler_t();
+        return *s;
+    }
+}
+}
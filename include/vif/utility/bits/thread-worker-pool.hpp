@@ -5,26 +5,133 @@
 namespace vif {
 namespace impl {
 namespace thread_impl {
-    template<typename W, typename T>
-    struct worker_with_workspace {
-        vif::thread::lock_free_queue<T> input;
-        W                               wsp;
+    // Number of unsuccessful attempts at getting new work before an idle worker goes to
+    // sleep. Sleeping workers use no CPU, and are woken up when new work is pushed.
+    static const uint_t worker_spin_count = 4096;
+
+    // Count of work items that have not yet been fully processed, shared by all the workers
+    // of a pool, so that the pool can wait until they are all done.
+    struct pool_sync {
+        std::atomic<uint_t>     pending;
+        std::mutex              mutex;
+        std::condition_variable cv;
+
+        pool_sync() : pending(0) {}
+
+        void add() {
+            ++pending;
+        }
+
+        void done() {
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> l(mutex);
+                cv.notify_all();
+            }
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> l(mutex);
+            cv.wait(l, [this]() { return pending == 0; });
+        }
+    };
+
+    // Push into a queue, waiting for room if the queue is bounded
+    template<typename Q, typename U>
+    void queue_push_(Q& q, U&& t, std::true_type) {
+        while (!q.push(std::forward<U>(t))) {
+            std::this_thread::yield();
+        }
+    }
+
+    template<typename Q, typename U>
+    void queue_push_(Q& q, U&& t, std::false_type) {
+        q.push(std::forward<U>(t));
+    }
+
+    template<typename Q, typename U>
+    void queue_push(Q& q, U&& t) {
+        queue_push_(q, std::forward<U>(t),
+            std::is_same<decltype(q.push(std::forward<U>(t))), bool>{});
+    }
+
+    template<typename T, typename Q>
+    struct worker_base {
+        Q                               input;
         std::atomic<bool>               shutdown;
-        std::thread                     impl;
+        std::atomic<bool>               sleeping;
+        std::atomic<uint_t>             load;
+        std::mutex                      mutex;
+        std::condition_variable         cv;
+        std::shared_ptr<pool_sync>      sync;
 
-        template<typename F, typename ... Args>
-        explicit worker_with_workspace(const F& f, const Args&... args) : wsp(args...),
-            shutdown(false), impl([this,f]() {
+        explicit worker_base(std::shared_ptr<pool_sync> s) : shutdown(false), sleeping(false),
+            load(0), sync(std::move(s)) {}
+
+        // Called by the producer thread(s) only
+        void push(T t) {
+            ++load;
+            queue_push(input, std::move(t));
+
+            // Both 'sleeping' and the queue are read and written with sequential
+            // consistency, so either we see the worker sleeping, or it sees the new item
+            if (sleeping) {
+                std::lock_guard<std::mutex> l(mutex);
+                cv.notify_one();
+            }
+        }
+
+        void stop() {
+            shutdown = true;
+            std::lock_guard<std::mutex> l(mutex);
+            cv.notify_one();
+        }
+
+        uint_t workload() const {
+            return load;
+        }
 
+        // Process items until shutdown, then process the items that are left
+        template<typename F>
+        void run_(const F& f) {
             T t;
-            while (!shutdown) {
-                while (input.pop(t)) {
-                    f(wsp, t);
+            uint_t idle = 0;
+            while (true) {
+                if (input.pop(t)) {
+                    f(t);
+                    --load;
+                    sync->done();
+                    idle = 0;
+                } else if (shutdown) {
+                    if (input.empty()) break;
+                } else if (++idle < worker_spin_count) {
+                    if (idle % 64 == 0) std::this_thread::yield();
+                } else {
+                    std::unique_lock<std::mutex> l(mutex);
+                    sleeping = true;
+                    cv.wait(l, [this]() { return !input.empty() || shutdown; });
+                    sleeping = false;
+                    idle = 0;
                 }
             }
+        }
+    };
+
+    template<typename W, typename T, typename Q>
+    struct worker_with_workspace : worker_base<T,Q> {
+        W           wsp;
+        std::thread impl;
+
+        template<typename F, typename ... Args>
+        explicit worker_with_workspace(std::shared_ptr<pool_sync> s, const F& f, const Args&... args) :
+            worker_base<T,Q>(std::move(s)), wsp(args...), impl([this,f]() {
+
+            this->run_([this,&f](T& t) {
+                f(wsp, t);
+            });
         }) {}
 
         ~worker_with_workspace() {
+            this->stop();
             join();
         }
 
@@ -33,31 +140,21 @@ namespace thread_impl {
                 impl.join();
             }
         }
-
-        uint_t workload() const {
-            return input.size();
-        }
     };
 
-    template<typename T>
-    struct worker_no_workspace {
-        vif::thread::lock_free_queue<T> input;
-        std::atomic<bool>               shutdown;
-        std::thread                     impl;
+    template<typename T, typename Q>
+    struct worker_no_workspace : worker_base<T,Q> {
+        std::thread impl;
 
         template<typename F>
-        explicit worker_no_workspace(const F& f) : shutdown(false),
-            impl([this,f]() {
+        explicit worker_no_workspace(std::shared_ptr<pool_sync> s, const F& f) :
+            worker_base<T,Q>(std::move(s)), impl([this,f]() {
 
-            T t;
-            while (!shutdown) {
-                while (input.pop(t)) {
-                    f(t);
-                }
-            }
+            this->run_(f);
         }) {}
 
         ~worker_no_workspace() {
+            this->stop();
             join();
         }
 
@@ -66,10 +163,6 @@ namespace thread_impl {
                 impl.join();
             }
         }
-
-        uint_t workload() const {
-            return input.size();
-        }
     };
 }
 }
@@ -77,20 +170,28 @@ namespace thread_impl {
 
 namespace vif {
 namespace thread {
-    template<typename T, typename W = void>
+    // Pool of threads processing items of type T with the function given to start(). Items
+    // are sent to the workers with process(). Idle workers sleep until new items arrive.
+    //
+    // Each worker reads its items from a queue of type Q. With the default lock_free_queue,
+    // process() must always be called from the same thread. With mpmc_queue (bounded: the
+    // caller waits when the queue of a worker is full) or segmented_queue (unbounded),
+    // process() can be called from several threads at once.
+    template<typename T, typename W = void, typename Q = lock_free_queue<T>>
     struct worker_pool {
         using worker = typename std::conditional<std::is_same<W, void>::value,
-            impl::thread_impl::worker_no_workspace<T>,
-            impl::thread_impl::worker_with_workspace<W,T>
+            impl::thread_impl::worker_no_workspace<T,Q>,
+            impl::thread_impl::worker_with_workspace<W,T,Q>
         >::type;
 
         std::vector<std::unique_ptr<worker>> workers;
-        uint_t last_push = 0;
+        std::shared_ptr<impl::thread_impl::pool_sync> sync;
+        std::atomic<uint_t> last_push;
 
-        worker_pool() = default;
+        worker_pool() : last_push(0) {}
 
         template<typename F, typename ... Args>
-        explicit worker_pool(uint_t nthread, const F& f, const Args&... args) {
+        explicit worker_pool(uint_t nthread, const F& f, const Args&... args) : last_push(0) {
             start(nthread, f, args...);
         }
 
@@ -101,17 +202,19 @@ namespace thread {
         template<typename F, typename ... Args>
         void start(uint_t nthread, const F& f, const Args&... args) {
             workers.clear();
+            sync = std::make_shared<impl::thread_impl::pool_sync>();
             workers.reserve(nthread);
             for (uint_t i = 0; i < nthread; ++i) {
-                workers.emplace_back(new worker(f, args...));
+                workers.emplace_back(new worker(sync, f, args...));
             }
 
             last_push = workers.size()-1;
         }
 
+        // Stop all workers, after they have processed the items they were given
         void join() {
             for (uint_t i : range(workers)) {
-                workers[i]->shutdown = true;
+                workers[i]->stop();
             }
 
             for (uint_t i : range(workers)) {
@@ -119,31 +222,36 @@ namespace thread {
             }
         }
 
+        // Give an item to the least loaded worker. Ties are broken in round-robin order.
         void process(T t) {
-            ++last_push;
-            if (last_push >= workers.size()) {
-                last_push = 0;
+            const uint_t n = workers.size();
+            const uint_t start = last_push.load(std::memory_order_relaxed);
+            uint_t best = npos;
+            uint_t best_load = npos;
+            for (uint_t k = 1; k <= n; ++k) {
+                uint_t i = (start + k) % n;
+                uint_t l = workers[i]->workload();
+                if (l < best_load) {
+                    best = i;
+                    best_load = l;
+                    if (l == 0) break;
+                }
             }
 
-            workers[last_push]->input.push(std::move(t));
+            last_push.store(best, std::memory_order_relaxed);
+            process(best, std::move(t));
         }
 
+        // Give an item to a specific worker
         void process(uint_t i, T t) {
-            workers[i]->input.push(std::move(t));
+            sync->add();
+            workers[i]->push(std::move(t));
         }
 
+        // Wait until all the items given to the workers have been processed
         void consume_all() {
-            bool finished = false;
-            while (!finished) {
-                finished = true;
-                for (uint_t i : range(workers)) {
-                    if (workers[i]->workload() > 0) {
-                        finished = false;
-                        break;
-                    }
-                }
-
-                sleep_for(1e-6);
+            if (sync) {
+                sync->wait();
             }
         }
 
@@ -151,13 +259,9 @@ namespace thread {
             return workers.size();
         }
 
+        // Number of items which have not yet been fully processed
         uint_t remaining() const {
-            uint_t nleft = 0;
-            for (uint_t i : range(workers)) {
-                nleft += workers[i]->workload();
-            }
-
-            return nleft;
+            return sync ? uint_t(sync->pending) : 0;
         }
     };
 }
@@ -4,8 +4,12 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
 #include <functional>
+#include <exception>
 #include "vif/core/vec.hpp"
+#include "vif/utility/time.hpp"
 
 #define VIF_INCLUDING_THREAD_BITS
 #include "vif/utility/bits/thread-thread.hpp"
@@ -13,6 +17,7 @@
 #include "vif/utility/bits/thread-queue.hpp"
 #include "vif/utility/bits/thread-worker.hpp"
 #include "vif/utility/bits/thread-worker-pool.hpp"
+#include "vif/utility/bits/thread-scheduler.hpp"
 #include "vif/utility/bits/thread-parallel-for.hpp"
 #undef VIF_INCLUDING_THREAD_BITS
 
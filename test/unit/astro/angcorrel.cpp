@@ -0,0 +1,98 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+using namespace vif::astro;
+
+// Reference implementation: brute force pair counting
+vec1d brute_angcorrel(const vec1d& ra, const vec1d& dec, const vec1d& rra, const vec1d& rdec,
+    const vec2d& bins) {
+
+    uint_t nbin = bins.dims[1];
+    vec1d dd(nbin), dr(nbin), rr(nbin);
+    for (uint_t i : range(ra)) {
+        dd += histogram(angdist(ra, dec, ra[i], dec[i]), bins);
+        dr += histogram(angdist(rra, rdec, ra[i], dec[i]), bins);
+    }
+
+    for (uint_t i : range(rra)) {
+        rr += histogram(angdist(rra, rdec, rra[i], rdec[i]), bins);
+    }
+
+    double norm1 = rra.size()/double(ra.size());
+    double norm2 = norm1*((rra.size() - 1.0)/(ra.size() - 1.0));
+    return ((dd*norm2 - dr*norm1) + (rr - dr*norm1))/rr;
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+
+    // Clustered data around a few centers, crossing RA = 0
+    vec1d ra = randomu(seed, 1500)*0.4 - 0.2;
+    vec1d dec = randomu(seed, 1500)*0.4 + 30.0;
+    for (uint_t i : range(500)) {
+        ra[i] = ra[i % 10]*1.0 + randomn(seed)*0.005;
+        dec[i] = dec[i % 10] + randomn(seed)*0.005;
+    }
+
+    ra[ra < 0.0] += 360.0;
+
+    vec1d rra = randomu(seed, 3000)*0.4 - 0.2;
+    vec1d rdec = randomu(seed, 3000)*0.4 + 30.0;
+    rra[rra < 0.0] += 360.0;
+
+    vec2d bins = e10(make_bins(log10(2.0), log10(300.0), 8));
+
+    {
+        print("test_angcorrel...");
+
+        vec1d ref = brute_angcorrel(ra, dec, rra, rdec, bins);
+        vec1d w = angcorrel(ra, dec, rra, rdec, bins);
+        check(max(abs(w - ref)) < 1e-9, true);
+
+        angcorrel_params p;
+        p.thread = 4;
+        angcorrel_res r = angcorrel(ra, dec, rra, rdec, bins, p);
+        check(r.w, w);
+        check(total(r.dd) > 0u, true);
+
+        // Bins that include zero separation and overlapping bins
+        vec2d obins = {{0.0, 100.0, 50.0}, {100.0, 600.0, 200.0}};
+        ref = brute_angcorrel(ra, dec, rra, rdec, obins);
+        w = angcorrel(ra, dec, rra, rdec, obins);
+        check(max(abs(w - ref)) < 1e-9, true);
+    }
+
+    {
+        print("test_angcorrel_jackknife...");
+
+        angcorrel_params p;
+        p.jackknife = 10;
+        p.thread = 3;
+        angcorrel_res r = angcorrel(ra, dec, rra, rdec, bins, p);
+        check(r.w_jack.dims[0], 10u);
+        check(r.w_jack.dims[1], bins.dims[1]);
+        check(r.w_err.size(), bins.dims[1]);
+        check(count(is_finite(r.w_err)), bins.dims[1]);
+        check(max(abs(r.w - angcorrel(ra, dec, rra, rdec, bins))) < 1e-9, true);
+
+        // Same result with a single thread
+        p.thread = 1;
+        angcorrel_res r1 = angcorrel(ra, dec, rra, rdec, bins, p);
+        check(r1.w_jack, r.w_jack);
+
+        // Removing one region should only change the estimate slightly
+        check(max(abs(r.w_jack - replicate(r.w, 10))) < 0.5*max(abs(r.w)), true);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+using namespace vif::astro;
+
+namespace simd = vif::impl::simd_impl;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    vec2d map = randomn(seed, 61, 47);
+    vec2d small = randomn(seed, 5, 3);
+
+    {
+        print("test_separate_kernel...");
+
+        vec1d u, v;
+        check(impl::astro_impl::separate_kernel(gaussian_profile({{7,5}}, 1.5), u, v), true);
+        check(u.size(), 7u);
+        check(v.size(), 5u);
+
+        vec2d k = randomu(seed, 5, 5);
+        check(impl::astro_impl::separate_kernel(k, u, v), false);
+        check(impl::astro_impl::separate_kernel(vec2d(3,3), u, v), false);
+    }
+
+    simd::isa best = simd::active_isa();
+    for (simd::isa i : {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2, simd::isa::avx512}) {
+        if (i > simd::detect_isa()) continue;
+
+        print("test_convolve2d_direct_", uint_t(i), "...");
+        simd::active_isa() = i;
+
+        for (auto kdims : {std::array<uint_t,2>{{5,5}}, std::array<uint_t,2>{{7,3}},
+            std::array<uint_t,2>{{1,1}}, std::array<uint_t,2>{{11,9}}}) {
+
+            // Generic kernel
+            vec2d k = randomu(seed, kdims[0], kdims[1]);
+            vec2d ref = convolve2d_naive(map, k);
+            check(max(abs(convolve2d(map, k, convolve2d_method::direct) - ref)) < 1e-12, true);
+            check(max(abs(convolve2d(map, k) - ref)) < 1e-9, true);
+
+            // Kernel larger than the map
+            ref = convolve2d_naive(small, k);
+            check(max(abs(convolve2d(small, k, convolve2d_method::direct) - ref)) < 1e-12, true);
+
+            // Separable kernels
+            vec2d g = gaussian_profile(kdims, 1.5);
+            ref = convolve2d_naive(map, g);
+            check(max(abs(convolve2d(map, g, convolve2d_method::separable) - ref)) < 1e-12, true);
+            check(max(abs(convolve2d(map, g) - ref)) < 1e-9, true);
+
+            vec1d kx = randomu(seed, kdims[0]), ky = randomu(seed, kdims[1]);
+            vec2d ks(kdims);
+            for (uint_t x : range(kx))
+            for (uint_t y : range(ky)) {
+                ks(x,y) = kx[x]*ky[y];
+            }
+
+            ref = convolve2d_naive(map, ks);
+            check(max(abs(convolve2d_separable(map, kx, ky) - ref)) < 1e-12, true);
+
+            // Single precision map
+            vec2f mapf = map;
+            vec2f kf = k;
+            check(max(abs(convolve2d(mapf, kf, convolve2d_method::direct) -
+                convolve2d_naive(mapf, kf))) < 1e-4, true);
+        }
+    }
+
+    simd::active_isa() = best;
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
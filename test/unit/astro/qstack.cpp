@@ -0,0 +1,107 @@
+#include <vif.hpp>
+#include <vif/astro/qstack.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+using namespace vif::astro;
+
+template<typename S>
+void write_image(const std::string& file, const vec<2,S>& v, const fits::header& hdr,
+    double bscale, double bzero) {
+
+    fits::output_image oimg(file);
+    oimg.write(v);
+    oimg.write_header(hdr);
+    if (bscale != 1.0 || bzero != 0.0) {
+        oimg.write_keyword("BSCALE", bscale);
+        oimg.write_keyword("BZERO", bzero);
+    }
+}
+
+// The cutouts must be the same as those extracted from the image read with input_image::read()
+template<typename T>
+void check_qstack(const std::string& file, const vec1d& x, const vec1d& y, uint_t hsize) {
+    print("  ", file, " as ", pretty_type_t(T));
+
+    vec<2,T> img;
+    fits::input_image iimg(file);
+    iimg.read(img);
+
+    fits::header hdr = iimg.read_header();
+    astro::wcs w(hdr);
+    vec1d ra, dec;
+    xy2ad(w, x, y, ra, dec);
+
+    qstack_params p;
+    p.keep_nan = true;
+
+    vec<3,T> cube;
+    vec1u ids;
+    qstack(ra, dec, file, hsize, cube, ids, p);
+    check(ids, indgen<uint_t>(x.size()));
+
+    const int_t csize = 2*hsize+1;
+    bool same = true;
+    for (uint_t k : range(ids)) {
+        // FITS pixels start at 1
+        const int_t x0 = round(x[ids[k]]) - 1 - hsize;
+        const int_t y0 = round(y[ids[k]]) - 1 - hsize;
+
+        for (int_t iy : range(csize))
+        for (int_t ix : range(csize)) {
+            const int_t tx = x0 + ix, ty = y0 + iy;
+            T expected = fnan;
+            if (tx >= 0 && ty >= 0 && tx < int_t(img.dims[1]) && ty < int_t(img.dims[0])) {
+                expected = img.safe(ty,tx);
+            }
+
+            same = same && is_same(cube.safe(k,iy,ix), expected);
+        }
+    }
+
+    check(same, true);
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    make_wcs_header_params wp;
+    wp.pixel_scale = 0.2;
+    wp.dims_x = 53; wp.dims_y = 37;
+    wp.sky_ref_ra = 150.1; wp.sky_ref_dec = 2.2;
+    wp.pixel_ref_x = 27; wp.pixel_ref_y = 19;
+    fits::header hdr;
+    make_wcs_header(wp, hdr);
+
+    auto seed = make_seed(42);
+    vec2d d = randomn(seed, 37, 53);
+    vec<2,short> s = vec<2,short>{randomi(seed, -3000, 3000, 37, 53)};
+
+    write_image("unit_qstack_f.fits", vec2f{d}, hdr, 1.0, 0.0);
+    write_image("unit_qstack_s.fits", s, hdr, 0.5, 100.0);
+
+    // Sources inside the image and on its edges (FITS pixel coordinates)
+    vec1d x = {20.0, 3.0, 51.0, 10.0, 53.0};
+    vec1d y = {15.0, 4.0, 35.0, 30.0, 1.0};
+
+    {
+        print("test_qstack_mapped...");
+
+        // Big endian images, mapped and swapped on little endian machines
+        check_qstack<float>("unit_qstack_f.fits", x, y, 5);
+        check_qstack<double>("unit_qstack_f.fits", x, y, 5);
+
+        // Scaled 16 bit integers
+        check_qstack<float>("unit_qstack_s.fits", x, y, 5);
+        check_qstack<double>("unit_qstack_s.fits", x, y, 7);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+#include <vif.hpp>
+#include <vif/astro/qxmatch.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+using namespace vif::astro;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    vec1d ra1 = randomu(seed, 3000)*0.5 + 150.0;
+    vec1d dec1 = randomu(seed, 3000)*0.5 + 2.0;
+    vec1d ra2 = randomu(seed, 2000)*0.5 + 150.0;
+    vec1d dec2 = randomu(seed, 2000)*0.5 + 2.0;
+
+    {
+        print("test_qxmatch...");
+
+        qxmatch_params p;
+        p.nth = 3;
+        qxmatch_res r = qxmatch(ra1, dec1, ra2, dec2, p);
+        check(r.id.dims[0], 3u);
+        check(r.id.dims[1], 3000u);
+        check(r.rid.size(), 2000u);
+
+        // Compare to the brute force algorithm
+        p.brute_force = true;
+        qxmatch_res rb = qxmatch(ra1, dec1, ra2, dec2, p);
+        check(r.id, rb.id);
+        check(r.rid, rb.rid);
+        check(max(abs(r.d - rb.d)) < 1e-6, true);
+        check(max(abs(r.rd - rb.rd)) < 1e-6, true);
+
+        // The nearest neighbor has the smallest distance
+        uint_t i = 17;
+        vec1d d = angdist(ra2, dec2, ra1[i], dec1[i]);
+        check(r.id(0,i), min_id(d));
+        check(abs(r.d(0,i) - min(d)) < 1e-6, true);
+    }
+
+    {
+        print("test_qxmatch_thread...");
+
+        for (bool brute : {false, true}) {
+            qxmatch_params p;
+            p.nth = 2;
+            p.brute_force = brute;
+            qxmatch_res r1 = qxmatch(ra1, dec1, ra2, dec2, p);
+
+            p.thread = 4;
+            qxmatch_res r4 = qxmatch(ra1, dec1, ra2, dec2, p);
+            check(r4.id, r1.id);
+            check(r4.d, r1.d);
+            check(r4.rid, r1.rid);
+            check(r4.rd, r1.rd);
+
+            // Self match
+            p.thread = 1;
+            r1 = qxmatch(ra1, dec1, p);
+            p.thread = 3;
+            r4 = qxmatch(ra1, dec1, p);
+            check(r4.id, r1.id);
+            check(r4.d, r1.d);
+            check(count(r1.id(0,_) == indgen<uint_t>(ra1.size())), 0u);
+        }
+    }
+
+    {
+        print("test_qxmatch_allsky...");
+
+        // Full sky, including the poles and both sides of RA = 0
+        vec1d sra1 = randomu(seed, 2000)*360.0;
+        vec1d sdec1 = asin(randomu(seed, 2000)*2.0 - 1.0)*180.0/dpi;
+        vec1d sra2 = randomu(seed, 1500)*360.0;
+        vec1d sdec2 = asin(randomu(seed, 1500)*2.0 - 1.0)*180.0/dpi;
+        sdec1[0] = 90.0;    sra1[0] = 10.0;
+        sdec1[1] = -89.99;  sra1[1] = 200.0;
+        sra1[2] = 359.999;  sdec1[2] = 0.0;
+        sra2[0] = 0.0005;   sdec2[0] = 0.0;
+        sra2[1] = 120.0;    sdec2[1] = -89.995;
+
+        qxmatch_params p;
+        p.nth = 2;
+        p.thread = 2;
+        qxmatch_res r = qxmatch(sra1, sdec1, sra2, sdec2, p);
+        p.brute_force = true;
+        qxmatch_res rb = qxmatch(sra1, sdec1, sra2, sdec2, p);
+        check(r.id, rb.id);
+        check(r.rid, rb.rid);
+        check(r.id(0,2), 0u);
+        check(r.id(0,1), 1u);
+
+        // Sparse fields far apart
+        vec1d fra = randomu(seed, 1000)*0.1, fdec = randomu(seed, 1000)*0.1;
+        fra[_-499] += 120.0;
+        fdec[_-499] += 60.0;
+        p.brute_force = false;
+        r = qxmatch(fra, fdec, p);
+        p.brute_force = true;
+        rb = qxmatch(fra, fdec, p);
+        check(r.id, rb.id);
+    }
+
+    {
+        print("test_qxmatch_linear...");
+
+        vec1d x1 = randomu(seed, 1000)*100.0, y1 = randomu(seed, 1000)*20.0;
+        vec1d x2 = randomu(seed, 800)*100.0,  y2 = randomu(seed, 800)*20.0;
+
+        qxmatch_params p;
+        p.linear = true;
+        p.nth = 3;
+        qxmatch_res r = qxmatch(x1, y1, x2, y2, p);
+        p.brute_force = true;
+        qxmatch_res rb = qxmatch(x1, y1, x2, y2, p);
+        check(r.id, rb.id);
+        check(r.rid, rb.rid);
+        check(max(abs(r.d - rb.d)) < 1e-9, true);
+    }
+
+    {
+        print("test_qxmatch_index...");
+
+        qxmatch_index idx(ra2, dec2);
+        check(idx.size(), 2000u);
+        check(idx.linear(), false);
+
+        qxmatch_params p;
+        p.nth = 3;
+        p.thread = 2;
+        qxmatch_res r = qxmatch(ra1, dec1, ra2, dec2, p);
+        qxmatch_res ri = idx.match(ra1, dec1, p);
+        check(ri.id, r.id);
+        check(ri.d, r.d);
+        check(ri.rid.empty(), true);
+
+        // Same results when queried from several threads at once
+        std::vector<qxmatch_res> rt(3);
+        std::vector<std::thread> threads;
+        for (uint_t t : range(rt)) {
+            threads.emplace_back([&,t]() {
+                qxmatch_params tp;
+                tp.nth = 3;
+                rt[t] = idx.match(ra1, dec1, tp);
+            });
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        for (auto& tr : rt) {
+            check(tr.id, r.id);
+        }
+
+        // Save and memory map
+        std::string file = "qxmatch_index_test.bin";
+        idx.save(file);
+        qxmatch_index idx2(file);
+        check(idx2.size(), idx.size());
+        ri = idx2.match(ra1, dec1, p);
+        check(ri.id, r.id);
+        check(ri.d, r.d);
+        idx2 = qxmatch_index();
+        file::remove(file);
+    }
+
+    {
+        print("test_qxmatch_index_radius...");
+
+        qxmatch_index idx(ra2, dec2);
+        qxmatch_params p;
+        p.thread = 3;
+        qxmatch_sparse_res r = idx.match_radius(ra1, dec1, 30.0, p);
+        check(r.offset.size(), ra1.size()+1);
+        check(r.id.size(), r.offset.back());
+
+        bool same = true, sorted = true;
+        for (uint_t i : range(ra1)) {
+            vec1d d = angdist(ra2, dec2, ra1[i], dec1[i]);
+            vec1u ids = where(d <= 30.0);
+            vec1u rids;
+            vec1d rd;
+            for (uint_t k = r.offset[i]; k < r.offset[i+1]; ++k) {
+                rids.push_back(r.id[k]);
+                rd.push_back(r.d[k]);
+            }
+
+            if (!std::is_sorted(rd.begin(), rd.end())) sorted = false;
+            inplace_sort(rids);
+            if (rids.size() != ids.size() || count(rids != ids) != 0) same = false;
+        }
+
+        check(same, true);
+        check(sorted, true);
+
+        // Self match in linear mode
+        vec1d x = randomu(seed, 500)*10.0, y = randomu(seed, 500)*10.0;
+        qxmatch_index lidx(x, y, true);
+        p.self = true;
+        r = lidx.match_radius(x, y, 0.5, p);
+        uint_t nexp = 0;
+        for (uint_t i : range(x)) {
+            nexp += count(sqr(x - x[i]) + sqr(y - y[i]) <= 0.25) - 1;
+        }
+
+        check(r.id.size(), nexp);
+    }
+
+    {
+        print("test_qxmatch_radius...");
+
+        qxmatch_params p;
+        p.thread = 2;
+        qxmatch_sparse_res r = qxmatch_radius(ra1, dec1, ra2, dec2, 20.0, p);
+        p.brute_force = true;
+        qxmatch_sparse_res rb = qxmatch_radius(ra1, dec1, ra2, dec2, 20.0, p);
+        check(r.offset, rb.offset);
+        check(r.id, rb.id);
+        check(r.d, rb.d);
+        check(count(r.d > 20.0), 0u);
+
+        // The first match is the nearest neighbor, when it is close enough
+        qxmatch_res rn = qxmatch(ra1, dec1, ra2, dec2);
+        vec1u idm = where(rn.d(0,_) <= 20.0);
+        check(r.id[r.offset[idm]], rn.id(0,idm));
+        check(count(r.offset[idm+1] == r.offset[idm]), 0u);
+
+        // Self match
+        p.brute_force = false;
+        r = qxmatch_radius(ra1, dec1, 20.0, p);
+        p.brute_force = true;
+        rb = qxmatch_radius(ra1, dec1, 20.0, p);
+        check(r.offset, rb.offset);
+        check(r.id, rb.id);
+
+        // No match
+        r = qxmatch_radius(ra1, dec1, ra2 + 10.0, dec2, 20.0);
+        check(r.offset, replicate(0u, ra1.size()+1));
+        check(r.id.empty(), true);
+    }
+
+    {
+        print("test_qdist...");
+
+        vec1d ra = ra1[_-499], dec = dec1[_-499];
+        const uint_t n = ra.size();
+
+        qdist_params p;
+        vec2d d = qdist(ra, dec, p);
+        check(d(7,3), angdist(ra[3], dec[3], ra[7], dec[7]));
+        check(d(3,7), 0.0);
+
+        p.thread = 3;
+        check(qdist(ra, dec, p), d);
+
+        vec1d dc = qdist_condensed(ra, dec, p);
+        check(dc.size(), n*(n-1)/2);
+        check(dc[qdist_condensed_index(n, 3, 7)], d(7,3));
+        check(dc[qdist_condensed_index(n, n-2, n-1)], d(n-1,n-2));
+        vec1d dl;
+        for (uint_t i : range(n-1)) {
+            append(dl, d(i+1-_,i));
+        }
+
+        check(dc, dl);
+
+        // Only close pairs
+        qxmatch_sparse_res r = qdist_radius(ra, dec, 60.0, p);
+        check(r.offset.size(), n+1);
+        check(r.id.size(), count(dc <= 60.0));
+        bool same = true;
+        for (uint_t i : range(n)) {
+            for (uint_t k = r.offset[i]; k < r.offset[i+1]; ++k) {
+                if (r.id[k] <= i || abs(r.d[k] - d(r.id[k],i)) > 1e-6) same = false;
+            }
+        }
+
+        check(same, true);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+using namespace vif::astro;
+
+// Same values, or both NaN, within an absolute tolerance
+bool same_within(const vec2d& a, const vec2d& b, double tol) {
+    if (a.dims != b.dims) return false;
+    for (uint_t i : range(a)) {
+        if (std::isnan(a.safe[i]) && std::isnan(b.safe[i])) continue;
+        if (!(std::abs(a.safe[i] - b.safe[i]) <= tol)) return false;
+    }
+
+    return true;
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    make_wcs_header_params ps;
+    ps.pixel_scale = 0.2;
+    ps.dims_x = 230; ps.dims_y = 170;
+    ps.sky_ref_ra = 150.1; ps.sky_ref_dec = 2.2;
+    ps.pixel_ref_x = 115; ps.pixel_ref_y = 85;
+    fits::header hs;
+    make_wcs_header(ps, hs);
+    astro::wcs ws(hs);
+
+    make_wcs_header_params pd = ps;
+    pd.pixel_scale = 0.27;
+    pd.dims_x = 190; pd.dims_y = 140;
+    pd.sky_ref_ra = 150.1 + 2/3600.0; pd.sky_ref_dec = 2.2 - 3/3600.0;
+    pd.pixel_ref_x = 90.3; pd.pixel_ref_y = 66.7;
+    fits::header hd;
+    make_wcs_header(pd, hd);
+    astro::wcs wd(hd);
+
+    auto seed = make_seed(42);
+    vec2d img = randomn(seed, 170, 230);
+
+    for (bool lin : {false, true}) {
+        print("test_regrid_interpolate", lin ? "_linearize" : "", "...");
+
+        regrid_interpolate_params ip;
+        ip.linearize = lin;
+        ip.conserve_flux = true;
+        for (auto m : {interpolation_method::nearest, interpolation_method::linear,
+            interpolation_method::cubic}) {
+            ip.method = m;
+            ip.thread = 1;
+            vec2d r1 = regrid_interpolate(img, ws, wd, ip);
+            ip.thread = 3;
+            vec2d r3 = regrid_interpolate(img, ws, wd, ip);
+
+            // Each pixel is computed independently: threads must not change the result
+            check(same_within(r1, r3, 0.0), true);
+        }
+
+        print("test_regrid_drizzle", lin ? "_linearize" : "", "...");
+
+        for (double pf : {1.0, 0.6}) {
+            regrid_drizzle_params dp;
+            dp.linearize = lin;
+            dp.pixfrac = pf;
+
+            vec2d w1, w3, w3b;
+            dp.thread = 1;
+            vec2d r1 = regrid_drizzle(img, ws, wd, w1, dp);
+            dp.thread = 3;
+            vec2d r3 = regrid_drizzle(img, ws, wd, w3, dp);
+            vec2d r3b = regrid_drizzle(img, ws, wd, w3b, dp);
+
+            // Bands are summed separately: only round-off errors are allowed
+            check(same_within(r1, r3, 1e-10), true);
+            check(same_within(w1, w3, 1e-10), true);
+
+            // ... but the result must not depend on the order in which bands are finished
+            check(same_within(r3, r3b, 0.0), true);
+            check(same_within(w3, w3b, 0.0), true);
+
+            // Small to large grid
+            dp.thread = 1;
+            r1 = regrid_drizzle(img(_-139,_-189), wd, ws, w1, dp);
+            dp.thread = 3;
+            r3 = regrid_drizzle(img(_-139,_-189), wd, ws, w3, dp);
+            check(same_within(r1, r3, 1e-10), true);
+            check(same_within(w1, w3, 1e-10), true);
+        }
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
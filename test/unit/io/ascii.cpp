@@ -0,0 +1,344 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+#include <clocale>
+
+using namespace vif;
+
+// The fast parser must agree with from_string(), in success and in value
+template<typename T>
+bool same_as_from_string(const std::string& s) {
+    T v1 = 0, v2 = 0;
+    bool ok1 = impl::ascii_impl::parse_value(s.data(), s.data() + s.size(), v1);
+    bool ok2 = from_string(s, v2);
+    if (ok1 != ok2) return false;
+    if (!ok1) return true;
+    return v1 == v2 || (std::isnan(double(v1)) && std::isnan(double(v2)));
+}
+
+void write_file(const std::string& file, const std::string& content) {
+    std::ofstream out(file, std::ios::binary);
+    out << content;
+}
+
+// Switch LC_NUMERIC to a locale using ',' as decimal point, if one is installed
+bool set_comma_locale() {
+    for (const char* l : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR"}) {
+        if (std::setlocale(LC_NUMERIC, l) && std::string(std::localeconv()->decimal_point) == ",") {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    {
+        print("test_parse_value...");
+
+        vec1s strs = {"0", "-0", "12", "+12", "-12", " 42 ", "1.5", "-.5", "5.", "1e5",
+            "1E-05", "-2.5e+3", "3.14159265358979323846", "123456789012345678901234",
+            "1e22", "1e23", "1e-22", "4.9e-324", "1.7976931348623157e308", "1e400",
+            "nan", "NaN", "-inf", "INF", "", "-", ".", "1e", "1.5.2", "0x10", "1a", "abc",
+            "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+            "-9223372036854775809", "18446744073709551615", "18446744073709551616",
+            "2147483647", "2147483648", "-2147483648", "0.1", "0.30000000000000004",
+            "1234567.125", "1e-45", "3.4028235e38", "3.5e38", "000123", "-0.0"};
+
+        bool ok_d = true, ok_f = true, ok_i = true, ok_u = true, ok_i32 = true;
+        for (auto& s : strs) {
+            if (!same_as_from_string<double>(s)) { ok_d = false; print("double: ", s); }
+            if (!same_as_from_string<float>(s))  { ok_f = false; print("float: ", s); }
+            if (!same_as_from_string<int_t>(s))  { ok_i = false; print("int_t: ", s); }
+            if (!same_as_from_string<uint_t>(s)) { ok_u = false; print("uint_t: ", s); }
+            if (!same_as_from_string<int>(s))    { ok_i32 = false; print("int: ", s); }
+        }
+
+        check(ok_d, true);
+        check(ok_f, true);
+        check(ok_i, true);
+        check(ok_u, true);
+        check(ok_i32, true);
+
+        // Random values in various formats
+        auto seed = make_seed(42);
+        vec1d v = randomn(seed, 20000)*pow(10.0, randomu(seed, 20000)*40.0 - 20.0);
+        bool ok = true;
+        char buf[64];
+        for (uint_t i : range(v)) {
+            for (const char* fmt : {"%.17g", "%.6g", "%.3f", "%e", "%.10E"}) {
+                std::snprintf(buf, sizeof(buf), fmt, v[i]);
+                if (!same_as_from_string<double>(buf) || !same_as_from_string<float>(buf)) {
+                    ok = false;
+                }
+            }
+        }
+
+        check(ok, true);
+    }
+
+    std::string file = "ascii_test.dat";
+
+    {
+        print("test_read_table...");
+
+        write_file(file,
+            "# id  x    y   name\n"
+            "\n"
+            "   0  10   20  a\n"
+            "   5  -1  3.5  bb\r\n"
+            "  # commented out\n"
+            "   6   0   20  ccc\n"
+            " \t \n"
+            "   8   5    1  d\n"
+            "  22 6.5   -5  e");
+
+        vec1u id;
+        vec1f x;
+        vec1d y;
+        vec1s name;
+        ascii::read_table(file, id, x, y, name);
+        check(id, vec1u({0, 5, 6, 8, 22}));
+        check(x, vec1f({10, -1, 0, 5, 6.5}));
+        check(y, vec1d({20, 3.5, 20, 1, -5}));
+        check(name, vec1s({"a", "bb", "ccc", "d", "e"}));
+
+        // Placeholders, 2D columns
+        vec2d xy;
+        ascii::read_table(file, _, ascii::columns(2,xy));
+        check(xy.dims[0], 5u);
+        check(xy.dims[1], 2u);
+        check(xy(3,_), vec1d({5, 1}));
+
+        // Skip first lines
+        ascii::input_format opts;
+        opts.skip_first = 2;
+        ascii::read_table(file, opts, id);
+        check(id, vec1u({6, 8, 22}));
+
+        opts.skip_first = 10;
+        ascii::read_table(file, opts, id);
+        check(id.empty(), true);
+
+        // Comments with a multi-character pattern
+        write_file(file, "//a\n1\n // b\n2\n/ 3\n");
+        opts = ascii::input_format::standard();
+        opts.skip_pattern = "//";
+        vec1s s;
+        ascii::read_table(file, opts, s);
+        check(s, vec1s({"1", "2", "/"}));
+
+        // Empty file
+        write_file(file, "");
+        ascii::read_table(file, id);
+        check(id.empty(), true);
+    }
+
+    {
+        print("test_read_table_csv...");
+
+        write_file(file,
+            "# id,name,value\n"
+            "1,hello world,2.5\n"
+            "2, spaced ,-1\n"
+            "3,,1e3\n");
+
+        vec1u id;
+        vec1s name;
+        vec1d value;
+        ascii::read_table(file, ascii::input_format::csv(), id, name, value);
+        check(id, vec1u({1, 2, 3}));
+        check(name, vec1s({"hello world", " spaced ", ""}));
+        check(value, vec1d({2.5, -1, 1000}));
+
+        // Multi-character delimiter
+        write_file(file, "1::a::2\n3::b::4\n");
+        ascii::input_format opts = ascii::input_format::csv();
+        opts.delim = "::";
+        vec1u a, b;
+        ascii::read_table(file, opts, a, name, b);
+        check(a, vec1u({1, 3}));
+        check(name, vec1s({"a", "b"}));
+        check(b, vec1u({2, 4}));
+    }
+
+    {
+        print("test_read_table_pipe...");
+
+        // Files which cannot be mapped, and whose size is unknown
+        std::string fifo = "ascii_test.fifo";
+        ::unlink(fifo.c_str());
+        check(::mkfifo(fifo.c_str(), 0600), 0);
+
+        std::thread writer([&]() {
+            write_file(fifo, "# id x\n1 2.5\n2 -3\n3 1e3\n");
+        });
+
+        vec1u id;
+        vec1d x;
+        ascii::read_table(fifo, id, x);
+        writer.join();
+        ::unlink(fifo.c_str());
+
+        check(id, vec1u({1, 2, 3}));
+        check(x, vec1d({2.5, -3, 1e3}));
+    }
+
+    {
+        print("test_read_table_thread...");
+
+        // Large enough to be split between threads, with comments and blank lines
+        auto seed = make_seed(42);
+        const uint_t n = 300000;
+        vec1d v = randomn(seed, n);
+        {
+            std::ofstream out(file);
+            out << "# header\n# header\n";
+            char buf[128];
+            for (uint_t i : range(n)) {
+                if (i % 1000 == 0) out << "# comment\n\n";
+                std::snprintf(buf, sizeof(buf), "%lu %.17g obj%lu %.6e\r\n",
+                    (unsigned long)i, v[i], (unsigned long)i, v[i]);
+                out << buf;
+            }
+        }
+
+        vec1u id1, id2;
+        vec1d v1, v2;
+        vec1s s1, s2;
+        vec1f f1, f2;
+        ascii::input_format opts;
+        opts.skip_first = 3;
+        ascii::read_table(file, opts, id1, v1, s1, f1);
+        check(id1.size(), n-3);
+        check(id1[0], 3u);
+        check(v1, v[3-_]);
+
+        for (uint_t nt : {2, 3, 8}) {
+            opts.thread = nt;
+            ascii::read_table(file, opts, id2, v2, s2, f2);
+            check(id2, id1);
+            check(v2, v1);
+            check(s2, s1);
+            check(f2, f1);
+        }
+    }
+
+    {
+        print("test_write_table...");
+
+        vec1u id = {1, 2, 3, 4, 5};
+        vec1i x = {125, 568, 9852, 12, -51};
+        vec1d y = {-56, 0.5, 2, dnan, 1e30};
+        vec1b b = {true, false, true, true, false};
+        ascii::output_format opts;
+        opts.header = {"id", "x", "y", "b"};
+        ascii::write_table(file, opts, id, x, y, b);
+        check(file::to_string(file),
+            "# id    x     y b\n"
+            "   1  125   -56 1\n"
+            "   2  568   0.5 0\n"
+            "   3 9852     2 1\n"
+            "   4   12   nan 1\n"
+            "   5  -51 1e+30 0\n");
+
+        ascii::write_table(file, ascii::output_format::csv(), x, format::fixed(y),
+            format::precision(y, 2), format::scientific(y));
+        check(file::to_string(file),
+            "125,-56.000000,-56,-5.600000e+01\n"
+            "568,0.500000,0.5,5.000000e-01\n"
+            "9852,2.000000,2,2.000000e+00\n"
+            "12,nan,nan,nan\n"
+            "-51,1000000000000000019884624838656.000000,1e+30,1.000000e+30\n");
+
+        // Default formatting is the same as to_string()
+        auto seed = make_seed(42);
+        vec1d v = randomn(seed, 10000)*pow(10.0, randomu(seed, 10000)*40.0 - 20.0);
+        vec1f vf = v;
+        vec1s sv, svf;
+        ascii::write_table(file, ascii::output_format::csv(), v, vf);
+        ascii::read_table(file, ascii::input_format::csv(), sv, svf);
+        check(sv, to_string_vector(v));
+        check(svf, to_string_vector(vf));
+
+        // Floating point values read back exactly
+        opts = ascii::output_format::standard();
+        opts.round_trip = true;
+        ascii::write_table(file, opts, v, vf);
+        vec1d rv;
+        vec1f rvf;
+        ascii::read_table(file, rv, rvf);
+        check(rv, v);
+        check(rvf, vf);
+
+        // ... with the shortest representation
+        ascii::write_table(file, opts, vec1d{0.1, 1.0/3.0, 100.0}, vec1f{0.1f, 1.0f/3.0f, 1e-3f});
+        ascii::read_table(file, sv, svf);
+        check(sv, vec1s({"0.1", "0.3333333333333333", "100"}));
+        check(svf, vec1s({"0.1", "0.33333334", "0.001"}));
+    }
+
+    {
+        print("test_locale...");
+
+        // Values are read in the classic locale, whatever the C locale
+        vec1s strs = {"3.14159265358979323846", "123456789012345678901234", "1e-30", "1.5", "2.5e+300"};
+        vec1d ref(strs.size());
+        for (uint_t i : range(strs)) {
+            from_string(strs[i], ref[i]);
+        }
+
+        if (set_comma_locale()) {
+            vec1d v(strs.size());
+            bool ok = true;
+            for (uint_t i : range(strs)) {
+                ok = ok && impl::ascii_impl::parse_value(strs[i].data(), strs[i].data() + strs[i].size(), v[i]);
+            }
+
+            check(ok, true);
+            check(v, ref);
+
+            std::setlocale(LC_NUMERIC, "C");
+        } else {
+            print("skipped: no locale with ',' as decimal point");
+        }
+
+        // Values are written in the classic locale, whatever the C locale
+        auto seed = make_seed(42);
+        vec1d v = randomn(seed, 1000)*pow(10.0, randomu(seed, 1000)*40.0 - 20.0);
+        vec1f vf = v;
+        ascii::output_format opts = ascii::output_format::csv();
+        ascii::write_table(file, opts, v, vf, format::fixed(v), format::scientific(v),
+            format::precision(v, 12));
+        std::string ref_default = file::to_string(file);
+        opts.round_trip = true;
+        ascii::write_table(file, opts, v, vf);
+        std::string ref_round = file::to_string(file);
+
+        if (set_comma_locale()) {
+            opts.round_trip = false;
+            ascii::write_table(file, opts, v, vf, format::fixed(v), format::scientific(v),
+                format::precision(v, 12));
+            check(file::to_string(file) == ref_default, true);
+            opts.round_trip = true;
+            ascii::write_table(file, opts, v, vf);
+            check(file::to_string(file) == ref_round, true);
+
+            std::setlocale(LC_NUMERIC, "C");
+        } else {
+            print("skipped: no locale with ',' as decimal point");
+        }
+    }
+
+    file::remove(file);
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+template<typename S>
+void write_image(const std::string& file, const vec<2,S>& v, double bscale, double bzero,
+    int_t blank = 0) {
+
+    fits::output_image oimg(file);
+    oimg.write(v);
+    if (bscale != 1.0 || bzero != 0.0) {
+        oimg.write_keyword("BSCALE", bscale);
+        oimg.write_keyword("BZERO", bzero);
+    }
+    if (blank != 0) {
+        oimg.write_keyword("BLANK", blank);
+    }
+}
+
+// The mapped image must give the same pixels as input_image::read()
+template<typename T>
+void check_mapped(const std::string& file) {
+    print("  ", file, " as ", pretty_type_t(T));
+
+    vec<2,T> r;
+    fits::input_image iimg(file);
+    iimg.read(r);
+
+    fits::mapped_image<2,T> mimg(file);
+    check(mimg.dims, r.dims);
+    check(mimg.size(), r.size());
+
+    vec<2,T> m;
+    mimg.read(m);
+    check(m, r);
+
+    bool same = true;
+    for (uint_t i : range(r)) {
+        same = same && is_same(mimg[i], r.safe[i]);
+    }
+    check(same, true);
+
+    check(mimg(0,0), r(0,0));
+    check(mimg(3,7), r(3,7));
+    check(mimg(r.dims[0]-1,r.dims[1]-1), r(r.dims[0]-1,r.dims[1]-1));
+
+    // Subsets
+    vec<2,T> ms, rs;
+    mimg.read_subset(ms, 5-_-20, 2-_-30);
+    iimg.read_subset(rs, 5-_-20, 2-_-30);
+    check(ms, rs);
+
+    // Regions extending beyond the image are padded
+    mimg.read_region(ms, {{-3, 40}}, {{4, int_t(r.dims[1])+2}}, T(7));
+    check(ms.dims[0], 8u);
+    check(ms.dims[1], r.dims[1]-40+3);
+    check(ms(_-2,_), replicate(T(7), 3, ms.dims[1]));
+    check(ms(_,r.dims[1]-40-_), replicate(T(7), 8, 3));
+    check(ms(3-_-7,0-_-(r.dims[1]-41)), r(0-_-4,40-_));
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    vec2d d = randomn(seed, 37, 53);
+    vec<2,short> s = vec<2,short>{randomi(seed, -3000, 3000, 37, 53)};
+    vec2i l = randomi(seed, -100000, 100000, 37, 53);
+
+    // Blank pixels
+    s(4,9) = s(30,50) = -32000;
+
+    write_image("unit_fits_image_f.fits", vec2f{d}, 1.0, 0.0);
+    write_image("unit_fits_image_d.fits", d, 1.0, 0.0);
+    write_image("unit_fits_image_i.fits", l, 1.0, 0.0);
+    write_image("unit_fits_image_s.fits", s, 0.5, 100.0, -32000);
+    write_image("unit_fits_image_u.fits", s, 1.0, 32768.0);
+
+    {
+        print("test_mapped_image...");
+
+        // All the images are big endian, and need to be swapped on little endian machines
+        check_mapped<float>("unit_fits_image_f.fits");
+        check_mapped<double>("unit_fits_image_f.fits");
+        check_mapped<double>("unit_fits_image_d.fits");
+        check_mapped<int_t>("unit_fits_image_i.fits");
+        check_mapped<double>("unit_fits_image_i.fits");
+
+        // Scaled, with blank values
+        check_mapped<float>("unit_fits_image_s.fits");
+        check_mapped<double>("unit_fits_image_s.fits");
+
+        // Unsigned integers
+        check_mapped<int_t>("unit_fits_image_u.fits");
+        check_mapped<float>("unit_fits_image_u.fits");
+    }
+
+    {
+        print("test_mapped_image_values...");
+
+        fits::mapped_image<2,double> ms("unit_fits_image_s.fits");
+        check(ms(0,0), 0.5*s(0,0) + 100.0);
+        check(ms(36,52), 0.5*s(36,52) + 100.0);
+        check(std::isnan(ms(4,9)), true);
+        check(std::isnan(ms(30,50)), true);
+
+        fits::mapped_image<2,int_t> mu("unit_fits_image_u.fits");
+        check(mu(1,2), int_t(s(1,2)) + 32768);
+
+        fits::mapped_image<2,float> mf("unit_fits_image_f.fits");
+        check(mf(10,11), float(d(10,11)));
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
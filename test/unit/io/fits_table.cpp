@@ -0,0 +1,73 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    const uint_t nrow = 100000;
+    vec1i id = indgen<int_t>(nrow);
+    vec1i flag = randomi(seed, -1, 5, nrow);
+    vec1f flux = randomn(seed, nrow);
+    vec2d pos = randomu(seed, nrow, 2);
+    vec1b good = flag > 0;
+
+    // Negative flags are null values
+    flag[where(flag < 0)] = -99;
+
+    {
+        fits::output_table otbl("unit_fits_table.fits");
+        otbl.set_format(fits::table_format::row_oriented);
+        otbl.write_columns(ftable(id, flag, flux, pos, good));
+        otbl.write_keyword("TNULL2", int_t(-99));
+    }
+
+    {
+        print("test_read_batch...");
+
+        fits::input_table itbl("unit_fits_table.fits");
+
+        // Batched
+        vec1i bid; vec1d bflag; vec1i bflagi; vec1d bflux; vec2d bpos; vec1b bgood;
+        itbl.read_columns("id", bid, "flag", bflag, "flux", bflux, "pos", bpos, "good", bgood);
+        itbl.read_columns("flag", bflagi, "id", bid);
+
+        // Unbatched, one column at a time
+        vec1i uid; vec1d uflag; vec1i uflagi; vec1d uflux; vec2d upos; vec1b ugood;
+        itbl.read_column("id", uid);
+        itbl.read_column("flag", uflag);
+        itbl.read_column("flag", uflagi);
+        itbl.read_column("flux", uflux);
+        itbl.read_column("pos", upos);
+        itbl.read_column("good", ugood);
+
+        check(bid, id);
+        check(uid, id);
+        check(bflux, vec1d{flux});
+        check(bflux, uflux);
+        check(bpos, pos);
+        check(bpos, upos);
+        check(bgood, good);
+        check(bgood, ugood);
+
+        // Null values must be read as NaN in floating point vectors
+        vec1u idn = where(flag == -99);
+        check(idn.empty(), false);
+        check(count(is_nan(bflag)), idn.size());
+        check(count(is_nan(uflag)), idn.size());
+        check(bflag[idn], replicate(dnan, idn.size()));
+        check(bflag[where(flag != -99)], vec1d{flag[where(flag != -99)]});
+        check(bflagi, uflagi);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -1,17 +1,33 @@
 #include <vif.hpp>
-#include <vif/unit_test.hpp>
+#include <vif/test/unit_test.hpp>
 
 using namespace vif;
+using namespace vif::astro;
 
 int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
     vec2d v = gaussian_profile({{41,41}}, 4.0) + 0.1*gaussian_profile({{41,41}}, 10.0);
     vec2cd cv = fft(v);
     vec2d iv = ifft(cv)/v.size();
 
-    for (uint_t i : range(v)) {
-        check(v[i], iv[i]);
+    check(max(abs(iv - v)) < 1e-12, true);
+
+    // Plans are cached, whatever the planning effort and number of threads
+    fft_set_planning(fft_planning::measure);
+    fft_set_threads(2);
+    for (uint_t k : range(3)) {
+        iv = ifft(fft(v*double(k+1)))/(v.size()*double(k+1));
+        check(max(abs(iv - v)) < 1e-12, true);
     }
 
+    fft_set_planning(fft_planning::estimate);
+    fft_set_threads(1);
+
     auto seed = make_seed(42);
     vec2d img = randomn(seed, 1000, 1000);
     vec2d psf = v;
@@ -24,12 +40,61 @@ int vif_main(int argc, char* argv[]) {
     double slow = now() - st;
 
     // TODO: investigate expected numerical precision of the FFT convolution algorithm
-    for (uint_t i : range(v)) {
-        check(cimg1[i], cimg2[i]);
+    check(cimg1.dims, cimg2.dims);
+    check(max(abs(cimg1 - cimg2)) < 1e-10, true);
+
+    // Half-spectrum real transform
+    vec2d vo = v(_,1-_);
+    vec2cd hv = rfft(vo);
+    check(hv.dims[0], vo.dims[0]);
+    check(hv.dims[1], vo.dims[1]/2+1);
+    iv = irfft(hv, vo.dims)/vo.size();
+    check(max(abs(iv - vo)) < 1e-12, true);
+
+    // Plans can be cleared while FFTs are running in another thread
+    double maxdiff = 0.0;
+    std::thread worker([&]() {
+        for (uint_t k : range(50)) {
+            vec2d tv = irfft(rfft(vo*double(k+1)), vo.dims)/(vo.size()*double(k+1));
+            maxdiff = std::max(maxdiff, max(abs(tv - vo)));
+        }
+    });
+
+    for (uint_t k : range(50)) {
+        fft_clear_plans();
     }
 
+    worker.join();
+    check(maxdiff < 1e-12, true);
+
+    // Convolver, reused for several maps
+    convolver2d conv(psf);
+    for (uint_t k : range(2)) {
+        vec2d cimg3 = conv.convolve(img);
+        check(max(abs(cimg3 - cimg2)) < 1e-10, true);
+    }
+
+    vec2d img2 = img(_-99,_-49);
+    vec2d cimg4 = conv.convolve(img2);
+    vec2d cimg5 = convolve2d_naive(img2, psf);
+    check(cimg4.dims, cimg5.dims);
+    check(max(abs(cimg4 - cimg5)) < 1e-10, true);
+
+    // Tiled convolution
+    convolve2d_tiled_params tp;
+    tp.tile_size = 128;
+    tp.thread = 3;
+    vec2d cimg6 = convolve2d_tiled(img2, psf, tp);
+    check(cimg6.dims, cimg5.dims);
+    check(max(abs(cimg6 - cimg5)) < 1e-10, true);
+
+    check(fft_fast_size(1031), 1050u);
+
     print("fast version: ", fast);
     print("slow version: ", slow);
 
-    return 0;
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
 }
@@ -0,0 +1,168 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+// Reference implementation: each value goes to the first bin that contains it
+template<typename TypeB>
+vec1u brute_histogram(const vec1d& x, const vec<2,TypeB>& bins) {
+    vec1u counts(bins.dims[1]);
+    for (uint_t i : range(x)) {
+        for (uint_t b : range(bins.dims[1])) {
+            if (in_bin(x[i], bins, b)) {
+                ++counts[b];
+                break;
+            }
+        }
+    }
+
+    return counts;
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    vec1d x = randomu(seed, 20000)*12.0 - 1.0;
+    x[17] = dnan;
+    x[42] = 0.0;
+    x[43] = 10.0;
+
+    {
+        print("test_histogram_uniform...");
+
+        vec2d bins = make_bins(0.0, 10.0, 37);
+        check(histogram(x, bins), brute_histogram(x, bins));
+
+        // Values exactly on the edges
+        vec1d e = bins(0,_);
+        check(histogram(e, bins), replicate(1u, bins.dims[1]));
+    }
+
+    {
+        print("test_histogram_sorted...");
+
+        // Gaps and uneven widths
+        vec2d bins = {{-0.5, 0.0, 0.1, 2.0, 7.5}, {0.0, 0.1, 1.5, 7.0, 9.0}};
+        check(histogram(x, bins), brute_histogram(x, bins));
+
+        vec2i ibins = {{0, 2, 5, 8, 10}, {2, 5, 8, 10, 12}};
+        check(histogram(x, ibins), brute_histogram(x, ibins));
+    }
+
+    {
+        print("test_histogram_overlapping...");
+
+        vec2d bins = {{5.0, 0.0, 2.0, 8.0}, {9.0, 6.0, 3.0, 8.5}};
+        check(histogram(x, bins), brute_histogram(x, bins));
+    }
+
+    {
+        print("test_histogram_weights...");
+
+        vec2d bins = make_bins(0.0, 10.0, 20);
+        vec1d w = randomu(seed, x.size());
+        vec1d wc = histogram(x, w, bins);
+        vec1d ref(bins.dims[1]);
+        for (uint_t i : range(x)) {
+            for (uint_t b : range(bins.dims[1])) {
+                if (in_bin(x[i], bins, b)) {
+                    ref[b] += w[i];
+                    break;
+                }
+            }
+        }
+
+        check(max(abs(wc - ref)) < 1e-9, true);
+    }
+
+    {
+        print("test_histogram_ids...");
+
+        vec2d bins = {{0.0, 3.0, 3.5}, {2.0, 3.5, 9.0}};
+        vec1u counts(bins.dims[1]);
+        vec1u seen(x.size());
+        bool sorted = true;
+        histogram(x, bins, [&](uint_t b, vec1u ids) {
+            counts[b] = ids.size();
+            for (uint_t k : range(ids)) {
+                ++seen[ids[k]];
+                if (!in_bin(x[ids[k]], bins, b)) sorted = false;
+                if (k != 0 && ids[k] <= ids[k-1]) sorted = false;
+            }
+        });
+
+        check(counts, brute_histogram(x, bins));
+        check(sorted, true);
+        check(max(seen), 1u);
+    }
+
+    {
+        print("test_histogram2d...");
+
+        vec1d y = randomu(seed, x.size())*5.0;
+        vec2d xb = make_bins(0.0, 10.0, 13);
+        vec2d yb = {{0.0, 1.0, 4.0}, {0.5, 3.0, 5.0}};
+
+        vec2u ref(xb.dims[1], yb.dims[1]);
+        for (uint_t i : range(x)) {
+            for (uint_t bx : range(xb.dims[1])) {
+                if (!in_bin(x[i], xb, bx)) continue;
+                for (uint_t by : range(yb.dims[1])) {
+                    if (in_bin(y[i], yb, by)) {
+                        ++ref(bx,by);
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+
+        check(histogram2d(x, y, xb, yb), ref);
+
+        vec2u counts(xb.dims[1], yb.dims[1]);
+        histogram2d(x, y, xb, yb, [&](uint_t i, uint_t j, vec1u ids) {
+            counts(i,j) = ids.size();
+        });
+
+        check(counts, ref);
+    }
+
+    {
+        print("test_histogram_parallel...");
+
+        vec1d big = randomn(seed, 300000);
+        vec1d w = randomu(seed, big.size());
+        vec2d bins = make_bins(-3.0, 3.0, 200);
+
+        vec1u c1 = histogram(big, bins);
+        vec1d w1 = histogram(big, w, bins);
+        vec2u h1 = histogram2d(big, w, bins, make_bins(0.0, 1.0, 10));
+
+        // Many bins: fewer, larger chunks
+        vec2d fine = make_bins(-3.0, 3.0, 50000);
+        vec1d wf1 = histogram(big, w, fine);
+
+        for (uint_t nt : {2, 4, 7}) {
+            parallel_scope ps(nt, 1000);
+            check(histogram(big, bins), c1);
+            check(histogram2d(big, w, bins, make_bins(0.0, 1.0, 10)), h1);
+
+            // Sums must be bit-for-bit identical
+            check(count(histogram(big, w, bins) != w1), 0u);
+            check(count(histogram(big, w, fine) != wf1), 0u);
+        }
+
+        check(total(c1), uint_t(count(big >= -3.0 && big < 3.0)));
+        check(abs(total(wf1) - total(w[where(big >= -3.0 && big < 3.0)])) < 1e-8, true);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+namespace simd = vif::impl::simd_impl;
+
+// Distance between two doubles, in units of the last place
+uint_t ulp_distance(double a, double b) {
+    if (std::isnan(a) && std::isnan(b)) return 0;
+    if (a == b) return 0;
+    std::int64_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(double));
+    std::memcpy(&ib, &b, sizeof(double));
+    return std::abs(ia - ib);
+}
+
+template<typename F>
+uint_t max_ulp(const vec1d& x, const vec1d& y, F&& ref) {
+    uint_t m = 0;
+    for (uint_t i : range(x)) {
+        m = std::max(m, ulp_distance(y[i], ref(x[i])));
+    }
+    return m;
+}
+
+int vif_main(int argc, char* argv[]) {
+    auto seed = make_seed(42);
+    vec1d xe = randomu(seed, 10001)*1450.0 - 740.0;
+    vec1d xl = e10(randomu(seed, 10001)*600.0 - 300.0);
+
+    append(xe, vec1d{dnan, dinf, -dinf, 0.0, -800.0, 800.0, 709.78, -745.0});
+    append(xl, vec1d{dnan, dinf, -dinf, 0.0, -1.0, 1.0, 4.9e-324, 1e-310});
+
+    simd::isa best = simd::active_isa();
+    for (simd::isa i : {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2, simd::isa::avx512}) {
+        if (i > simd::detect_isa()) continue;
+
+        print("test_simd_", uint_t(i), "...");
+        simd::active_isa() = i;
+
+        check(max_ulp(xe, exp(xe), [](double x) { return std::exp(x); }) <= 2, true);
+        check(max_ulp(xl, log(xl), [](double x) { return std::log(x); }) <= 1, true);
+        check(max_ulp(xl, log2(xl), [](double x) { return std::log2(x); }) <= 1, true);
+        check(max_ulp(xl, log10(xl), [](double x) { return std::log10(x); }) <= 2, true);
+        check(max_ulp(xl, sqrt(xl), [](double x) { return std::sqrt(x); }), 0u);
+
+        // Float and rvalue versions
+        vec1f xf = {0.5, 1.0, 2.0, 50.0, 1e-3};
+        check(max(abs(vec1d(log10(xf)) - log10(vec1d(xf)))) < 1e-6, true);
+        check(max(abs(vec1d(exp(vec1f(xf))) - exp(vec1d(xf)))/exp(vec1d(xf))) < 1e-6, true);
+
+        // Odd sizes and multidimensional vectors
+        vec2d x2 = {{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}};
+        vec2d y2 = exp(x2);
+        check(y2.dims, x2.dims);
+        check(max_ulp(flatten(x2), flatten(y2), [](double x) { return std::exp(x); }) <= 2, true);
+    }
+
+    simd::active_isa() = best;
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
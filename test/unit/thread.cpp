@@ -0,0 +1,318 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+// Several producers and consumers, every item must be received exactly once
+template<typename Q>
+void test_concurrent_queue(Q& q) {
+    const uint_t nprod = 3, ncons = 3, nitem = 5000;
+
+    vec1u hits(nprod*nitem);
+    std::atomic<uint_t> received(0);
+    std::vector<std::thread> threads;
+
+    for (uint_t p = 0; p < nprod; ++p) {
+        threads.emplace_back([&,p]() {
+            for (uint_t i = 0; i < nitem; ++i) {
+                impl::thread_impl::queue_push(q, p*nitem + i);
+            }
+        });
+    }
+
+    std::vector<vec1u> got(ncons);
+    for (uint_t c = 0; c < ncons; ++c) {
+        threads.emplace_back([&,c]() {
+            uint_t v;
+            while (received < nprod*nitem) {
+                if (q.pop(v)) {
+                    got[c].push_back(v);
+                    ++received;
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (auto& g : got) {
+        for (uint_t v : g) {
+            ++hits.safe[v];
+        }
+    }
+
+    check(hits, replicate(1u, nprod*nitem));
+    check(q.empty(), true);
+}
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    {
+        print("test_parallel_for...");
+
+        for (uint_t nt : {1, 2, 4, 7}) {
+            vec1u hits(1000);
+            thread::parallel_for pfor(nt);
+            check(pfor.size(), nt);
+
+            pfor.execute([&](uint_t i) {
+                ++hits.safe[i];
+            }, hits.size());
+            check(hits, replicate(1u, 1000));
+
+            // Starting index different from zero
+            hits[_] = 0;
+            pfor.execute([&](uint_t i) {
+                ++hits.safe[i];
+            }, 300, 1000);
+            check(total(hits[_-299]), 0u);
+            check(hits[300-_], replicate(1u, 700));
+
+            // Chunk size larger than the range, and empty range
+            pfor.chunk_size = 5000;
+            hits[_] = 0;
+            pfor.execute([&](uint_t i) {
+                ++hits.safe[i];
+            }, hits.size());
+            check(hits, replicate(1u, 1000));
+            pfor.execute([&](uint_t i) {
+                ++hits.safe[i];
+            }, 10, 10);
+            check(hits, replicate(1u, 1000));
+        }
+    }
+
+    {
+        print("test_parallel_for_irregular...");
+
+        // Very uneven cost per iteration
+        vec1d res(200);
+        thread::parallel_for pfor(4);
+        pfor.execute([&](uint_t i) {
+            double s = 0;
+            uint_t n = (i % 50 == 0 ? 200000 : 10);
+            for (uint_t k = 0; k < n; ++k) {
+                s += 1.0/(k+1.0);
+            }
+            res.safe[i] = s;
+        }, res.size());
+
+        check(res[0] > 12.0, true);
+        check(res[1] > 2.9 && res[1] < 3.0, true);
+    }
+
+    {
+        print("test_parallel_for_nested...");
+
+        vec2u hits(20, 300);
+        thread::parallel_for outer(4);
+        outer.execute([&](uint_t i) {
+            thread::parallel_for inner(3);
+            inner.execute([&](uint_t j) {
+                ++hits.safe(i,j);
+            }, hits.dims[1]);
+        }, hits.dims[0]);
+
+        check(hits, replicate(1u, 20, 300));
+    }
+
+    {
+        print("test_parallel_for_exception...");
+
+        const std::thread::id caller = std::this_thread::get_id();
+        thread::parallel_for pfor(4);
+        pfor.chunk_size = 1;
+
+        // Thrown by the calling thread
+        bool caught = false;
+        try {
+            pfor.execute([&](uint_t i) {
+                if (std::this_thread::get_id() == caller && i > 10) {
+                    throw std::runtime_error("caller");
+                }
+            }, 1000);
+        } catch (std::runtime_error& e) {
+            caught = std::string(e.what()) == "caller";
+        }
+
+        check(caught, true);
+
+        // Thrown by a worker thread, while the calling thread waits for it
+        std::atomic<bool> worker_ran(false);
+        caught = false;
+        try {
+            pfor.execute([&](uint_t i) {
+                if (std::this_thread::get_id() != caller) {
+                    worker_ran = true;
+                    throw std::runtime_error("worker");
+                } else if (i == 0) {
+                    double start = now();
+                    while (!worker_ran && now() - start < 10.0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }, 1000);
+        } catch (std::runtime_error& e) {
+            caught = std::string(e.what()) == "worker";
+        }
+
+        check(worker_ran.load(), true);
+        check(caught, true);
+
+        // Thrown by a nested loop
+        caught = false;
+        try {
+            pfor.execute([&](uint_t i) {
+                thread::parallel_for inner(3);
+                inner.execute([&](uint_t j) {
+                    if (i == 5 && j == 7) throw std::runtime_error("nested");
+                }, 100);
+            }, 20);
+        } catch (std::runtime_error& e) {
+            caught = std::string(e.what()) == "nested";
+        }
+
+        check(caught, true);
+
+        // The scheduler is still usable
+        vec1u hits(1000);
+        pfor.execute([&](uint_t i) {
+            ++hits.safe[i];
+        }, hits.size());
+        check(hits, replicate(1u, 1000));
+    }
+
+    {
+        print("test_worker_pool...");
+
+        vec1u hits(5000);
+        thread::worker_pool<uint_t> pool(4, [&](uint_t i) {
+            ++hits.safe[i];
+        });
+        check(pool.size(), 4u);
+
+        for (uint_t k = 0; k < 3; ++k) {
+            for (uint_t i : range(hits)) {
+                pool.process(i);
+            }
+
+            pool.consume_all();
+            check(pool.remaining(), 0u);
+            check(hits, replicate(k+1, hits.size()));
+
+            // Let the workers go to sleep
+            thread::sleep_for(0.01);
+        }
+
+        // Items still queued are processed before the workers stop
+        for (uint_t i : range(hits)) {
+            pool.process(i);
+        }
+
+        pool.join();
+        check(hits, replicate(4u, hits.size()));
+    }
+
+    {
+        print("test_worker_pool_workspace...");
+
+        struct workspace {
+            uint_t count = 0;
+            std::atomic<uint_t>* total = nullptr;
+            explicit workspace(std::atomic<uint_t>* t) : total(t) {}
+            ~workspace() {
+                *total += count;
+            }
+        };
+
+        std::atomic<uint_t> processed(0);
+        {
+            thread::worker_pool<uint_t, workspace> pool;
+            pool.start(3, [](workspace& w, uint_t i) {
+                ++w.count;
+            }, &processed);
+
+            for (uint_t i = 0; i < 1000; ++i) {
+                pool.process(i);
+            }
+
+            pool.consume_all();
+        }
+
+        check(processed.load(), 1000u);
+    }
+
+    {
+        print("test_mpmc_queue...");
+
+        thread::mpmc_queue<uint_t> q(5);
+        check(q.capacity(), 8u);
+        check(q.empty(), true);
+
+        for (uint_t i = 0; i < 8; ++i) {
+            check(q.push(i), true);
+        }
+
+        check(q.push(8u), false);
+        check(q.size(), 8u);
+
+        uint_t v = 0;
+        check(q.pop(v), true);
+        check(v, 0u);
+        check(q.push(8u), true);
+
+        vec1u popped;
+        while (q.pop(v)) {
+            popped.push_back(v);
+        }
+
+        check(popped, vec1u({1, 2, 3, 4, 5, 6, 7, 8}));
+        check(q.empty(), true);
+    }
+
+    {
+        print("test_mpmc_queue_concurrent...");
+
+        thread::mpmc_queue<uint_t> q1(64);
+        test_concurrent_queue(q1);
+        thread::segmented_queue<uint_t> q2(16);
+        test_concurrent_queue(q2);
+    }
+
+    {
+        print("test_worker_pool_mpmc...");
+
+        vec1u hits(6000);
+        thread::worker_pool<uint_t, void, thread::segmented_queue<uint_t>> pool(3, [&](uint_t i) {
+            ++hits.safe[i];
+        });
+
+        std::vector<std::thread> producers;
+        for (uint_t p = 0; p < 3; ++p) {
+            producers.emplace_back([&,p]() {
+                for (uint_t i = p; i < hits.size(); i += 3) {
+                    pool.process(i);
+                }
+            });
+        }
+
+        for (auto& t : producers) {
+            t.join();
+        }
+
+        pool.consume_all();
+        check(hits, replicate(1u, hits.size()));
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    {
+        print("test_lazy_construct...");
+
+        vec2d a = {{1.0, 2.0}, {3.0, 4.0}};
+        vec2d b = {{2.0, 2.0}, {1.0, 0.5}};
+        vec2i c = {{1, 2}, {3, 4}};
+
+        vec2d r = lazy(a)*b + c*2 - 1.0;
+        check(r, a*b + c*2 - 1.0);
+        check(r.dims, a.dims);
+
+        vec2d n = -lazy(a)/b;
+        check(n, -(a/b));
+
+        vec2i m = lazy(c) % 3;
+        check(m, c % 3);
+
+        vec2f f = 2.0*lazy(a);
+        check(f, vec2f(2.0*a));
+
+        auto cr = (lazy(a) - b).concretise();
+        check(cr, a - b);
+    }
+
+    {
+        print("test_lazy_assign...");
+
+        vec2d a = {{1.0, 2.0}, {3.0, 4.0}};
+        vec2d b = {{2.0, 2.0}, {1.0, 0.5}};
+
+        // Assign to existing vector of different dimensions
+        vec2d r(3, 3);
+        r = lazy(a) + b;
+        check(r, a + b);
+        check(r.dims, a.dims);
+
+        // Assign in place, reading the same vector
+        vec2d t = a;
+        t = lazy(t)*t + b;
+        check(t, a*a + b);
+
+        // Assign with a view on the same vector (aliasing)
+        vec1d v = {1.0, 2.0, 3.0, 4.0};
+        vec1d ov = v;
+        v = lazy(v[{3,2,1,0}]) + 1.0;
+        check(v, reverse(ov) + 1.0);
+
+        // Assign to a view
+        vec1d w = {1.0, 2.0, 3.0, 4.0};
+        w[{0,2}] = lazy(w[{2,0}])*10.0;
+        check(w, vec1d({30.0, 2.0, 10.0, 4.0}));
+
+        vec1d x = {1.0, 2.0, 3.0, 4.0};
+        vec1d y = {1.0, 1.0};
+        x[{1,3}] = lazy(y) - x[{0,1}];
+        check(x, vec1d({1.0, 0.0, 3.0, -1.0}));
+    }
+
+    {
+        print("test_lazy_reduce...");
+
+        vec1d a = {1.0, 2.0, 3.0, 4.0};
+        vec1d b = {4.0, 3.0, 2.0, 1.0};
+        check(total(lazy(a)*b), total(a*b));
+        check(mean(lazy(a) + b), mean(a + b));
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
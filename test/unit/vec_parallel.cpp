@@ -0,0 +1,112 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    auto seed = make_seed(42);
+    vec2d a = randomn(seed, 300, 700);
+    vec2d b = randomu(seed, 300, 700) + 0.5;
+    vec2f f = randomu(seed, 300, 700);
+    vec1i n = randomi(seed, -1000, 1000, 200000);
+    a.safe[1234] = dnan;
+
+    // Serial results
+    vec2d sab = a*b + 2.0;
+    vec2d sdiv = 1.0/b;
+    vec2b scmp = a > b;
+    vec2d ssqrt = sqrt(b);
+    vec2f sexp = exp(f);
+    vec2d sabs = abs(a);
+    vec2d sinp = a; sinp *= b; sinp += 1.0;
+    double stot = total(b);
+    double smean = mean(b);
+    double srms = rms(b);
+    double ssdev = stddev(b);
+    double slazy = total(lazy(b)*f);
+    int_t sntot = total(n);
+    uint_t sminid = min_id(a), smaxid = max_id(a);
+    std::pair<uint_t,uint_t> sminmax = minmax_ids(a);
+
+    for (uint_t nt : {2, 3, 8}) {
+        print("test_parallel_", nt, "...");
+        parallel_scope ps(nt, 1000);
+        check(ps.nthread(), nt);
+
+        check(a*b + 2.0, sab);
+        check(1.0/b, sdiv);
+        check(a > b, scmp);
+        check(sqrt(b), ssqrt);
+        check(exp(f), sexp);
+        check(abs(a), sabs);
+
+        vec2d inp = a; inp *= b; inp += 1.0;
+        check(inp, sinp);
+
+        // Sums must be bit-for-bit identical
+        check(total(b) == stot, true);
+        check(mean(b) == smean, true);
+        check(rms(b) == srms, true);
+        check(stddev(b) == ssdev, true);
+        check(total(lazy(b)*f) == slazy, true);
+        check(total(n), sntot);
+
+        check(min_id(a), sminid);
+        check(max_id(a), smaxid);
+        check(minmax_ids(a).first, sminmax.first);
+        check(minmax_ids(a).second, sminmax.second);
+    }
+
+    {
+        print("test_parallel_scope...");
+
+        {
+            parallel_scope ps(4);
+            {
+                parallel_scope ps2(2);
+                check(ps2.nthread(), 2u);
+            }
+            check(ps.nthread(), 4u);
+        }
+
+        // Only NaN
+        vec1d v = replicate(dnan, 100000);
+        parallel_scope ps(4, 10);
+        check(min_id(v), 0u);
+        check(minmax_ids(v).first, 0u);
+        check(minmax_ids(v).second, 0u);
+    }
+
+    {
+        print("test_parallel_exception...");
+
+        // Exceptions thrown by any thread are forwarded to the caller once all are done
+        parallel_scope ps(4, 10);
+        for (uint_t bad : {0u, 37u}) {
+            bool caught = false;
+            try {
+                impl::parallel_impl::pool().run(4, 64, [&](uint_t c) {
+                    if (c == bad) throw std::runtime_error("chunk failed");
+                });
+            } catch (std::runtime_error&) {
+                caught = true;
+            }
+
+            check(caught, true);
+            check(ps.nthread(), 4u);
+        }
+
+        check(total(b) == stot, true);
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
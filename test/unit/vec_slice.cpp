@@ -0,0 +1,85 @@
+#include <vif.hpp>
+#include <vif/test/unit_test.hpp>
+
+using namespace vif;
+
+int vif_main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "line") {
+            check_show_line = true;
+        }
+    }
+
+    {
+        print("test_slice_read...");
+
+        vec2d img(5,6);
+        for (uint_t i : range(img)) {
+            img[i] = i;
+        }
+
+        vec1d row = img.slice(2,_);
+        check(row, vec1d(img(2,_)));
+
+        vec1d col = img.slice(_,3);
+        check(col, vec1d(img(_,3)));
+
+        vec2d blk = img.slice(1-_-3, 2-_-4);
+        check(blk, vec2d(img(1-_-3, 2-_-4)));
+        check(blk.dims, img.slice(1-_-3, 2-_-4).dims());
+
+        check(img.slice(3,_)(2), img(3,2));
+        check(img.slice(_,1-_-4).slice(2,_).concretise(), vec1d(img(2,1-_-4)));
+        check(img.slice(_,1-_-4).slice(2,_).view(), vec1d(img(2,1-_-4)));
+
+        const vec2d& cimg = img;
+        vec1d crow = cimg.slice(4,_);
+        check(crow, vec1d(img(4,_)));
+
+        vec1d lz = img.slice(_,0)*2.0 + 1.0;
+        check(lz, vec1d(img(_,0))*2.0 + 1.0);
+        check(total(img.slice(1,_)), total(img(1,_)));
+    }
+
+    {
+        print("test_slice_write...");
+
+        vec2d img(5,6);
+        for (uint_t i : range(img)) {
+            img[i] = i;
+        }
+
+        vec1d col = img(_,3);
+        img.slice(_,3) *= 2.0;
+        check(vec1d(img(_,3)), col*2.0);
+
+        img.slice(1-_-2,_) = 0.0;
+        check(total(img(1-_-2,_)), 0.0);
+
+        img.slice(0,_) = img.slice(4,_);
+        check(vec1d(img(0,_)), vec1d(img(4,_)));
+
+        vec1b b = {true, false, true};
+        b.slice(1-_-2) = true;
+        check(b, vec1b({true, true, true}));
+    }
+
+    {
+        print("test_slice_aliasing...");
+
+        vec1d x = {1.0, 2.0, 3.0, 4.0, 5.0};
+        x.slice(1-_-4) = x.slice(0-_-3);
+        check(x, vec1d({1.0, 1.0, 2.0, 3.0, 4.0}));
+
+        x.slice(0-_-3) += lazy(x[{4,3,2,1}]);
+        check(x, vec1d({5.0, 4.0, 4.0, 4.0, 4.0}));
+
+        x = x.slice(1-_-3)*2.0;
+        check(x, vec1d({8.0, 8.0, 8.0}));
+    }
+
+    print("total:");
+    print("> ", tested - failed, "/", tested," passed");
+
+    return failed == 0u ? 0 : 1;
+}
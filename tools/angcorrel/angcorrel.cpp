@@ -25,8 +25,11 @@ int vif_main(int argc, char* argv[]) {
     uint_t nbin = 10;
     std::string out_file = "angcorrel.fits";
     uint_t tseed = 42;
+    uint_t thread = 1;
+    uint_t jackknife = 0;
 
-    read_args(argc-2, argv+2, arg_list(range, nbin, name(out_file, "out"), name(tseed, "seed")));
+    read_args(argc-2, argv+2, arg_list(range, nbin, name(out_file, "out"), name(tseed, "seed"),
+        thread, jackknife));
 
     vec2d bins = e10(make_bins(log10(range[0]), log10(range[1]), nbin));
     vec1d ang = 0.5*(bins(0,_) + bins(1,_));
@@ -53,9 +56,18 @@ int vif_main(int argc, char* argv[]) {
         return 1;
     }
 
-    vec1d w = angcorrel(cat.ra, cat.dec, rra, rdec, bins);
-
-    fits::write_table(out_file, ftable(bins, w, ang));
+    angcorrel_params params;
+    params.thread = thread;
+    params.jackknife = jackknife;
+    angcorrel_res res = angcorrel(cat.ra, cat.dec, rra, rdec, bins, params);
+
+    vec1d w = res.w;
+    if (jackknife != 0) {
+        vec1d w_err = res.w_err;
+        fits::write_table(out_file, ftable(bins, w, w_err, ang));
+    } else {
+        fits::write_table(out_file, ftable(bins, w, ang));
+    }
 
     return 0;
 }
@@ -64,12 +76,13 @@ void print_help() {
     using namespace terminal_format;
 
     print("angcorrel v1.0");
-    paragraph("usage: angcorrel cat.fits refcat.fits [range,nbin,out,seed]");
+    paragraph("usage: angcorrel cat.fits refcat.fits [range,nbin,out,seed,thread,jackknife]");
     paragraph("Compute the angular two point correlation function of a given catalog "
         "'cat.fits'. The correlation is calculated using the Landy-Szalay estimator, by "
         "comparing against a random uniform distribution of points generated within the "
         "boundaries of the catalog 'refcat.fits'. The correlation function is written in "
-        "a FITS file as column 'W', in units of counts per arcsec.");
+        "a FITS file as column 'W', in units of counts per arcsec. If jackknife regions are "
+        "requested, the uncertainty on the correlation function is written as column 'W_ERR'.");
 
     header("List of available command line options:");
     bullet("range", "[float,float] angular range within which to compute the correlation "
@@ -78,4 +91,8 @@ void print_help() {
     bullet("out", "[string] output file name (default: angcorrel.fits)");
     bullet("seed", "[unsigned integer] random seed for the generation of the random "
         "uniform positions (default: 42)");
+    bullet("thread", "[unsigned integer] number of threads to use to count pairs "
+        "(default: 1)");
+    bullet("jackknife", "[unsigned integer] number of jackknife regions used to estimate "
+        "the uncertainty on the correlation function (default: 0, no uncertainty)");
 }
@@ -57,42 +57,94 @@ do_next check_rows(const std::string& colname, uint_t tmp_row, uint_t& nrow,
     return do_next::run;
 }
 
-template<std::size_t D, typename T>
-do_next read_column_(const std::string& filename, const std::string& colname,
-    vec<D,std::string>& v, uint_t& nrow, const vec1u& ids, meta::type_list<T>) {
+// A column of the output file. Values are kept in their native type, and are only formatted
+// when the file is written.
+struct out_column {
+    enum kind_t {
+        string, boolean, integer, float_simple, float_double
+    };
+
+    kind_t kind = string;
+    vec1s str;
+    vec1b bln;
+    vec1i itg;
+    vec1f flt;
+    vec1d dbl;
+
+    void set(vec1s v) { kind = string;       str = std::move(v); }
+    void set(vec1b v) { kind = boolean;      bln = std::move(v); }
+    void set(vec1i v) { kind = integer;      itg = std::move(v); }
+    void set(vec1f v) { kind = float_simple; flt = std::move(v); }
+    void set(vec1d v) { kind = float_double; dbl = std::move(v); }
+
+    // Largest width of the formatted values. Only strings and the extrema of integers are
+    // formatted; floating point values use an upper bound, so they are formatted only once
+    // when the file is written.
+    uint_t width(impl::ascii_impl::cell_formatter& fmt) const {
+        switch (kind) {
+        case string :       return str.empty() ? 0 : max(length(str));
+        case boolean :      return bln.empty() ? 0 : 1;
+        case integer :      return itg.empty() ? 0 : std::max(fmt.format(min(itg)).size,
+                                fmt.format(max(itg)).size);
+        case float_simple : return flt.empty() ? 0 : fmt.max_width(float());
+        case float_double : return dbl.empty() ? 0 : fmt.max_width(double());
+        }
 
-    vec<D,T> tmp;
-    fits::read_table(filename, colname, tmp);
+        return 0;
+    }
 
-    auto next = check_rows(colname, tmp.dims[0], nrow, ids);
-    if (next != do_next::run) {
-        return next;
+    void write(impl::ascii_impl::file_writer& file, uint_t i, uint_t w) const {
+        switch (kind) {
+        case string :       file.write_cell_left(file.fmt.format(str.safe[i]), w); break;
+        case boolean :      file.write_cell_left(file.fmt.format(bool(bln.safe[i])), w); break;
+        case integer :      file.write_cell_left(file.fmt.format(itg.safe[i]), w); break;
+        case float_simple : file.write_cell_left(file.fmt.format(flt.safe[i]), w); break;
+        case float_double : file.write_cell_left(file.fmt.format(dbl.safe[i]), w); break;
+        }
     }
+};
 
-    if (!ids.empty()) {
-        tmp = tmp(ids, repeat<D-1>(_));
+template<typename T>
+void add_columns(vec<1,T>&& v, std::vector<out_column>& out) {
+    out.emplace_back();
+    out.back().set(std::move(v));
+}
+
+template<typename T>
+void add_columns(vec<2,T>&& v, std::vector<out_column>& out) {
+    for (uint_t i : range(v.dims[1])) {
+        out.emplace_back();
+        out.back().set(vec<1,T>(v(_,i)));
     }
+}
 
-    v = to_string_vector(tmp);
+// Bytes are written as with to_string()
+void add_columns(vec<1,char>&& v, std::vector<out_column>& out) {
+    add_columns(to_string_vector(v), out);
+}
 
-    return do_next::run;
+void add_columns(vec<2,char>&& v, std::vector<out_column>& out) {
+    add_columns(to_string_vector(v), out);
 }
 
-template<std::size_t D>
+template<std::size_t D, typename T>
 do_next read_column_(const std::string& filename, const std::string& colname,
-    vec<D,std::string>& v, uint_t& nrow, const vec1u& ids, meta::type_list<std::string>) {
+    std::vector<out_column>& out, uint_t& nrow, const vec1u& ids, meta::type_list<T>) {
 
-    fits::read_table(filename, colname, v);
+    vec<D,T> tmp;
+    fits::read_table(filename, colname, tmp);
 
-    auto next = check_rows(colname, v.dims[0], nrow, ids);
+    auto next = check_rows(colname, tmp.dims[0], nrow, ids);
     if (next != do_next::run) {
         return next;
     }
 
     if (!ids.empty()) {
-        v = v(ids, repeat<D-1>(_));
+        tmp = tmp(ids, repeat<D-1>(_));
     }
 
+    add_columns(std::move(tmp), out);
+
     return do_next::run;
 }
 
@@ -105,14 +157,14 @@ void read_column(const std::string& filename, const std::string& colname,
 
 template<std::size_t D, typename T>
 do_next read_column(const std::string& filename, const std::string& colname,
-    vec<D,std::string>& v, uint_t& nrow, const vec1u& ids) {
+    std::vector<out_column>& v, uint_t& nrow, const vec1u& ids) {
 
     return read_column_<D>(filename, colname, v, nrow, ids, meta::type_list<T>{});
 }
 
 template<std::size_t Dim>
 do_next read_column(const std::string& in_file, const fits::column_info& cinfo,
-    vec<Dim,std::string>& v, std::string& vtype, uint_t& nrow, const vec1u& ids) {
+    std::vector<out_column>& v, std::string& vtype, uint_t& nrow, const vec1u& ids) {
 
     switch (cinfo.type) {
     case fits::column_info::string : {
@@ -272,7 +324,7 @@ int vif_main(int argc, char* argv[]) {
 
     vec1s names;
     vec1s types;
-    std::vector<vec1s> out_cols;
+    std::vector<out_column> out_cols;
     uint_t nrow_base = 0;
 
     for (auto& c : cols) {
@@ -288,9 +340,7 @@ int vif_main(int argc, char* argv[]) {
 
         if (c.dims.size() == 1) {
             std::string type;
-            vec1s v;
-
-            auto next = read_column<1>(in_file, c, v, type, nrow_base, id_sel);
+            auto next = read_column<1>(in_file, c, out_cols, type, nrow_base, id_sel);
             if (next == do_next::skip) continue;
             if (next == do_next::abort) return 1;
 
@@ -302,7 +352,6 @@ int vif_main(int argc, char* argv[]) {
                 name = c.name;
             }
 
-            out_cols.push_back(v);
             names.push_back(to_lower(name));
             types.push_back("["+type+"]");
         } else if (c.dims.size() == 2) {
@@ -313,24 +362,19 @@ int vif_main(int argc, char* argv[]) {
                 continue;
             }
 
-            std::string type;
-            vec2s v;
-
-            auto next = read_column<2>(in_file, c, v, type, nrow_base, id_sel);
-            if (next == do_next::skip) continue;
-            if (next == do_next::abort) return 1;
-
-            if (split_names[i2c[0]].size() != v.dims[1]) {
+            if (split_names[i2c[0]].size() != c.dims[1]) {
                 error("incompatible name list and column dimension (",
-                    split_names[i2c[0]].size(), " vs ", v.dims[1], ")");
+                    split_names[i2c[0]].size(), " vs ", c.dims[1], ")");
                 return 1;
             }
 
+            std::string type;
+            auto next = read_column<2>(in_file, c, out_cols, type, nrow_base, id_sel);
+            if (next == do_next::skip) continue;
+            if (next == do_next::abort) return 1;
+
             append(names, split_names[i2c[0]]);
-            append(types, replicate("["+type+"]", v.dims[1]));
-            for (uint_t i : range(v.dims[1])) {
-                out_cols.push_back(v(_,i));
-            }
+            append(types, replicate("["+type+"]", c.dims[1]));
         } else {
             warning(c.dims.size(), "-dimensional column '", c.name, "' is not supported");
             note("skipping");
@@ -342,33 +386,40 @@ int vif_main(int argc, char* argv[]) {
 
     if (verbose) note("serializing ", out_cols.size(), " columns of ", nrow, " rows");
 
-    vec1u colsize(out_cols.size());
-    for (uint_t ic : range(out_cols.size())) {
-        colsize[ic] = max(vec1u{
-            names[ic].length(), types[ic].length(), max(length(out_cols[ic]))
-        });
+    // Cells are formatted directly in the output buffer, which is written in large blocks
+    impl::ascii_impl::file_writer file;
+    file.out.open(out_file);
+    if (!file.out.is_open()) {
+        error("could not open '", out_file, "' to write data");
+        return 1;
     }
 
     const uint_t padding = 2;
+    vec1u colsize(out_cols.size());
     for (uint_t ic : range(out_cols.size())) {
-        names[ic] = align_left(names[ic], colsize[ic]+padding);
-        types[ic] = align_left(types[ic], colsize[ic]+padding);
-        out_cols[ic] = align_left(out_cols[ic], colsize[ic]+padding);
+        colsize[ic] = max(vec1u{
+            names[ic].length(), types[ic].length(), out_cols[ic].width(file.fmt)
+        }) + padding;
+
+        names[ic] = align_left(names[ic], colsize[ic]);
+        types[ic] = align_left(types[ic], colsize[ic]);
     }
 
-    std::ofstream out(out_file);
-    out << "# " << collapse(names) << "\n";
-    out << "# " << collapse(types) << "\n";
-    out << "# \n";
+    file.buffer += "# "+collapse(names)+"\n";
+    file.buffer += "# "+collapse(types)+"\n";
+    file.buffer += "# \n";
 
     for (uint_t j : range(nrow)) {
-        out << "  ";
+        file.buffer += "  ";
         for (uint_t ic : range(out_cols.size())) {
-            out << out_cols[ic][j];
+            out_cols[ic].write(file, j, colsize[ic]);
         }
-        out << "\n";
+
+        file.end_line();
     }
 
+    file.flush();
+
     return 0;
 }
 
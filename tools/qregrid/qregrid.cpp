@@ -20,8 +20,10 @@ int vif_main(int argc, char* argv[]) {
     std::string weight;
     std::string method = "drizzle";
     bool conserve_flux = false;
+    uint_t thread = 1;
     read_args(argc-2, argv+2, arg_list(
-        verbose, name(tpl, "template"), aspix, ratio, method, conserve_flux, weight, pixfrac, fast
+        verbose, name(tpl, "template"), aspix, ratio, method, conserve_flux, weight, pixfrac, fast,
+        thread
     ));
 
     // Forward options
@@ -31,6 +33,8 @@ int vif_main(int argc, char* argv[]) {
     dopts.verbose = verbose;
     iopts.conserve_flux = conserve_flux;
     dopts.pixfrac = pixfrac;
+    iopts.thread = thread;
+    dopts.thread = thread;
 
     if (fast) {
         dopts.dest_pixfrac = true;
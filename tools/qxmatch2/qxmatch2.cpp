@@ -37,10 +37,20 @@ void print_help() {
         "n'th nearest neighbors for each source within this catalog."
     );
 
+    paragraph(
+        "If 'radius' is given, the program instead finds all the sources within this "
+        "radius (in arcseconds). The output then contains three columns: 'ID' and 'D' list "
+        "the matches of all the sources one after the other, sorted by distance, and the "
+        "matches of the i'th source are found between indices 'OFFSET[i]' (included) and "
+        "'OFFSET[i+1]' (excluded)."
+    );
+
     header("List of available command line options:");
     bullet("verbose", "set this flag to print additional information in the standard output");
     bullet("nth", "[number] set this value to the number of closest neighbors you want to retrieve "
         "(default: 1).");
+    bullet("radius", "[number] set this value to retrieve all the neighbors within this "
+        "radius in arcseconds, instead of a fixed number of neighbors (default: none).");
     bullet("pos", "[string(array)]: defines the suffix of the RA and Dec variables inside the two "
         "catalogs (default: \"\")");
     bullet("radec1", "[string(array)]: defines the name of the RA and Dec variables in the first "
@@ -84,9 +94,10 @@ int vif_main(int argc, char* argv[]) {
     bool   quiet = false;
     bool   brute = false;
     bool   no_mirror = false;
+    double radius = dnan;
 
     read_args(argc, argv, arg_list(
-        cats, output, nth, thread, verbose, quiet, pos, radec1, radec2, brute, no_mirror
+        cats, output, nth, thread, verbose, quiet, pos, radec1, radec2, brute, no_mirror, radius
     ));
 
     if (quiet) verbose = false;
@@ -101,6 +112,8 @@ int vif_main(int argc, char* argv[]) {
     };
 
     qxmatch_res res;
+    qxmatch_sparse_res sres;
+    const bool sparse = is_finite(radius);
 
     if (cats.size() == 2) {
         if (pos.size() == 1) pos = replicate(pos[0], 2);
@@ -127,7 +140,11 @@ int vif_main(int argc, char* argv[]) {
 
         qxmatch_params p; p.nth = nth; p.thread = thread; p.verbose = verbose; p.no_mirror = no_mirror;
         p.brute_force = brute;
-        res = qxmatch(cat1, cat2, p);
+        if (sparse) {
+            sres = qxmatch_radius(cat1, cat2, radius, p);
+        } else {
+            res = qxmatch(cat1, cat2, p);
+        }
     } else if (cats.size() == 1) {
         if (pos.empty()) pos = {""};
         if (!pos[0].empty()) pos += ".";
@@ -145,13 +162,21 @@ int vif_main(int argc, char* argv[]) {
 
         qxmatch_params p; p.nth = nth; p.thread = thread; p.verbose = verbose; p.no_mirror = no_mirror;
         p.brute_force = brute;
-        res = qxmatch(cat, p);
+        if (sparse) {
+            sres = qxmatch_radius(cat, radius, p);
+        } else {
+            res = qxmatch(cat, p);
+        }
     } else {
         if (!quiet) print_help();
         return 0;
     }
 
-    qxmatch_save(output, res);
+    if (sparse) {
+        qxmatch_save(output, sres);
+    } else {
+        qxmatch_save(output, res);
+    }
 
     return 0;
 }